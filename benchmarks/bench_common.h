@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+#include <benchmark/benchmark.h>
+
+#include "capture_generator.h"
+
+namespace pcapng_slicer::bench {
+
+// Reports the rates of the processed packets and of their data, the data rate is in GB/s.
+inline void ReportThroughput(benchmark::State& state, const CaptureStats& stats) {
+  const auto iterations = static_cast<double>(state.iterations());
+  state.counters["packets/s"] = benchmark::Counter(
+      iterations * static_cast<double>(stats.packets_count), benchmark::Counter::kIsRate);
+  state.counters["GB/s"] = benchmark::Counter(
+      iterations * static_cast<double>(stats.packet_bytes) / 1e9, benchmark::Counter::kIsRate);
+}
+
+// Capture parameters passed as benchmark arguments, see CaptureArguments().
+inline CaptureSpec SpecFromArguments(const benchmark::State& state) {
+  return {.size_mix = static_cast<SizeMix>(state.range(0)),
+          .options_percent = static_cast<uint32_t>(state.range(1)),
+          .interfaces_count = static_cast<uint32_t>(state.range(2))};
+}
+
+// Every packet size mix with and without options, and a capture with several interfaces.
+inline void CaptureArguments(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"mix", "options%", "interfaces"});
+  benchmark->ArgsProduct({{static_cast<int64_t>(SizeMix::kSmall),
+                           static_cast<int64_t>(SizeMix::kImix),
+                           static_cast<int64_t>(SizeMix::kJumbo)},
+                          {0, 100},
+                          {1}});
+  benchmark->Args({static_cast<int64_t>(SizeMix::kImix), 0, 8});
+}
+
+}  // namespace pcapng_slicer::bench
@@ -0,0 +1,227 @@
+#include "capture_generator.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+
+namespace pcapng_slicer::bench {
+namespace {
+
+constexpr uint16_t kOptComment = 1;
+constexpr uint16_t kEpbFlags = 2;
+constexpr uint16_t kEpbHash = 3;
+// Hash algorithm of the epb_hash option.
+constexpr uint8_t kHashCrc32 = 2;
+
+constexpr size_t kMaxPacketSize = 9000;
+constexpr uint64_t kTargetPacketBytes = 32 * 1024 * 1024;
+constexpr std::string_view kComment = "generated packet with a comment of variable length";
+
+const char* SizeMixName(SizeMix size_mix) {
+  switch (size_mix) {
+    case SizeMix::kSmall:
+      return "small";
+    case SizeMix::kImix:
+      return "imix";
+    case SizeMix::kJumbo:
+      return "jumbo";
+  }
+  return "unknown";
+}
+
+// Small xorshift generator, as the standard distributions differ between the implementations.
+class Random {
+ public:
+  explicit Random(uint64_t seed) : state_(0x9e3779b97f4a7c15 ^ (seed * 0xbf58476d1ce4e5b9)) {}
+
+  uint64_t Next() {
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 7;
+    state_ ^= state_ << 17;
+    return state_;
+  }
+
+ private:
+  uint64_t state_;
+};
+
+// Location of a value in the storage, spans are created once the storage stops growing.
+struct Location {
+  size_t offset;
+  size_t size;
+};
+
+}  // namespace
+
+std::string CaptureSpec::Name() const {
+  std::string name = std::string(SizeMixName(size_mix)) + "_" + std::to_string(PacketsCount()) +
+                     "p_" + std::to_string(options_percent) + "o_" +
+                     std::to_string(interfaces_count) + "i_" + std::to_string(seed) +
+                     "s.pcapng";
+  switch (compression) {
+    case OutputCompression::kZstd:
+      return name + ".zst";
+    case OutputCompression::kLz4:
+      return name + ".lz4";
+    case OutputCompression::kNone:
+      break;
+  }
+  return name;
+}
+
+size_t CaptureSpec::PacketsCount() const {
+  if (packets_count != 0) {
+    return packets_count;
+  }
+  switch (size_mix) {
+    case SizeMix::kSmall:
+      return kTargetPacketBytes / 64;
+    case SizeMix::kImix:
+      return kTargetPacketBytes * 12 / (7 * 64 + 4 * 576 + 1500);
+    case SizeMix::kJumbo:
+      return kTargetPacketBytes / kMaxPacketSize;
+  }
+  return 0;
+}
+
+PreparedCapture::PreparedCapture(const CaptureSpec& spec) : spec_(spec) {
+  Random random(spec.seed);
+  // Text-like payload, compressible about as well as real traffic.
+  std::vector<uint8_t> payload(kMaxPacketSize);
+  for (auto& byte : payload) {
+    byte = static_cast<uint8_t>('a' + random.Next() % 16);
+  }
+
+  const auto store = [this](const void* data, size_t size) {
+    const Location location{.offset = storage_.size(), .size = size};
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    storage_.insert(storage_.end(), bytes, bytes + size);
+    return location;
+  };
+
+  const size_t packets_count = spec.PacketsCount();
+  std::vector<Location> data_locations;
+  std::vector<Location> option_locations;
+  std::vector<size_t> options_counts;
+  data_locations.reserve(packets_count);
+  options_counts.reserve(packets_count);
+  packets_.reserve(packets_count);
+  uint64_t timestamp = 1'700'000'000'000'000'000;
+  for (size_t i = 0; i < packets_count; ++i) {
+    size_t size = 0;
+    switch (spec.size_mix) {
+      case SizeMix::kSmall:
+        size = 64;
+        break;
+      case SizeMix::kImix: {
+        const uint64_t value = random.Next() % 12;
+        size = value < 7 ? 64 : (value < 11 ? 576 : 1500);
+        break;
+      }
+      case SizeMix::kJumbo:
+        size = kMaxPacketSize;
+        break;
+    }
+
+    // Packets differ in the first bytes, like headers of different flows do.
+    const uint64_t header = random.Next();
+    std::memcpy(payload.data(), &header, sizeof(header));
+    data_locations.push_back(store(payload.data(), size));
+    stats_.packet_bytes += size;
+
+    timestamp += random.Next() % 10'000;
+    packets_.push_back({.description = {.interface_id = static_cast<uint32_t>(
+                                            random.Next() % spec.interfaces_count),
+                                        .timestamp = timestamp}});
+
+    size_t options_count = 0;
+    if (random.Next() % 100 < spec.options_percent) {
+      const size_t comment_size = 8 + random.Next() % (kComment.size() - 8);
+      options_.push_back({.code = kOptComment});
+      option_locations.push_back(store(kComment.data(), comment_size));
+      const auto flags = static_cast<uint32_t>(random.Next() & 0x3);
+      options_.push_back({.code = kEpbFlags});
+      option_locations.push_back(store(&flags, sizeof(flags)));
+      // Algorithm byte followed by the 32-bit value.
+      const auto hash = static_cast<uint32_t>(random.Next());
+      options_.push_back({.code = kEpbHash});
+      option_locations.push_back(store(&kHashCrc32, sizeof(kHashCrc32)));
+      store(&hash, sizeof(hash));
+      option_locations.back().size += sizeof(hash);
+      options_count = 3;
+    }
+    options_counts.push_back(options_count);
+  }
+
+  for (size_t i = 0; i < options_.size(); ++i) {
+    options_[i].value = std::span(storage_).subspan(option_locations[i].offset,
+                                                    option_locations[i].size);
+  }
+  size_t option_index = 0;
+  for (size_t i = 0; i < packets_.size(); ++i) {
+    packets_[i].data =
+        std::span(storage_).subspan(data_locations[i].offset, data_locations[i].size);
+    packets_[i].description.options =
+        std::span(options_).subspan(option_index, options_counts[i]);
+    option_index += options_counts[i];
+  }
+  stats_.packets_count = packets_.size();
+}
+
+void PreparedCapture::AddInterfaces(Writer& writer) const {
+  for (uint32_t i = 0; i < spec_.interfaces_count; ++i) {
+    writer.AddInterface({.link_type = 1, .timestamp_resolution = 9});
+  }
+}
+
+void WriteCapture(const PreparedCapture& capture, const std::filesystem::path& path) {
+  Writer writer;
+  if (!writer.Open(path, {.buffer_size = 4 * 1024 * 1024,
+                          .compression = capture.spec().compression,
+                          .compression_threads = 4})) {
+    throw std::runtime_error("Unable to create " + path.string());
+  }
+  capture.AddInterfaces(writer);
+  for (const auto& packet : capture.packets()) {
+    writer.WritePacket(packet.description, packet.data);
+  }
+  writer.Close();
+  if (writer.LastError() != ErrorType::kNoError) {
+    throw std::runtime_error("Unable to write " + path.string());
+  }
+}
+
+CaptureCache& CaptureCache::Instance() {
+  static CaptureCache cache;
+  return cache;
+}
+
+CaptureCache::CaptureCache()
+    : directory_(std::filesystem::temp_directory_path() / "pcapng_slicer_bench") {
+  std::filesystem::create_directories(directory_);
+}
+
+CaptureCache::~CaptureCache() {
+  std::error_code error;
+  std::filesystem::remove_all(directory_, error);
+}
+
+const CaptureCache::Capture& CaptureCache::Get(const CaptureSpec& spec) {
+  const std::string name = spec.Name();
+  if (const auto it = captures_.find(name); it != captures_.end()) {
+    return it->second;
+  }
+
+  const PreparedCapture capture(spec);
+  const auto path = OutputPath(name);
+  WriteCapture(capture, path);
+  return captures_.emplace(name, Capture{.path = path, .stats = capture.stats()}).first->second;
+}
+
+std::filesystem::path CaptureCache::OutputPath(const std::string& name) const {
+  const auto path = directory_ / name;
+  std::filesystem::remove_all(path);
+  return path;
+}
+
+}  // namespace pcapng_slicer::bench
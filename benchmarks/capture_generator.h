@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "pcapng_slicer/writer.h"
+
+namespace pcapng_slicer::bench {
+
+// Distribution of the packet sizes.
+enum class SizeMix {
+  // Minimal Ethernet frames.
+  kSmall,
+  // Simple IMIX: 64, 576 and 1500 byte packets in 7:4:1 proportion.
+  kImix,
+  // Jumbo frames.
+  kJumbo,
+};
+
+struct CaptureSpec {
+  SizeMix size_mix = SizeMix::kImix;
+  // Percentage of packets carrying options: a comment, a flags word and a hash.
+  uint32_t options_percent = 0;
+  uint32_t interfaces_count = 1;
+  // Zero selects the number of packets giving about 32 MB of packet data.
+  size_t packets_count = 0;
+  OutputCompression compression = OutputCompression::kNone;
+  // Captures of different seeds have different packets.
+  uint64_t seed = 0;
+
+  // Unique name of the capture, used as its file name.
+  std::string Name() const;
+  size_t PacketsCount() const;
+};
+
+// Amount of the generated data, used to report the throughput.
+struct CaptureStats {
+  size_t packets_count = 0;
+  // Total size of the packet data, without the block overhead.
+  uint64_t packet_bytes = 0;
+};
+
+// Packets of a synthetic capture kept in memory, so writing benchmarks don't measure the generator.
+// The same specification gives the same packets on every platform, so the results of different
+// runs and builds are comparable.
+class PreparedCapture {
+ public:
+  struct Packet {
+    PacketDescription description;
+    std::span<const uint8_t> data;
+  };
+
+  explicit PreparedCapture(const CaptureSpec& spec);
+
+  PreparedCapture(const PreparedCapture&) = delete;
+  PreparedCapture& operator=(const PreparedCapture&) = delete;
+
+  const CaptureSpec& spec() const { return spec_; }
+  const std::vector<Packet>& packets() const { return packets_; }
+  const CaptureStats& stats() const { return stats_; }
+  // Adds the interfaces of the capture to the `writer`.
+  void AddInterfaces(Writer& writer) const;
+
+ private:
+  CaptureSpec spec_;
+  // Packet data and option values of all of the packets.
+  std::vector<uint8_t> storage_;
+  std::vector<WriterOption> options_;
+  std::vector<Packet> packets_;
+  CaptureStats stats_;
+};
+
+// Writes the capture into the `path`, throws std::runtime_error if writing fails.
+void WriteCapture(const PreparedCapture& capture, const std::filesystem::path& path);
+
+// Generates captures on the first request and removes them on exit.
+class CaptureCache {
+ public:
+  struct Capture {
+    std::filesystem::path path;
+    CaptureStats stats;
+  };
+
+  static CaptureCache& Instance();
+  ~CaptureCache();
+
+  const Capture& Get(const CaptureSpec& spec);
+  // Returns a path for a temporary output, an existing file or directory is removed.
+  std::filesystem::path OutputPath(const std::string& name) const;
+
+ private:
+  CaptureCache();
+
+  std::filesystem::path directory_;
+  std::map<std::string, Capture> captures_;
+};
+
+}  // namespace pcapng_slicer::bench
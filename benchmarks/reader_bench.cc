@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <span>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "bench_common.h"
+#include "capture_generator.h"
+#include "pcapng_slicer/block_parser.h"
+#include "pcapng_slicer/packet_filter.h"
+#include "pcapng_slicer/parallel_scanner.h"
+#include "pcapng_slicer/reader.h"
+
+namespace pcapng_slicer::bench {
+namespace {
+
+void BM_ReadPacket(benchmark::State& state, ReadBackend backend) {
+  const auto& capture = CaptureCache::Instance().Get(SpecFromArguments(state));
+  for (auto _ : state) {
+    Reader reader;
+    if (!reader.Open(capture.path, {.backend = backend})) {
+      state.SkipWithError("Unable to open the capture");
+      return;
+    }
+    while (const auto packet = reader.ReadPacket()) {
+      benchmark::DoNotOptimize(packet->GetData().data());
+    }
+  }
+  ReportThroughput(state, capture.stats);
+}
+BENCHMARK_CAPTURE(BM_ReadPacket, stream, ReadBackend::kStream)->Apply(CaptureArguments);
+BENCHMARK_CAPTURE(BM_ReadPacket, mmap, ReadBackend::kMemoryMapped)->Apply(CaptureArguments);
+BENCHMARK_CAPTURE(BM_ReadPacket, async, ReadBackend::kAsync)->Apply(CaptureArguments);
+
+// Batches reuse both the vector and the packets' buffers.
+void BM_ReadPackets(benchmark::State& state, ReadBackend backend) {
+  constexpr size_t kBatchSize = 256;
+  const auto& capture = CaptureCache::Instance().Get(SpecFromArguments(state));
+  std::vector<Packet> packets;
+  for (auto _ : state) {
+    Reader reader;
+    if (!reader.Open(capture.path, {.backend = backend})) {
+      state.SkipWithError("Unable to open the capture");
+      return;
+    }
+    packets.clear();
+    while (reader.ReadPackets(packets, kBatchSize) > 0) {
+      for (const auto& packet : packets) {
+        benchmark::DoNotOptimize(packet.GetData().data());
+      }
+      packets.clear();
+    }
+  }
+  ReportThroughput(state, capture.stats);
+}
+BENCHMARK_CAPTURE(BM_ReadPackets, stream, ReadBackend::kStream)->Apply(CaptureArguments);
+BENCHMARK_CAPTURE(BM_ReadPackets, mmap, ReadBackend::kMemoryMapped)->Apply(CaptureArguments);
+
+// Only the largest packets pass the filter, the rest are rejected before they are materialised.
+void BM_ReadPacketIf(benchmark::State& state) {
+  const auto& capture = CaptureCache::Instance().Get(SpecFromArguments(state));
+  // ld len; jgt #1000, accept, reject
+  const auto program = BpfProgram::Create({{0x80, 0, 0, 0},
+                                           {0x25, 0, 1, 1000},
+                                           {0x06, 0, 0, 0xffff},
+                                           {0x06, 0, 0, 0}});
+  for (auto _ : state) {
+    Reader reader;
+    if (!program || !reader.Open(capture.path, {.backend = ReadBackend::kMemoryMapped})) {
+      state.SkipWithError("Unable to open the capture");
+      return;
+    }
+    while (const auto packet = reader.ReadPacketIf(*program)) {
+      benchmark::DoNotOptimize(packet->GetData().data());
+    }
+  }
+  ReportThroughput(state, capture.stats);
+}
+BENCHMARK(BM_ReadPacketIf)->Apply(CaptureArguments);
+
+// Packets are read once, so only the options parsing is measured.
+void BM_ParseOptions(benchmark::State& state) {
+  const auto& capture = CaptureCache::Instance().Get(SpecFromArguments(state));
+  Reader reader;
+  if (!reader.Open(capture.path, {.backend = ReadBackend::kMemoryMapped})) {
+    state.SkipWithError("Unable to open the capture");
+    return;
+  }
+  std::vector<Packet> packets;
+  while (reader.ReadPackets(packets, capture.stats.packets_count) > 0) {
+  }
+
+  for (auto _ : state) {
+    for (const auto& packet : packets) {
+      const Options options = packet.ParseOptions();
+      benchmark::DoNotOptimize(options.size());
+    }
+  }
+  ReportThroughput(state, capture.stats);
+}
+BENCHMARK(BM_ParseOptions)->Apply(CaptureArguments);
+
+// Same as above, but through the allocation-free view.
+void BM_IterateOptions(benchmark::State& state) {
+  const auto& capture = CaptureCache::Instance().Get(SpecFromArguments(state));
+  Reader reader;
+  if (!reader.Open(capture.path, {.backend = ReadBackend::kMemoryMapped})) {
+    state.SkipWithError("Unable to open the capture");
+    return;
+  }
+  std::vector<Packet> packets;
+  while (reader.ReadPackets(packets, capture.stats.packets_count) > 0) {
+  }
+
+  for (auto _ : state) {
+    for (const auto& packet : packets) {
+      for (const auto& option : packet.GetOptions()) {
+        benchmark::DoNotOptimize(option.GetCode());
+      }
+    }
+  }
+  ReportThroughput(state, capture.stats);
+}
+BENCHMARK(BM_IterateOptions)->Apply(CaptureArguments);
+
+void BM_ParallelScan(benchmark::State& state) {
+  const auto& capture = CaptureCache::Instance().Get(SpecFromArguments(state));
+  ParallelScanner scanner({.min_range_size = 1024 * 1024});
+  for (auto _ : state) {
+    std::atomic<size_t> packets_count = 0;
+    if (!scanner.Scan(capture.path, [&](Packet packet, const Interface&, uint64_t) {
+          benchmark::DoNotOptimize(packet.GetData().data());
+          packets_count.fetch_add(1, std::memory_order_relaxed);
+        })) {
+      state.SkipWithError("Unable to scan the capture");
+      return;
+    }
+  }
+  ReportThroughput(state, capture.stats);
+}
+BENCHMARK(BM_ParallelScan)->Apply(CaptureArguments)->UseRealTime();
+
+// The capture is fed from memory by chunks of the argument size, like a socket delivers it.
+void BM_BlockParser(benchmark::State& state) {
+  const auto& capture = CaptureCache::Instance().Get({.size_mix = SizeMix::kImix});
+  std::ifstream input(capture.path, std::ios::binary);
+  const std::vector<uint8_t> data(std::istreambuf_iterator<char>(input), {});
+  const auto chunk_size = static_cast<size_t>(state.range(0));
+  for (auto _ : state) {
+    BlockParser parser([](Packet packet) { benchmark::DoNotOptimize(packet.GetData().data()); });
+    for (size_t offset = 0; offset < data.size(); offset += chunk_size) {
+      parser.Feed(std::span(data).subspan(offset, std::min(chunk_size, data.size() - offset)));
+    }
+    if (!parser.Finish()) {
+      state.SkipWithError("Unable to parse the capture");
+      return;
+    }
+  }
+  ReportThroughput(state, capture.stats);
+}
+BENCHMARK(BM_BlockParser)->ArgName("chunk")->Arg(1500)->Arg(64 * 1024)->Arg(1024 * 1024);
+
+void BM_ReadCompressed(benchmark::State& state, OutputCompression compression) {
+  CaptureSpec spec{.size_mix = SizeMix::kImix, .compression = compression};
+  const CaptureCache::Capture* capture = nullptr;
+  try {
+    capture = &CaptureCache::Instance().Get(spec);
+  } catch (const std::exception&) {
+    state.SkipWithError("Compression is not supported");
+    return;
+  }
+  for (auto _ : state) {
+    Reader reader;
+    if (!reader.Open(capture->path)) {
+      state.SkipWithError("Unable to open the capture");
+      return;
+    }
+    while (const auto packet = reader.ReadPacket()) {
+      benchmark::DoNotOptimize(packet->GetData().data());
+    }
+  }
+  ReportThroughput(state, capture->stats);
+}
+BENCHMARK_CAPTURE(BM_ReadCompressed, zstd, OutputCompression::kZstd)->UseRealTime();
+BENCHMARK_CAPTURE(BM_ReadCompressed, lz4, OutputCompression::kLz4)->UseRealTime();
+
+}  // namespace
+}  // namespace pcapng_slicer::bench
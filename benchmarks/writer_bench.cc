@@ -0,0 +1,191 @@
+#include <array>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "bench_common.h"
+#include "capture_generator.h"
+#include "pcapng_slicer/merger.h"
+#include "pcapng_slicer/slicer.h"
+#include "pcapng_slicer/writer.h"
+
+namespace pcapng_slicer::bench {
+namespace {
+
+// Writes the whole prepared capture on every iteration, the output file is removed in between.
+template <typename WriteFunction>
+void RunWriteBenchmark(benchmark::State& state, const PreparedCapture& capture,
+                       const WriterConfig& config, WriteFunction&& write) {
+  const auto path = CaptureCache::Instance().OutputPath("writer_output.pcapng");
+  for (auto _ : state) {
+    Writer writer;
+    if (!writer.Open(path, config)) {
+      state.SkipWithError("Unable to create the output file");
+      return;
+    }
+    write(writer);
+    writer.Close();
+    if (writer.LastError() != ErrorType::kNoError) {
+      state.SkipWithError("Unable to write the output file");
+      return;
+    }
+
+    state.PauseTiming();
+    std::filesystem::remove(path);
+    state.ResumeTiming();
+  }
+  ReportThroughput(state, capture.stats());
+}
+
+// Simple Packet Blocks, the data of the packets is used only.
+void BM_WritePacket(benchmark::State& state, WriteMode mode) {
+  const PreparedCapture capture(SpecFromArguments(state));
+  RunWriteBenchmark(state, capture, {.mode = mode, .buffers_count = 4}, [&](Writer& writer) {
+    for (const auto& packet : capture.packets()) {
+      writer.WritePacket(packet.data);
+    }
+  });
+}
+BENCHMARK_CAPTURE(BM_WritePacket, sync, WriteMode::kSynchronous)->Apply(CaptureArguments);
+BENCHMARK_CAPTURE(BM_WritePacket, async, WriteMode::kAsynchronous)->Apply(CaptureArguments);
+
+void BM_WritePackets(benchmark::State& state) {
+  constexpr size_t kBatchSize = 256;
+  const PreparedCapture capture(SpecFromArguments(state));
+  std::vector<std::span<const uint8_t>> batch;
+  batch.reserve(kBatchSize);
+  RunWriteBenchmark(state, capture, {}, [&](Writer& writer) {
+    for (const auto& packet : capture.packets()) {
+      batch.push_back(packet.data);
+      if (batch.size() == kBatchSize) {
+        writer.WritePackets(batch);
+        batch.clear();
+      }
+    }
+    writer.WritePackets(batch);
+    batch.clear();
+  });
+}
+BENCHMARK(BM_WritePackets)->Apply(CaptureArguments);
+
+// Batches serialised into memory, so the copying of the packet data is measured rather than the
+// disk. The vector keeps its capacity between the iterations.
+void BM_WriteToMemory(benchmark::State& state, bool gather_writes) {
+  constexpr size_t kBatchSize = 256;
+  const PreparedCapture capture(SpecFromArguments(state));
+  std::vector<std::span<const uint8_t>> batch;
+  batch.reserve(kBatchSize);
+  std::vector<uint8_t> output;
+  for (auto _ : state) {
+    output.clear();
+    Writer writer;
+    writer.OpenBuffer(output, {.gather_writes = gather_writes});
+    for (const auto& packet : capture.packets()) {
+      batch.push_back(packet.data);
+      if (batch.size() == kBatchSize) {
+        writer.WritePackets(batch);
+        batch.clear();
+      }
+    }
+    writer.WritePackets(batch);
+    batch.clear();
+    writer.Close();
+    if (writer.LastError() != ErrorType::kNoError) {
+      state.SkipWithError("Unable to write the output");
+      return;
+    }
+  }
+  ReportThroughput(state, capture.stats());
+}
+BENCHMARK_CAPTURE(BM_WriteToMemory, buffered, false)->Apply(CaptureArguments);
+BENCHMARK_CAPTURE(BM_WriteToMemory, gather, true)->Apply(CaptureArguments);
+
+// Enhanced Packet Blocks with timestamps, interfaces and options of the capture.
+void BM_WriteEnhancedPacket(benchmark::State& state) {
+  const PreparedCapture capture(SpecFromArguments(state));
+  RunWriteBenchmark(state, capture, {}, [&](Writer& writer) {
+    capture.AddInterfaces(writer);
+    for (const auto& packet : capture.packets()) {
+      writer.WritePacket(packet.description, packet.data);
+    }
+  });
+}
+BENCHMARK(BM_WriteEnhancedPacket)->Apply(CaptureArguments);
+
+// The argument is the number of compression threads.
+void BM_WriteCompressed(benchmark::State& state, OutputCompression compression) {
+  const PreparedCapture capture({.size_mix = SizeMix::kImix});
+  const WriterConfig config{.buffer_size = 4 * 1024 * 1024,
+                            .compression = compression,
+                            .compression_threads = static_cast<size_t>(state.range(0))};
+  RunWriteBenchmark(state, capture, config, [&](Writer& writer) {
+    capture.AddInterfaces(writer);
+    for (const auto& packet : capture.packets()) {
+      writer.WritePacket(packet.description, packet.data);
+    }
+  });
+}
+BENCHMARK_CAPTURE(BM_WriteCompressed, zstd, OutputCompression::kZstd)
+    ->ArgName("threads")
+    ->RangeMultiplier(2)
+    ->Range(1, 8)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_WriteCompressed, lz4, OutputCompression::kLz4)
+    ->ArgName("threads")
+    ->RangeMultiplier(2)
+    ->Range(1, 8)
+    ->UseRealTime();
+
+// Merges two captures of the same parameters, but different packets.
+void BM_Merge(benchmark::State& state) {
+  CaptureSpec spec = SpecFromArguments(state);
+  auto& cache = CaptureCache::Instance();
+  const auto& first = cache.Get(spec);
+  spec.seed = 1;
+  const auto& second = cache.Get(spec);
+  const std::array inputs = {first.path, second.path};
+  const auto output = cache.OutputPath("merger_output.pcapng");
+
+  Merger merger;
+  for (auto _ : state) {
+    if (!merger.Merge(inputs, output)) {
+      state.SkipWithError("Unable to merge the captures");
+      return;
+    }
+    state.PauseTiming();
+    std::filesystem::remove(output);
+    state.ResumeTiming();
+  }
+  ReportThroughput(state, {.packets_count = first.stats.packets_count + second.stats.packets_count,
+                           .packet_bytes = first.stats.packet_bytes + second.stats.packet_bytes});
+}
+BENCHMARK(BM_Merge)->Apply(CaptureArguments);
+
+void BM_Slice(benchmark::State& state) {
+  auto& cache = CaptureCache::Instance();
+  const auto& capture = cache.Get(SpecFromArguments(state));
+  const std::filesystem::path output_directory = cache.OutputPath("slices");
+
+  Slicer slicer({.max_packets = 10'000});
+  for (auto _ : state) {
+    std::filesystem::create_directory(output_directory);
+    const bool sliced = slicer.Slice(capture.path, [&](size_t index) {
+      return output_directory / (std::to_string(index) + ".pcapng");
+    });
+    if (!sliced) {
+      state.SkipWithError("Unable to slice the capture");
+      return;
+    }
+    state.PauseTiming();
+    std::filesystem::remove_all(output_directory);
+    state.ResumeTiming();
+  }
+  ReportThroughput(state, capture.stats);
+}
+BENCHMARK(BM_Slice)->Apply(CaptureArguments);
+
+}  // namespace
+}  // namespace pcapng_slicer::bench
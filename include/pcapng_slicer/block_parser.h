@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "pcapng_slicer/error_type.h"
+#include "pcapng_slicer/export.h"
+#include "pcapng_slicer/packet.h"
+
+namespace pcapng_slicer {
+
+class SectionPrivate;
+class PacketPool;
+
+// Incremental parser of a pcapng stream which the caller already has in memory, e.g. received from
+// a socket or taken from shared memory, in chunks of any size. Blocks are parsed the same way the
+// Reader parses them, packets are passed to the callback as soon as their blocks are complete.
+class PCAPNG_SLICER_EXPORT BlockParser {
+ public:
+  using PacketCallback = std::function<void(Packet packet)>;
+
+  explicit BlockParser(PacketCallback callback);
+  ~BlockParser();
+
+  BlockParser(const BlockParser&) = delete;
+  BlockParser& operator=(const BlockParser&) = delete;
+  BlockParser(BlockParser&& other);
+  BlockParser& operator=(BlockParser&& other);
+
+  // Parses the blocks completed by the `chunk` and passes their packets to the callback. Packets of
+  // the blocks lying entirely within the chunk refer to it without copying, so they must not be
+  // used once the chunk is released or overwritten. Packets of the blocks spanning several chunks
+  // own their data. The incomplete block at the end of the chunk is kept until the following
+  // chunks complete it. Returns false if the stream is malformed, more context of the error may be
+  // retrieved by LastError() function, and the following chunks are rejected until Reset().
+  bool Feed(std::span<const uint8_t> chunk);
+  // Checks that the stream has ended at a block boundary. Returns false with the
+  // ErrorType::kTruncatedFile error if an incomplete block is left.
+  bool Finish();
+  // Forgets the stream, so a new one may be fed.
+  void Reset();
+  // Number of bytes of the incomplete block kept by the parser.
+  size_t PendingSize() const { return pending_.size(); }
+  // Return last error occured, if there was no error returns ErrorType::kNoError.
+  ErrorType LastError() const { return last_error_; }
+
+ private:
+  // Parses a complete block, `borrow` allows packets to refer to the `block` memory.
+  ErrorType ParseBlock(std::span<const uint8_t> block, bool borrow);
+  // Appends bytes of the `chunk` to the pending block until it is complete, parses it if it is.
+  ErrorType CompletePendingBlock(std::span<const uint8_t>& chunk);
+  bool Fail(ErrorType error);
+
+  PacketCallback callback_;
+  std::shared_ptr<SectionPrivate> section_;
+  // Recycles the packets, so a steady stream of packets doesn't allocate.
+  std::shared_ptr<PacketPool> packet_pool_;
+  // Beginning of the block which isn't complete yet.
+  std::vector<uint8_t> pending_;
+  // Offset of the next block from the beginning of the stream.
+  uint64_t block_position_ = 0;
+  ErrorType last_error_ = ErrorType::kNoError;
+};
+
+}  // namespace pcapng_slicer
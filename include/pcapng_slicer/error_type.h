@@ -15,6 +15,11 @@ enum class ErrorType {
   kInvalidInterfaceForPacket,
   kInvalidOptionSize,
   kWriteError,
+  kInvalidIndex,
+  kUnsupportedByteOrder,
+  kUnsupportedCompression,
+  kDecompressionError,
+  kReadError,
 };
 
 }  // namespace pcapng_slicer
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 
 #include "pcapng_slicer/export.h"
@@ -21,7 +22,19 @@ class PCAPNG_SLICER_EXPORT Interface {
   Interface(Interface&& other);
   Interface& operator=(Interface&& other);
 
+  // Two interfaces are equal if they refer to the same Interface Description Block.
+  bool operator==(const Interface& other) const;
+
+  uint16_t GetLinkType() const;
+  // Returns zero if the captured length of packets is not limited.
+  uint32_t GetSnapLen() const;
+  // Returns the value of the if_tsresol option or the default resolution of microseconds (6).
+  uint8_t GetTimestampResolution() const;
+
+  // Copies all of the interface options.
   Options ParseOptions() const;
+  // Returns a lazy view of the interface options, it is valid while the interface is alive.
+  OptionsView GetOptions() const;
 
  private:
   std::shared_ptr<InterfacePrivate> interface_impl_;
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+#include "pcapng_slicer/error_type.h"
+#include "pcapng_slicer/export.h"
+#include "pcapng_slicer/reader.h"
+#include "pcapng_slicer/writer.h"
+
+namespace pcapng_slicer {
+
+struct MergerConfig {
+  // Every input is read by its own Reader with this config, so the memory used for reading is
+  // bounded by read_ahead_buffer_size * read_ahead_buffers_count per input.
+  ReaderConfig reader_config = {.backend = ReadBackend::kAsync,
+                                .read_ahead_buffer_size = 256 * 1024,
+                                .read_ahead_buffers_count = 4};
+  WriterConfig writer_config;
+};
+
+// Merges several files into a single one ordered by the packet timestamps normalised to
+// nanoseconds. Inputs are streamed, every one of them is expected to be ordered by time already.
+//
+// The output has a single section. Interfaces of the inputs are added to it when the first packet
+// referring to them is written, packets are written as Enhanced Packet Blocks with their original
+// timestamps and options. The output is in the host byte order, so the standard numeric options and
+// the PEN of custom options of byte-swapped inputs are converted, other option values are copied as
+// they are.
+class PCAPNG_SLICER_EXPORT Merger {
+ public:
+  explicit Merger(const MergerConfig& config = {});
+
+  // Merges `inputs` into the `output` and returns true on success. Otherwise returns false and more
+  // context of the error may be retrieved by LastError() function. Packets with equal timestamps
+  // are written in the order of the inputs.
+  bool Merge(std::span<const std::filesystem::path> inputs, const std::filesystem::path& output);
+
+  // Returns the number of packets written by the last Merge() call, packets dropped because of
+  // OverflowPolicy::kDrop of the writer_config are not included.
+  uint64_t MergedPacketsCount() const { return merged_packets_count_; }
+
+  // Return last error occurred, if there was no error returns ErrorType::kNoError.
+  ErrorType LastError() const { return last_error_; }
+
+ private:
+  void MergeImpl(std::span<const std::filesystem::path> inputs,
+                 const std::filesystem::path& output);
+
+  MergerConfig config_;
+  uint64_t merged_packets_count_ = 0;
+  ErrorType last_error_ = ErrorType::kNoError;
+};
+
+}  // namespace pcapng_slicer
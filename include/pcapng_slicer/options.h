@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <optional>
 #include <span>
 #include <string_view>
@@ -10,6 +12,78 @@
 
 namespace pcapng_slicer {
 
+// Non-owning view of a single option, the data points straight into the block it was taken from.
+class PCAPNG_SLICER_EXPORT OptionView {
+ public:
+  uint16_t GetCode() const { return code_; }
+  std::span<const uint8_t> GetRawData() const { return data_; }
+  std::optional<uint32_t> GetPenCode() const { return pen_; }
+  // Returns the whole option value as it is stored in the block, including the PEN of custom
+  // options, so it may be written into another block as is.
+  std::span<const uint8_t> GetValue() const;
+
+  bool IsString() const;
+  std::string_view GetDataAsString() const;
+  // Returns the value converted to the host byte order, if the option value has exactly this size.
+  std::optional<uint32_t> GetUint32() const;
+  std::optional<uint64_t> GetUint64() const;
+
+ private:
+  friend class OptionsView;
+
+  std::span<const uint8_t> data_;
+  std::optional<uint32_t> pen_;
+  uint16_t code_{};
+  bool swapped_ = false;
+};
+
+// Lazy non-owning view of the options of a block. Options are parsed in place while iterating, so
+// nothing is copied or allocated. The view is valid for as long as the packet (or interface) it was
+// obtained from is alive. Iteration stops at opt_endofopt or at the first malformed option.
+class PCAPNG_SLICER_EXPORT OptionsView {
+ public:
+  class PCAPNG_SLICER_EXPORT Iterator {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = OptionView;
+
+    Iterator() = default;
+
+    const OptionView& operator*() const { return option_; }
+    const OptionView* operator->() const { return &option_; }
+    Iterator& operator++();
+    void operator++(int) { ++*this; }
+    bool operator==(std::default_sentinel_t) const { return at_end_; }
+
+   private:
+    friend class OptionsView;
+
+    Iterator(std::span<const uint8_t> data, bool swapped);
+
+    // Options following the current one.
+    std::span<const uint8_t> data_;
+    OptionView option_;
+    bool at_end_ = true;
+  };
+
+  OptionsView() = default;
+  // `swapped` means that the data byte order differs from the host one.
+  explicit OptionsView(std::span<const uint8_t> data, bool swapped = false)
+      : data_(data), swapped_(swapped) {}
+
+  Iterator begin() const { return Iterator(data_, swapped_); }
+  std::default_sentinel_t end() const { return {}; }
+  bool empty() const { return begin() == end(); }
+
+  // Returns the first option with the given code, the rest of options are not parsed.
+  std::optional<OptionView> Find(uint16_t code) const;
+
+ private:
+  std::span<const uint8_t> data_;
+  bool swapped_ = false;
+};
+
 // Single option representation.
 class PCAPNG_SLICER_EXPORT Option {
  public:
@@ -28,13 +102,15 @@ class PCAPNG_SLICER_EXPORT Option {
   uint16_t code_{};
 };
 
-// This class is simplel options container combined with the status of options parsing.
+// This class is simplel options container combined with the status of options parsing. Every option
+// is copied, prefer OptionsView when the options are just inspected.
 class PCAPNG_SLICER_EXPORT Options {
  public:
   using const_iterator = std::vector<Option>::const_iterator;
 
   Options();
   explicit Options(std::span<const uint8_t> data);
+  explicit Options(const OptionsView& view);
   ~Options();
 
   Options(const Options& other);
@@ -50,8 +126,6 @@ class PCAPNG_SLICER_EXPORT Options {
 
 
  private:
-  void ParseOptions(std::span<const uint8_t> data);
-
   std::vector<Option> options_;
 };
 
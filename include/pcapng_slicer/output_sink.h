@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include "pcapng_slicer/export.h"
+
+namespace pcapng_slicer {
+
+// Destination of the data serialised by the Writer, see Writer::OpenStream(). The Writer calls the
+// sink from one thread at a time, but in asynchronous and compressed modes it is a background
+// thread of the Writer rather than the caller's one.
+class PCAPNG_SLICER_EXPORT OutputSink {
+ public:
+  virtual ~OutputSink() = default;
+
+  // Writes all of the `parts` in order, as if they were a single contiguous piece of data, and
+  // returns false if writing has failed. With WriterConfig::gather_writes the parts refer to the
+  // caller's packet data, which is valid only during the call.
+  virtual bool Write(std::span<const std::span<const uint8_t>> parts) = 0;
+  // Waits until the written data reaches the storage, called by Writer::Flush() and Close().
+  virtual bool Sync() { return true; }
+  // Called once by Writer::Close() after the final Sync(), no writes follow it.
+  virtual bool Close() { return true; }
+};
+
+}  // namespace pcapng_slicer
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <span>
@@ -26,10 +27,18 @@ class PCAPNG_SLICER_EXPORT Packet {
   Interface GetInterface() const;
   std::span<const uint8_t> GetData() const;
   uint32_t GetOriginalLength() const;
+  // Raw timestamp in units of the interface timestamp resolution.
   uint64_t GetTimestamp() const;
+  // Timestamp in nanoseconds since the epoch, converted according to if_tsresol and if_tsoffset
+  // options of the interface.
+  uint64_t GetTimestampNs() const;
+  std::chrono::sys_time<std::chrono::nanoseconds> GetTime() const;
   bool IsValid() const;
 
+  // Copies all of the packet options.
   Options ParseOptions() const;
+  // Returns a lazy view of the packet options, it is valid while the packet is alive.
+  OptionsView GetOptions() const;
 
   operator bool() const;
 
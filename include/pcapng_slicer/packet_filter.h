@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "pcapng_slicer/export.h"
+
+namespace pcapng_slicer {
+
+// Packet seen by a filter, before it is turned into a Packet. The data is valid until the next
+// read from the Reader.
+struct PacketView {
+  std::span<const uint8_t> data;
+  uint32_t original_length = 0;
+  // Link type of the packet interface, which defines the layout of the data.
+  uint16_t link_type = 0;
+  // Raw timestamp in units of the interface timestamp resolution, zero for Simple Packet Blocks.
+  uint64_t timestamp = 0;
+};
+
+// Classic BPF instruction, the layout is the same as of the Linux struct sock_filter, so programs
+// produced by `tcpdump -dd` may be used as is.
+struct BpfInstruction {
+  uint16_t code = 0;
+  uint8_t jt = 0;
+  uint8_t jf = 0;
+  uint32_t k = 0;
+};
+
+// Classic BPF program executed by an interpreter, no libpcap is required. Programs are validated
+// on creation, so the execution never goes out of the program or the scratch memory. Loads beyond
+// the packet data reject the packet, like the kernel does.
+class PCAPNG_SLICER_EXPORT BpfProgram {
+ public:
+  // Returns nullopt if the program is invalid: it is empty or too long, has unknown instructions,
+  // jumps out of the program, divides by constant zero or doesn't end with a return.
+  static std::optional<BpfProgram> Create(std::vector<BpfInstruction> instructions);
+
+  // Runs the program and returns its result, which is the number of bytes of the packet to keep.
+  // Zero means that the packet is rejected.
+  uint32_t Run(std::span<const uint8_t> data, uint32_t original_length) const;
+
+  // Allows to use the program as a predicate of Reader::ReadPacketIf().
+  bool operator()(const PacketView& packet) const {
+    return Run(packet.data, packet.original_length) != 0;
+  }
+
+ private:
+  explicit BpfProgram(std::vector<BpfInstruction> instructions)
+      : instructions_(std::move(instructions)) {}
+
+  std::vector<BpfInstruction> instructions_;
+};
+
+}  // namespace pcapng_slicer
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "pcapng_slicer/error_type.h"
+#include "pcapng_slicer/export.h"
+
+namespace pcapng_slicer {
+
+// Location and main properties of a single packet in the capture file.
+struct PacketIndexEntry {
+  // Offset of the packet's block from the beginning of the file.
+  uint64_t offset;
+  // Timestamp in nanoseconds since the epoch, same as returned by Packet::GetTimestampNs(), so the
+  // packets of interfaces with different resolutions and offsets are ordered correctly.
+  uint64_t timestamp;
+  uint32_t interface_id;
+  uint32_t captured_length;
+};
+
+// Index of all packets of a capture file, which allows the Reader to seek to a packet by its
+// number or timestamp. The index is built by a single scan of the file and may be saved into a
+// compact sidecar file to be reused later.
+class PCAPNG_SLICER_EXPORT PacketIndex {
+ public:
+  PacketIndex();
+  ~PacketIndex();
+
+  PacketIndex(const PacketIndex& other);
+  PacketIndex& operator=(const PacketIndex& other);
+  PacketIndex(PacketIndex&& other);
+  PacketIndex& operator=(PacketIndex&& other);
+
+  // Scans the capture file and builds the index of it. Returns false if the file can't be read to
+  // the end and more context of the error may be retrieved by LastError() function.
+  bool Build(const std::filesystem::path& capture_path);
+  // Saves the index into the sidecar file, which is overwritten if it already exists.
+  bool Save(const std::filesystem::path& index_path);
+  // Loads the index previously saved by Save().
+  bool Load(const std::filesystem::path& index_path);
+
+  // Returns the size of the capture file the index was built for.
+  uint64_t GetCaptureSize() const { return capture_size_; }
+  // Entries of all packets in the file order.
+  std::span<const PacketIndexEntry> Entries() const { return entries_; }
+  size_t size() const { return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
+  // Returns the number of the earliest packet with timestamp not less than the `timestamp` in
+  // nanoseconds since the epoch. If there are several such packets, the first of them in the file
+  // order is returned.
+  std::optional<size_t> FindPacketByTime(uint64_t timestamp) const;
+
+  // Return last error occurred, if there was no error returns ErrorType::kNoError.
+  ErrorType LastError() const { return last_error_; }
+
+ private:
+  friend class Reader;
+
+  // Blocks which must be read before the packets of the section.
+  struct Section {
+    uint64_t offset = 0;
+    uint64_t first_packet = 0;
+    std::vector<uint64_t> interface_offsets;
+  };
+
+  void BuildImpl(const std::filesystem::path& capture_path);
+  void LoadImpl(const std::filesystem::path& index_path);
+  void BuildTimeOrder();
+  // Returns the section the packet belongs to.
+  const Section& GetPacketSection(size_t packet_number) const;
+  void Reset();
+
+  uint64_t capture_size_ = 0;
+  std::vector<Section> sections_;
+  std::vector<PacketIndexEntry> entries_;
+  // Packet numbers sorted by the timestamp.
+  std::vector<uint64_t> time_order_;
+  ErrorType last_error_ = ErrorType::kNoError;
+};
+
+}  // namespace pcapng_slicer
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+
+#include "pcapng_slicer/error_type.h"
+#include "pcapng_slicer/export.h"
+#include "pcapng_slicer/interface.h"
+#include "pcapng_slicer/packet.h"
+
+namespace pcapng_slicer {
+
+struct ParallelScannerConfig {
+  // Number of worker threads, 0 means the number of hardware threads.
+  size_t threads_count = 0;
+  // Files are not split into byte ranges smaller than this value.
+  uint64_t min_range_size = 16 * 1024 * 1024;
+};
+
+// Scans a single file with several threads. The file is memory mapped and split into byte ranges,
+// every range is resynchronised on a block boundary and its packets are parsed concurrently with
+// the other ranges.
+class PCAPNG_SLICER_EXPORT ParallelScanner {
+ public:
+  // Callback is called concurrently from the worker threads, so it must be thread safe. Packets of
+  // a single range are passed in the file order, but ranges are processed in arbitrary order. The
+  // order key is the offset of the packet's block in the file, sorting by it restores the file order.
+  using PacketCallback =
+      std::function<void(Packet packet, const Interface& interface, uint64_t order_key)>;
+
+  explicit ParallelScanner(const ParallelScannerConfig& config = {});
+
+  // Scans the whole file and returns true on success. Otherwise returns false and more context of
+  // the error may be retrieved by LastError() function. Note that some of the packets may be passed
+  // to the callback before the error is detected.
+  bool Scan(const std::filesystem::path& path, const PacketCallback& callback);
+
+  // Return last error occurred, if there was no error returns ErrorType::kNoError.
+  ErrorType LastError() const { return last_error_; }
+
+ private:
+  void ScanImpl(const std::filesystem::path& path, const PacketCallback& callback);
+
+  ParallelScannerConfig config_;
+  ErrorType last_error_ = ErrorType::kNoError;
+};
+
+}  // namespace pcapng_slicer
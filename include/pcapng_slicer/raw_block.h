@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+
+#include "pcapng_slicer/export.h"
+
+namespace pcapng_slicer {
+
+class BlockData;
+
+// A single block as it is stored in the file, its body is not parsed at all. The body is in the
+// byte order of the section the block belongs to and stays valid until the next read into the same
+// object, which reuses the storage.
+class PCAPNG_SLICER_EXPORT RawBlock {
+ public:
+  RawBlock();
+  ~RawBlock();
+
+  RawBlock(const RawBlock&) = delete;
+  RawBlock& operator=(const RawBlock&) = delete;
+  RawBlock(RawBlock&& other);
+  RawBlock& operator=(RawBlock&& other);
+
+  // Block Type as defined by the pcapng specification, e.g. 0x00000006 for Enhanced Packet Block.
+  uint32_t GetType() const { return type_; }
+  // Block Body between the leading and the trailing Block Total Length fields.
+  std::span<const uint8_t> GetBody() const;
+  // Offset of the block from the beginning of the file.
+  uint64_t GetPosition() const { return position_; }
+  // Returns true if the byte order of the block section differs from the host one.
+  bool IsSwapped() const { return swapped_; }
+
+ private:
+  friend class Reader;
+
+  std::unique_ptr<BlockData> data_;
+  uint64_t position_ = 0;
+  uint32_t type_ = 0;
+  bool swapped_ = false;
+};
+
+}  // namespace pcapng_slicer
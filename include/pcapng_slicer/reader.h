@@ -1,19 +1,78 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <span>
+#include <vector>
 
 #include "pcapng_slicer/error_type.h"
 #include "pcapng_slicer/export.h"
 #include "pcapng_slicer/packet.h"
+#include "pcapng_slicer/packet_filter.h"
+#include "pcapng_slicer/packet_index.h"
+#include "pcapng_slicer/raw_block.h"
+#include "pcapng_slicer/stats.h"
 
 namespace pcapng_slicer {
 
 class BlockReader;
+class DataSource;
 class ScopedBlock;
 class SectionPrivate;
 class Interface;
 class PacketPrivate;
+class PacketPool;
+template <typename T>
+class Result;
+
+// The way the Reader gets the data from the file.
+enum class ReadBackend {
+  // File is read through the std::ifstream and every block body is copied into the memory owned by
+  // the packet.
+  kStream,
+  // File is memory mapped and Packet::GetData() returns views pointing straight into the mapping.
+  // Every packet (and interface) shares the ownership of the mapping, so the views stay valid for
+  // as long as the object they were obtained from is alive, even after the Reader was closed or
+  // destroyed. The file must not be truncated while it is mapped.
+  kMemoryMapped,
+  // File is read ahead by several large requests kept in flight, so parsing overlaps with the I/O.
+  // io_uring is used if it is available, otherwise the requests are served by a few threads doing
+  // blocking reads. Block bodies are copied from the read-ahead buffers like with kStream.
+  kAsync,
+};
+
+// Reads the next bytes of a stream into `buffer` and returns their number, zero at the end of the
+// stream or a negative value if reading has failed. It may return fewer bytes than requested, e.g.
+// just the ones which have arrived, and it may block until some data arrives.
+using StreamReadFunction = std::function<int64_t(std::span<uint8_t> buffer)>;
+
+struct ReaderConfig {
+  ReadBackend backend = ReadBackend::kStream;
+  // Size of a single read-ahead request and the number of requests kept in flight, used by the
+  // kAsync backend only. The size is also the size of the chunks read by the follow mode and from
+  // the streams.
+  size_t read_ahead_buffer_size = 1024 * 1024;
+  size_t read_ahead_buffers_count = 4;
+  // Size and the number of buffers holding the decompressed data of a compressed file, which is
+  // decompressed on a separate thread ahead of parsing. Used for compressed files only.
+  size_t decompression_buffer_size = 1024 * 1024;
+  size_t decompression_buffers_count = 4;
+  // Follows a file which is still being written, like `tail -f` does. A block at the end of the
+  // file which isn't written completely is treated as not available yet rather than truncated.
+  // Reading functions wait up to `follow_timeout` for the next block, and if it doesn't appear they
+  // return nothing without an error, so the next call continues from the same position. Open()
+  // waits the same way for the section header. The file is read by read_ahead_buffer_size chunks
+  // regardless of the backend, compressed files can't be followed.
+  bool follow = false;
+  std::chrono::milliseconds follow_timeout{1000};
+  // Counters of the read blocks, bytes, allocations and time, which may be polled while reading.
+  // Nothing is counted if not set.
+  std::shared_ptr<ReaderCounters> counters;
+};
 
 class PCAPNG_SLICER_EXPORT Reader {
  public:
@@ -27,12 +86,59 @@ class PCAPNG_SLICER_EXPORT Reader {
 
   // Tries to open file and returns true if file was opened successfully. Otherwise returns false
   // and more context of the error may be retrieved by LastError() function.
-  bool Open(const std::filesystem::path& path);
+  bool Open(const std::filesystem::path& path, const ReaderConfig& config = {});
+  // Same as above, but reads a stream which can't be seeked, e.g. a pipe, stdin or a socket, so the
+  // data never has to touch the disk. Compressed streams are decompressed too. The backend and the
+  // follow mode don't apply to streams, as reading just blocks until more data arrives. The file
+  // descriptor is not closed by the Reader.
+  bool OpenStream(int fd, const ReaderConfig& config = {});
+  bool OpenStream(StreamReadFunction read, const ReaderConfig& config = {});
   // TODO: Add an explicit Close() function.
   // Try read a packet, the returned value may be nullopt if we have reached the end of the file or
   // reading was imposible because an error has occured. If result is non-nullopt, then the packet
   // is guaranteed to be valid.
   std::optional<Packet> ReadPacket();
+  // Reads up to packets.size() packets into `packets` and returns the number of read packets. The
+  // error handling is the same as in ReadPacket(), but it is done once per batch. If an error
+  // occurs in the middle of the batch, packets read before it are still returned.
+  size_t ReadPackets(std::span<Packet> packets);
+  // Same as above, but appends up to `max_count` packets to the end of `packets`. Clearing the
+  // vector between the calls allows to reuse both its storage and the packets' buffers.
+  size_t ReadPackets(std::vector<Packet>& packets, size_t max_count);
+  // Same as ReadPacket(), but skips the packets for which `predicate(const PacketView&)` returns
+  // false. Packets are checked before they are turned into Packet objects, so rejecting a packet
+  // costs just parsing of its block header. The predicate is called directly, so it may be inlined
+  // into the reading loop. BpfProgram may be used as a predicate too.
+  template <typename Predicate>
+  std::optional<Packet> ReadPacketIf(Predicate&& predicate) {
+    while (const std::optional<PacketView> packet = PeekPacket()) {
+      if (predicate(*packet)) {
+        return TakePeekedPacket();
+      }
+    }
+    return std::nullopt;
+  }
+  // Building blocks of ReadPacketIf(). PeekPacket() reads the next packet, but returns just a view
+  // of it, which is valid until the next read. The error handling is the same as in ReadPacket().
+  // TakePeekedPacket() turns the last peeked packet into a Packet, otherwise the packet is reused
+  // by the next read.
+  std::optional<PacketView> PeekPacket();
+  std::optional<Packet> TakePeekedPacket();
+  // Reads the next block of any type into `block` without parsing its body and returns true if
+  // successful. The storage of the block is reused. The first call after Open() returns the section
+  // header, which was read by Open(). Section headers and interfaces are still parsed, so reading
+  // may continue with ReadPacket(). The error handling is the same as in ReadPacket().
+  bool ReadRawBlock(RawBlock& block);
+  // Attaches the index of the opened file to the reader, which enables seeking. Returns false if the
+  // index was built for the file of a different size.
+  bool SetIndex(PacketIndex index);
+  // Moves the reader to the packet with the given number, so it will be returned by the next
+  // ReadPacket() call. Returns false without changing the reader state if there is no index or no
+  // such packet. Errors occurred while reading the file put the reader into an erroneous state.
+  bool SeekToPacket(size_t packet_number);
+  // Same as above, but moves to the earliest packet with timestamp not less than the `timestamp` in
+  // nanoseconds since the epoch, see Packet::GetTimestampNs() and PacketIndex::FindPacketByTime().
+  bool SeekToTime(uint64_t timestamp);
   // This function returns true if Open was successfully called and the Reader hasn't entered an
   // erroneus state.
   bool IsValid() const;
@@ -40,18 +146,44 @@ class PCAPNG_SLICER_EXPORT Reader {
   ErrorType LastError() const { return last_error_; }
 
  private:
-  void OpenImpl(const std::filesystem::path& path);
+  // Reading functions return errors rather than throw them, so the reading loop doesn't involve
+  // exceptions even for corrupted and truncated files.
+  bool OpenSource(const std::function<std::unique_ptr<DataSource>()>& create_source,
+                  const ReaderConfig& config);
+  ErrorType OpenImpl(const std::function<std::unique_ptr<DataSource>()>& create_source,
+                     const ReaderConfig& config);
   void EnterErrorState(ErrorType error);
+  // Checks if the next packet may be read, updating the last error if needed.
+  bool CanRead();
+  template <typename Consumer>
+  size_t ReadPacketsImpl(size_t max_count, Consumer&& consumer);
+  ErrorType ReadRawBlockImpl(RawBlock& block);
 
-  // Reads next block and optionally returns a packet, if this type of block war red.
-  std::unique_ptr<PacketPrivate> ReadNextBlock();
-  void ParseSectionHeader(ScopedBlock& block);
-  void ParseInterface(ScopedBlock& block);
-  std::unique_ptr<PacketPrivate> ParseSimplePacket(ScopedBlock& block);
-  std::unique_ptr<PacketPrivate> ParseEnchansedPacket(ScopedBlock& block);
+  // Reads next block and returns a packet if this type of block was read, otherwise null.
+  Result<std::unique_ptr<PacketPrivate>> ReadNextBlock();
+  ErrorType SeekToPacketImpl(size_t packet_number);
+  // Reads the block at `offset` which must have the `type`, section headers and interfaces only.
+  ErrorType ReadStructureBlockAt(uint64_t offset, uint32_t type);
+  ErrorType ParseSectionHeader(ScopedBlock& block);
+  ErrorType ParseInterface(ScopedBlock& block);
+  Result<std::unique_ptr<PacketPrivate>> ParseSimplePacket(ScopedBlock& block);
+  Result<std::unique_ptr<PacketPrivate>> ParseEnchansedPacket(ScopedBlock& block);
+  // Returns a packet of the type T, reusing the rejected peeked packet if possible.
+  template <typename T>
+  std::unique_ptr<T> AcquirePacket();
+  // Counts the packets returned to the caller.
+  void CountPackets(size_t count);
 
   std::unique_ptr<BlockReader> block_reader_;
   std::shared_ptr<SectionPrivate> section_;
+  // Recycles packets returned by ReadPacket(), it outlives the Reader while any packet is alive.
+  std::shared_ptr<PacketPool> packet_pool_;
+  std::optional<PacketIndex> index_;
+  std::shared_ptr<ReaderCounters> counters_;
+  // The first section header hasn't been returned by ReadRawBlock() yet, see its comment.
+  bool section_header_pending_ = false;
+  // The packet returned by the last PeekPacket() call.
+  std::unique_ptr<PacketPrivate> peeked_packet_;
   ErrorType last_error_ = ErrorType::kNoError;
 };
 
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+
+#include "pcapng_slicer/error_type.h"
+#include "pcapng_slicer/export.h"
+#include "pcapng_slicer/reader.h"
+#include "pcapng_slicer/writer.h"
+
+namespace pcapng_slicer {
+
+// Limits of a single output file, a zero value means that there is no such limit. The next file
+// is started once a packet doesn't fit into the current one according to any of the limits.
+struct SlicerConfig {
+  uint64_t max_packets = 0;
+  // Size of the output file including the re-emitted section header and interfaces. A file gets
+  // at least one packet, even if it exceeds the limit on its own.
+  uint64_t max_bytes = 0;
+  // Packets are grouped by the windows aligned to the multiples of this duration since the epoch.
+  // Timestamps are normalised according to the interface options, see Packet::GetTimestampNs().
+  std::chrono::nanoseconds time_window{0};
+  ReaderConfig reader_config;
+  // Overflow policy is ignored, the slicer never drops blocks.
+  WriterConfig writer_config;
+};
+
+// Splits a single file into several ones. Blocks are copied verbatim, without decoding and encoding
+// them again, in the byte order of the input. Every output file starts with the section header and
+// all of the interfaces of the current section, so the interface ids of the packets stay valid.
+// Section length of the re-emitted section headers is reset to unspecified.
+class PCAPNG_SLICER_EXPORT Slicer {
+ public:
+  // Returns the path of the output file with the given index, starting from zero.
+  using OutputPathCallback = std::function<std::filesystem::path(size_t index)>;
+
+  explicit Slicer(const SlicerConfig& config = {});
+
+  // Slices the `input` and returns true on success. Otherwise returns false and more context of the
+  // error may be retrieved by LastError() function. Blocks read before an error of the input are
+  // still written into the outputs. Existing files are never overwritten, reaching one fails with
+  // kFileAlreadyExists.
+  bool Slice(const std::filesystem::path& input, const OutputPathCallback& output_path);
+
+  // Returns the number of files created by the last Slice() call.
+  size_t OutputFilesCount() const { return output_files_count_; }
+
+  // Return last error occurred, if there was no error returns ErrorType::kNoError.
+  ErrorType LastError() const { return last_error_; }
+
+ private:
+  void SliceImpl(const std::filesystem::path& input, const OutputPathCallback& output_path);
+
+  SlicerConfig config_;
+  size_t output_files_count_ = 0;
+  ErrorType last_error_ = ErrorType::kNoError;
+};
+
+}  // namespace pcapng_slicer
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "pcapng_slicer/export.h"
+
+namespace pcapng_slicer {
+
+// Snapshot of the counters of a Reader. Times are measured only if enabled, see ReaderCounters.
+struct ReaderStats {
+  // Blocks read from the file per type, including the blocks read by ReadRawBlock().
+  uint64_t section_headers_count = 0;
+  uint64_t interfaces_count = 0;
+  uint64_t simple_packets_count = 0;
+  uint64_t enhanced_packets_count = 0;
+  // Blocks of other types, ReadPacket() skips them without reading their bodies.
+  uint64_t unknown_blocks_count = 0;
+  // Total length of the read blocks.
+  uint64_t bytes_read = 0;
+  // Packets returned to the caller, packets rejected by ReadPacketIf() are not counted.
+  uint64_t packets_count = 0;
+  // Packets allocated because there was no packet to reuse, and block buffers which had to grow.
+  // Both stay at zero in a steady-state read loop.
+  uint64_t packet_allocations_count = 0;
+  uint64_t buffer_allocations_count = 0;
+  // Time spent getting the data from the file, including waiting for the read-ahead or the
+  // decompression, and time spent parsing the blocks.
+  uint64_t io_time_ns = 0;
+  uint64_t parse_time_ns = 0;
+};
+
+// Snapshot of the counters of a Writer. Times are measured only if enabled, see WriterCounters.
+struct WriterStats {
+  // Blocks written per type, including the blocks written by WriteRawBlock().
+  uint64_t section_headers_count = 0;
+  uint64_t interfaces_count = 0;
+  uint64_t packets_count = 0;
+  uint64_t other_blocks_count = 0;
+  // Packets dropped because of the OverflowPolicy::kDrop policy.
+  uint64_t dropped_packets_count = 0;
+  // Total length of the written blocks, before compression.
+  uint64_t bytes_written = 0;
+  // Full buffers handed over for writing (gather-writes with WriterConfig::gather_writes), blocks
+  // too large for the buffer which were written directly, and explicit flushes (Flush() and
+  // Close()).
+  uint64_t buffers_flushed_count = 0;
+  uint64_t direct_writes_count = 0;
+  uint64_t syncs_count = 0;
+  // Time the caller was blocked writing the data or waiting for a free buffer.
+  uint64_t io_time_ns = 0;
+};
+
+// Counters of a Reader, enabled by ReaderConfig::counters. They are updated by the thread using
+// the Reader without any synchronisation, while Snapshot() may be called from any thread, e.g. by
+// a metrics agent. Counters are never reset, so they may be passed to successive Open() calls.
+class PCAPNG_SLICER_EXPORT ReaderCounters {
+ public:
+  // Measuring time reads the clock a few times per block, so it is enabled separately.
+  explicit ReaderCounters(bool measure_time = false) : measure_time_(measure_time) {}
+
+  ReaderCounters(const ReaderCounters&) = delete;
+  ReaderCounters& operator=(const ReaderCounters&) = delete;
+
+  bool measure_time() const { return measure_time_; }
+  // Every value is read atomically, but the values may be taken at slightly different moments.
+  ReaderStats Snapshot() const;
+  // Adds `value` to the `counter`. Only one thread may update the counters at a time.
+  void Add(uint64_t ReaderStats::*counter, uint64_t value = 1) {
+    std::atomic_ref<uint64_t> ref(stats_.*counter);
+    ref.store(ref.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+  }
+
+ private:
+  bool measure_time_;
+  // All of the counters are 64-bit, so aligning the struct aligns every one of them.
+  alignas(std::atomic_ref<uint64_t>::required_alignment) mutable ReaderStats stats_;
+};
+
+// Same as above, for a Writer, enabled by WriterConfig::counters.
+class PCAPNG_SLICER_EXPORT WriterCounters {
+ public:
+  explicit WriterCounters(bool measure_time = false) : measure_time_(measure_time) {}
+
+  WriterCounters(const WriterCounters&) = delete;
+  WriterCounters& operator=(const WriterCounters&) = delete;
+
+  bool measure_time() const { return measure_time_; }
+  WriterStats Snapshot() const;
+  void Add(uint64_t WriterStats::*counter, uint64_t value = 1) {
+    std::atomic_ref<uint64_t> ref(stats_.*counter);
+    ref.store(ref.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+  }
+
+ private:
+  bool measure_time_;
+  alignas(std::atomic_ref<uint64_t>::required_alignment) mutable WriterStats stats_;
+};
+
+}  // namespace pcapng_slicer
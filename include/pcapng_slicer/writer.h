@@ -1,21 +1,114 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
-#include <fstream>
+#include <functional>
 #include <memory>
+#include <optional>
 #include <span>
+#include <vector>
 
 #include "pcapng_slicer/error_type.h"
 #include "pcapng_slicer/export.h"
+#include "pcapng_slicer/output_sink.h"
+#include "pcapng_slicer/raw_block.h"
+#include "pcapng_slicer/stats.h"
 
 // Forward declarations
 namespace pcapng_slicer {
-class SectionPrivate;
-class InterfacePrivate;
+class BlockWriter;
 }  // namespace pcapng_slicer
 
 namespace pcapng_slicer {
 
+enum class WriteMode {
+  // Full buffers are written into the file by the thread calling the Writer.
+  kSynchronous,
+  // Full buffers are written by a background thread, while the caller continues filling the next
+  // free buffer. So the latency of WritePacket() doesn't depend on the disk as long as there are
+  // free buffers.
+  kAsynchronous,
+};
+
+// What to do with a packet if there is no free buffer in asynchronous mode.
+enum class OverflowPolicy {
+  // Wait until one of the buffers is written.
+  kBlock,
+  // Drop the packet and count it, see Writer::DroppedPacketsCount().
+  kDrop,
+};
+
+// Compression of the written file. Every buffer (see WriterConfig::buffer_size) is compressed into
+// an independent frame, so the output is a sequence of frames readable by the standard tools.
+enum class OutputCompression {
+  kNone,
+  // Requires the library to be built with libzstd.
+  kZstd,
+  // Requires the library to be built with liblz4.
+  kLz4,
+};
+
+struct WriterConfig {
+  // Blocks are serialised into the buffer of this size, which is written into the file at once
+  // when it gets full. Blocks larger than the buffer are written directly, in asynchronous mode it
+  // requires waiting for all of the buffers to be written.
+  size_t buffer_size = 1024 * 1024;
+  WriteMode mode = WriteMode::kSynchronous;
+  // Total number of buffers in asynchronous mode, so the memory used is limited by
+  // buffer_size * buffers_count. At least two buffers are used.
+  size_t buffers_count = 2;
+  OverflowPolicy overflow_policy = OverflowPolicy::kBlock;
+  // Compressed files are always written asynchronously, so the `mode` is ignored: full buffers are
+  // compressed by `compression_threads` threads in parallel and at least compression_threads + 1
+  // buffers are used. Opening fails with kUnsupportedCompression if the library was built without
+  // the requested format.
+  OutputCompression compression = OutputCompression::kNone;
+  // Zero selects the default level of the format.
+  int compression_level = 0;
+  size_t compression_threads = 1;
+  // Only block headers and other small pieces are copied into the buffer, while packet data is
+  // passed to the sink by reference. The pieces are written by a single gather-write at the end of
+  // every call of the Writer, e.g. one per WritePackets() batch, so it pays off for large packets
+  // written into memory or a socket, rather than for small ones written into a file. The `mode` is
+  // ignored, and so is this option for compressed output, which is copied by the compressor anyway.
+  bool gather_writes = false;
+  // Counters of the written blocks, flushes and time, which may be polled while writing. Nothing
+  // is counted if not set.
+  std::shared_ptr<WriterCounters> counters;
+};
+
+// Option to be written into a block. The value is padded to 32 bits by the Writer, opt_endofopt is
+// added automatically.
+struct WriterOption {
+  uint16_t code = 0;
+  std::span<const uint8_t> value;
+};
+
+// Interface Description Block parameters.
+struct InterfaceDescription {
+  uint16_t link_type = 1;  // LINKTYPE_ETHERNET
+  // Maximum captured length of packets, zero means that the length is not limited. Packets written
+  // on the interface are truncated to this length.
+  uint32_t snap_len = 0;
+  // Value of the if_tsresol option. The option is written only if it differs from the default
+  // resolution of microseconds (6).
+  uint8_t timestamp_resolution = 6;
+  // Additional options, must not contain if_tsresol.
+  std::span<const WriterOption> options;
+};
+
+// Enhanced Packet Block parameters.
+struct PacketDescription {
+  // Index of the interface as returned by Writer::AddInterface.
+  uint32_t interface_id = 0;
+  // Timestamp in units of the interface timestamp resolution.
+  uint64_t timestamp = 0;
+  // Length of the packet on the wire, if not set the length of the packet data is used.
+  std::optional<uint32_t> original_length;
+  std::span<const WriterOption> options;
+};
+
 class PCAPNG_SLICER_EXPORT Writer {
  public:
   Writer();
@@ -28,31 +121,88 @@ class PCAPNG_SLICER_EXPORT Writer {
 
   // Tries to create a new file and returns true if file was created successfully. Otherwise returns
   // false and more context of the error may be retrieved by LastError() function.
-  bool Open(const std::filesystem::path& path);
+  bool Open(const std::filesystem::path& path, const WriterConfig& config = {});
+  // Same as above, but writes into a file descriptor of the caller, e.g. a pipe, a socket or a
+  // memfd. The file descriptor is not closed by the Writer.
+  bool OpenStream(int fd, const WriterConfig& config = {});
+  // Same as above, but writes into the sink, which is destroyed by Close().
+  bool OpenStream(std::unique_ptr<OutputSink> sink, const WriterConfig& config = {});
+  // Same as above, but appends to the `buffer`, which must outlive the Writer or its Close() call.
+  // The buffer is complete only after Flush() or Close().
+  bool OpenBuffer(std::vector<uint8_t>& buffer, const WriterConfig& config = {});
 
-  // Closes currently opened file.
+  // Flushes buffered data, waits until it reaches the storage and closes currently opened file. If
+  // the flush fails, the error may be retrieved by LastError() function.
   void Close();
 
-  // Writes a packet to the file and returns true if successful. Automatically adds Interface if
-  // needed. Otherwise returns false and more context of the error may be retrieved by LastError()
-  // function.
+  // Writes an Interface Description Block and returns the id of the new interface. Otherwise
+  // returns std::nullopt and more context of the error may be retrieved by LastError() function.
+  std::optional<uint32_t> AddInterface(const InterfaceDescription& description);
+
+  // Writes a packet as a Simple Packet Block, which belongs to the first interface, and returns
+  // true if successful. Automatically adds Ethernet Interface if there is no interfaces yet.
+  // Otherwise returns false and more context of the error may be retrieved by LastError()
+  // function. Written data may stay in the buffer until it gets full or the Writer is closed.
   bool WritePacket(std::span<const uint8_t> packet_data);
+  // Same as above, but writes several packets at once.
+  bool WritePackets(std::span<const std::span<const uint8_t>> packets);
+  // Writes a packet as an Enhanced Packet Block with timestamp and options. The interface has to be
+  // added by AddInterface beforehand.
+  bool WritePacket(const PacketDescription& description, std::span<const uint8_t> packet_data);
+
+  // Writes the block as is and returns true if successful. Otherwise returns false and more context
+  // of the error may be retrieved by LastError() function. Blocks of byte-swapped sections can't be
+  // mixed with the sections written by the Writer and fail with kUnsupportedByteOrder. Written
+  // section headers and interfaces are taken into account by the following WritePacket() calls.
+  // Section headers are written with unspecified Section Length, as their blocks may be filtered.
+  // Open() has already written a section header, so a copied file starts with an empty section
+  // unless its first section header is skipped.
+  bool WriteRawBlock(const RawBlock& block);
+  // Same as above, the `body` must be padded to 32 bits and be in the host byte order.
+  bool WriteRawBlock(uint32_t type, std::span<const uint8_t> body);
+
+  // Writes buffered data into the file and waits until it reaches the storage.
+  bool Flush();
+
+  // Returns the number of packets dropped because of the OverflowPolicy::kDrop policy since the
+  // file was opened. Dropped packets are not reported as errors by WritePacket().
+  uint64_t DroppedPacketsCount() const;
 
   // This function returns true if Open was successfully called and the Writer hasn't entered an
-  // erroneous state.
+  // erroneous state. Invalid arguments, e.g. an unknown interface of a packet, don't count: nothing
+  // is written for them, so the call just fails and the Writer stays valid.
   bool IsValid() const;
 
   // Return last error occurred, if there was no error returns ErrorType::kNoError.
   ErrorType LastError() const;
 
  private:
-  void OpenImpl(const std::filesystem::path& path);
+  bool OpenSink(const std::function<std::unique_ptr<OutputSink>()>& create_sink,
+                const WriterConfig& config);
+  void OpenImpl(const std::function<std::unique_ptr<OutputSink>()>& create_sink,
+                const WriterConfig& config);
+  // Checks if writing is possible, updating the last error if needed.
+  bool CanWrite();
+  // Runs the `write` of a call and returns true if it succeeds. Invalid arguments are only reported
+  // by the last error, while failures of writing put the Writer into the error state.
+  bool RunWrite(const std::function<void()>& write);
   void WriteSectionHeader();
-  void WriteInterface();
+  uint32_t WriteInterface(const InterfaceDescription& description);
   void WriteSimplePacket(std::span<const uint8_t> packet_data);
+  void WriteEnchansedPacket(const PacketDescription& description,
+                            std::span<const uint8_t> packet_data);
+  void WriteOptions(std::span<const WriterOption> options);
+  void WriteRawBlockImpl(uint32_t type, std::span<const uint8_t> body);
+  // Counts a written block of `length` bytes, or a dropped packet if `counter` is
+  // dropped_packets_count.
+  void CountBlock(uint64_t WriterStats::*counter, uint32_t length);
   void EnterErrorState(ErrorType error);
 
-  std::ofstream file_;
+  std::unique_ptr<BlockWriter> block_writer_;
+  // Snap length of every added interface, the index is an interface id.
+  std::vector<uint32_t> interfaces_snap_len_;
+  std::shared_ptr<WriterCounters> counters_;
+  uint64_t dropped_packets_count_ = 0;
   ErrorType last_error_ = ErrorType::kNoError;
 };
 
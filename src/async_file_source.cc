@@ -0,0 +1,482 @@
+#include "async_file_source.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+#include "error.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define PCAPNG_SLICER_HAS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+namespace pcapng_slicer {
+namespace {
+
+// Number of threads performing blocking reads if io_uring is not available.
+constexpr uint32_t kMaxReadThreads = 4;
+
+#ifdef PCAPNG_SLICER_HAS_IO_URING
+
+// Minimal io_uring wrapper using raw system calls, so liburing is not required. Only vectored reads
+// are used, which are supported by every kernel having io_uring.
+class IoUringReader : public AsyncFileReader {
+ public:
+  // Returns nullptr if io_uring is not supported or disabled.
+  static std::unique_ptr<IoUringReader> Create(int fd, uint32_t queue_depth) {
+    io_uring_params params{};
+    const int ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, queue_depth, &params));
+    if (ring_fd < 0) {
+      return nullptr;
+    }
+
+    auto reader = std::unique_ptr<IoUringReader>(new IoUringReader(fd, ring_fd, queue_depth));
+    if (!reader->Map(params)) {
+      return nullptr;
+    }
+    return reader;
+  }
+
+  ~IoUringReader() override {
+    if (sqes_ != MAP_FAILED) {
+      munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != MAP_FAILED) {
+      munmap(sq_ring_, sq_ring_size_);
+    }
+    close(ring_fd_);
+  }
+
+  void Submit(uint32_t slot, std::span<uint8_t> dst, uint64_t offset) override {
+    assert(slot < iovecs_.size());
+    iovecs_[slot] = iovec{.iov_base = dst.data(), .iov_len = dst.size()};
+
+    // Only this thread produces submissions, so the tail may be read without synchronisation.
+    const uint32_t tail = *sq_tail_;
+    const uint32_t index = tail & *sq_mask_;
+    io_uring_sqe& sqe = sqes_[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_READV;
+    sqe.fd = fd_;
+    sqe.off = offset;
+    sqe.addr = reinterpret_cast<uint64_t>(&iovecs_[slot]);
+    sqe.len = 1;
+    sqe.user_data = slot;
+    sq_array_[index] = index;
+    std::atomic_ref<uint32_t>(*sq_tail_).store(tail + 1, std::memory_order_release);
+
+    while (syscall(__NR_io_uring_enter, ring_fd_, 1, 0, 0, nullptr, 0) < 0) {
+      if (errno != EINTR && errno != EAGAIN) {
+        // Unless the kernel has taken the entry anyway, it is withdrawn, so the request isn't
+        // submitted by the next call and completed twice. The failure is reported by the next
+        // WaitCompletion() call.
+        if (std::atomic_ref<uint32_t>(*sq_head_).load(std::memory_order_acquire) == tail) {
+          const int error = errno;
+          std::atomic_ref<uint32_t>(*sq_tail_).store(tail, std::memory_order_release);
+          failed_submissions_.push_back(Completion{.slot = slot, .result = -error});
+        }
+        break;
+      }
+    }
+  }
+
+  Completion WaitCompletion() override {
+    if (!failed_submissions_.empty()) {
+      const Completion completion = failed_submissions_.front();
+      failed_submissions_.pop_front();
+      return completion;
+    }
+
+    while (true) {
+      const uint32_t head = *cq_head_;
+      const uint32_t tail = std::atomic_ref<uint32_t>(*cq_tail_).load(std::memory_order_acquire);
+      if (head != tail) {
+        const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+        const Completion completion{.slot = static_cast<uint32_t>(cqe.user_data),
+                                    .result = cqe.res};
+        std::atomic_ref<uint32_t>(*cq_head_).store(head + 1, std::memory_order_release);
+        return completion;
+      }
+      // The requests were accepted by the kernel, so they will be completed eventually and errors
+      // (like an interrupt) are just retried.
+      syscall(__NR_io_uring_enter, ring_fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+    }
+  }
+
+ private:
+  IoUringReader(int fd, int ring_fd, uint32_t queue_depth)
+      : fd_(fd), ring_fd_(ring_fd), iovecs_(queue_depth) {}
+
+  bool Map(const io_uring_params& params) {
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+      return false;
+    }
+    cq_ring_ = single_mmap ? sq_ring_
+                           : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED) {
+      return false;
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+      return false;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    auto* sq_ring = static_cast<uint8_t*>(sq_ring_);
+    sq_head_ = reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.array);
+    auto* cq_ring = static_cast<uint8_t*>(cq_ring_);
+    cq_head_ = reinterpret_cast<uint32_t*>(cq_ring + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<uint32_t*>(cq_ring + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<uint32_t*>(cq_ring + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+    return true;
+  }
+
+  int fd_;
+  int ring_fd_;
+  void* sq_ring_ = MAP_FAILED;
+  size_t sq_ring_size_ = 0;
+  void* cq_ring_ = MAP_FAILED;
+  size_t cq_ring_size_ = 0;
+  io_uring_sqe* sqes_ = static_cast<io_uring_sqe*>(MAP_FAILED);
+  size_t sqes_size_ = 0;
+  uint32_t* sq_head_ = nullptr;
+  uint32_t* sq_tail_ = nullptr;
+  uint32_t* sq_mask_ = nullptr;
+  uint32_t* sq_array_ = nullptr;
+  uint32_t* cq_head_ = nullptr;
+  uint32_t* cq_tail_ = nullptr;
+  uint32_t* cq_mask_ = nullptr;
+  io_uring_cqe* cqes_ = nullptr;
+  // Every slot has its own vector, as it must stay alive until the request is completed.
+  std::vector<iovec> iovecs_;
+  std::deque<Completion> failed_submissions_;
+};
+
+#endif
+
+// Performs blocking reads on the worker threads, several threads keep several requests in flight.
+class ThreadedReader : public AsyncFileReader {
+ public:
+  ThreadedReader(const PositionalFile& file, uint32_t threads_count) : file_(file) {
+    for (uint32_t i = 0; i < threads_count; ++i) {
+      threads_.emplace_back([this] { Run(); });
+    }
+  }
+
+  ~ThreadedReader() override {
+    {
+      std::lock_guard lock(mutex_);
+      stop_ = true;
+    }
+    requests_cv_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  void Submit(uint32_t slot, std::span<uint8_t> dst, uint64_t offset) override {
+    {
+      std::lock_guard lock(mutex_);
+      requests_.push_back(Request{.slot = slot, .dst = dst, .offset = offset});
+    }
+    requests_cv_.notify_one();
+  }
+
+  Completion WaitCompletion() override {
+    std::unique_lock lock(mutex_);
+    completions_cv_.wait(lock, [this] { return !completions_.empty(); });
+    const Completion completion = completions_.front();
+    completions_.pop_front();
+    return completion;
+  }
+
+ private:
+  struct Request {
+    uint32_t slot;
+    std::span<uint8_t> dst;
+    uint64_t offset;
+  };
+
+  void Run() {
+    std::unique_lock lock(mutex_);
+    while (true) {
+      requests_cv_.wait(lock, [this] { return stop_ || !requests_.empty(); });
+      if (stop_) {
+        return;
+      }
+      const Request request = requests_.front();
+      requests_.pop_front();
+
+      lock.unlock();
+      const int64_t result = file_.ReadAt(request.dst, request.offset);
+      lock.lock();
+
+      completions_.push_back(Completion{.slot = request.slot, .result = result});
+      completions_cv_.notify_one();
+    }
+  }
+
+  const PositionalFile& file_;
+  std::mutex mutex_;
+  std::condition_variable requests_cv_;
+  std::condition_variable completions_cv_;
+  std::deque<Request> requests_;
+  std::deque<Completion> completions_;
+  bool stop_ = false;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace
+
+#ifdef _WIN32
+
+PositionalFile::PositionalFile(const std::filesystem::path& path) {
+  handle_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (handle_ == INVALID_HANDLE_VALUE) {
+    throw Error(ErrorType::kUnableToOpenFile);
+  }
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(handle_, &file_size)) {
+    CloseHandle(handle_);
+    throw Error(ErrorType::kUnableToOpenFile);
+  }
+  size_ = static_cast<uint64_t>(file_size.QuadPart);
+}
+
+PositionalFile::~PositionalFile() { CloseHandle(handle_); }
+
+int64_t PositionalFile::ReadAt(std::span<uint8_t> dst, uint64_t offset) const {
+  OVERLAPPED overlapped{};
+  overlapped.Offset = static_cast<DWORD>(offset);
+  overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+  const auto size =
+      static_cast<DWORD>(std::min<size_t>(dst.size(), std::numeric_limits<DWORD>::max()));
+  DWORD read = 0;
+  if (!ReadFile(handle_, dst.data(), size, &read, &overlapped) &&
+      GetLastError() != ERROR_HANDLE_EOF) {
+    return -1;
+  }
+  return read;
+}
+
+#else
+
+PositionalFile::PositionalFile(const std::filesystem::path& path) {
+  fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd_ < 0) {
+    throw Error(ErrorType::kUnableToOpenFile);
+  }
+
+  struct stat file_stat {};
+  if (fstat(fd_, &file_stat) != 0) {
+    close(fd_);
+    throw Error(ErrorType::kUnableToOpenFile);
+  }
+  size_ = static_cast<uint64_t>(file_stat.st_size);
+#ifdef POSIX_FADV_SEQUENTIAL
+  posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+}
+
+PositionalFile::~PositionalFile() { close(fd_); }
+
+int64_t PositionalFile::ReadAt(std::span<uint8_t> dst, uint64_t offset) const {
+  while (true) {
+    const ssize_t result = pread(fd_, dst.data(), dst.size(), static_cast<off_t>(offset));
+    if (result >= 0 || errno != EINTR) {
+      return result;
+    }
+  }
+}
+
+#endif
+
+std::unique_ptr<AsyncFileReader> CreateAsyncFileReader(const PositionalFile& file,
+                                                       uint32_t queue_depth) {
+#ifdef PCAPNG_SLICER_HAS_IO_URING
+  if (auto reader = IoUringReader::Create(file.fd(), queue_depth)) {
+    return reader;
+  }
+#endif
+  return std::make_unique<ThreadedReader>(file, std::min(queue_depth, kMaxReadThreads));
+}
+
+AsyncFileSource::AsyncFileSource(const std::filesystem::path& path, size_t buffer_size,
+                                 size_t buffers_count)
+    : file_(std::make_unique<PositionalFile>(path)) {
+  buffer_size = std::max<size_t>(buffer_size, 1);
+  buffers_count = std::clamp<size_t>(buffers_count, 1, std::numeric_limits<uint16_t>::max());
+  reader_ = CreateAsyncFileReader(*file_, static_cast<uint32_t>(buffers_count));
+
+  buffers_.resize(buffers_count);
+  for (auto& buffer : buffers_) {
+    buffer.data.resize(buffer_size);
+  }
+  Restart(0);
+}
+
+AsyncFileSource::~AsyncFileSource() {
+  // The buffers must not be released while the reads into them are in progress.
+  Drain();
+}
+
+size_t AsyncFileSource::Read(std::span<uint8_t> dst) { return Consume(dst.data(), dst.size()); }
+
+size_t AsyncFileSource::Skip(size_t size) { return Consume(nullptr, size); }
+
+bool AsyncFileSource::IsEof() {
+  // A failure must not look like the end of data.
+  return !WaitCurrentBuffer() && error_ == ErrorType::kNoError;
+}
+
+bool AsyncFileSource::Seek(uint64_t offset) {
+  if (offset > file_->size()) {
+    return false;
+  }
+
+  // Seeking inside of the already read data doesn't require any I/O.
+  const Buffer& current = buffers_[current_];
+  if (!current.in_flight && offset >= current.offset && offset - current.offset <= current.size) {
+    position_ = offset - current.offset;
+    return true;
+  }
+
+  Drain();
+  Restart(offset);
+  return true;
+}
+
+std::optional<uint64_t> AsyncFileSource::Size() const { return file_->size(); }
+
+size_t AsyncFileSource::Consume(uint8_t* dst, size_t size) {
+  size_t consumed = 0;
+  while (consumed < size && WaitCurrentBuffer()) {
+    const Buffer& buffer = buffers_[current_];
+    const size_t chunk_size = std::min(size - consumed, buffer.size - position_);
+    if (dst) {
+      std::memcpy(dst + consumed, buffer.data.data() + position_, chunk_size);
+    }
+    position_ += chunk_size;
+    consumed += chunk_size;
+  }
+  return consumed;
+}
+
+bool AsyncFileSource::WaitCurrentBuffer() {
+  while (true) {
+    Buffer& buffer = buffers_[current_];
+    while (buffer.in_flight) {
+      HandleCompletion(reader_->WaitCompletion());
+    }
+    if (position_ < buffer.size) {
+      return true;
+    }
+    // Partially filled buffer is the last one: either the end of the file is reached or reading
+    // has failed.
+    if (buffer.size < buffer.data.size()) {
+      if (buffer.failed) {
+        error_ = ErrorType::kReadError;
+      }
+      return false;
+    }
+
+    SubmitNext(current_);
+    current_ = (current_ + 1) % buffers_.size();
+    position_ = 0;
+  }
+}
+
+void AsyncFileSource::SubmitNext(size_t index) {
+  Buffer& buffer = buffers_[index];
+  buffer.offset = next_offset_;
+  buffer.expected_size = std::min<uint64_t>(buffer.data.size(), file_->size() - next_offset_);
+  buffer.size = 0;
+  buffer.failed = false;
+  next_offset_ += buffer.expected_size;
+  if (buffer.expected_size > 0) {
+    buffer.in_flight = true;
+    ++in_flight_count_;
+    reader_->Submit(index, std::span(buffer.data).first(buffer.expected_size), buffer.offset);
+  }
+}
+
+void AsyncFileSource::HandleCompletion(const AsyncFileReader::Completion& completion) {
+  Buffer& buffer = buffers_[completion.slot];
+  if (completion.result > 0) {
+    buffer.size += completion.result;
+    // Short read, the rest of the buffer is requested again.
+    if (buffer.size < buffer.expected_size) {
+      reader_->Submit(completion.slot,
+                      std::span(buffer.data).subspan(buffer.size, buffer.expected_size - buffer.size),
+                      buffer.offset + buffer.size);
+      return;
+    }
+  }
+  // On failure the buffer stays partially filled, so the data ends at it. The file getting shorter
+  // just ends the data, while an error is reported once the data is consumed up to it.
+  buffer.failed = completion.result < 0;
+  buffer.in_flight = false;
+  --in_flight_count_;
+}
+
+void AsyncFileSource::Drain() {
+  while (in_flight_count_ > 0) {
+    HandleCompletion(reader_->WaitCompletion());
+  }
+}
+
+void AsyncFileSource::Restart(uint64_t offset) {
+  assert(in_flight_count_ == 0);
+  error_ = ErrorType::kNoError;
+  next_offset_ = offset;
+  current_ = 0;
+  position_ = 0;
+  for (size_t i = 0; i < buffers_.size(); ++i) {
+    SubmitNext(i);
+  }
+}
+
+}  // namespace pcapng_slicer
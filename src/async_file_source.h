@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "data_source.h"
+
+namespace pcapng_slicer {
+
+// Read-only file which supports reads at arbitrary offsets, the file is closed on destruction.
+class PositionalFile {
+ public:
+  explicit PositionalFile(const std::filesystem::path& path);
+  ~PositionalFile();
+
+  PositionalFile(const PositionalFile&) = delete;
+  PositionalFile& operator=(const PositionalFile&) = delete;
+  PositionalFile(PositionalFile&&) = delete;
+  PositionalFile& operator=(PositionalFile&&) = delete;
+
+  // Reads up to dst.size() bytes at the `offset` and returns the number of read bytes, or a
+  // negative value if reading has failed.
+  int64_t ReadAt(std::span<uint8_t> dst, uint64_t offset) const;
+  uint64_t size() const { return size_; }
+#ifndef _WIN32
+  int fd() const { return fd_; }
+#endif
+
+ private:
+  uint64_t size_ = 0;
+#ifdef _WIN32
+  void* handle_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+};
+
+// Engine which performs reads asynchronously. Requests are identified by the slot number, which
+// is returned back with the completion.
+class AsyncFileReader {
+ public:
+  struct Completion {
+    uint32_t slot;
+    // Number of read bytes, or a negative value if reading has failed.
+    int64_t result;
+  };
+
+  virtual ~AsyncFileReader() = default;
+
+  // Queues reading into `dst` at the `offset`, the buffer must stay alive until the completion.
+  virtual void Submit(uint32_t slot, std::span<uint8_t> dst, uint64_t offset) = 0;
+  // Blocks until any of the submitted reads is completed.
+  virtual Completion WaitCompletion() = 0;
+};
+
+// Creates an io_uring based reader if the kernel supports it, otherwise falls back to threads
+// which perform plain blocking reads.
+std::unique_ptr<AsyncFileReader> CreateAsyncFileReader(const PositionalFile& file,
+                                                       uint32_t queue_depth);
+
+// Keeps several large read-ahead requests in flight, so parsing of the data overlaps with the I/O.
+// The buffers form a ring: the buffers are consumed in the file order and every consumed buffer is
+// immediately resubmitted for the next part of the file.
+//
+//   consumed        in flight         in flight       in flight
+//  +----------+  +--------------+  +-------------+  +-------------+
+//  | buffer 0 |  |   buffer 1   |  |  buffer 2   |  |  buffer 3   |
+//  +----------+  +--------------+  +-------------+  +-------------+
+//       ^ read position
+class AsyncFileSource : public DataSource {
+ public:
+  AsyncFileSource(const std::filesystem::path& path, size_t buffer_size, size_t buffers_count);
+  ~AsyncFileSource() override;
+
+  // DataSource overrides:
+  size_t Read(std::span<uint8_t> dst) override;
+  size_t Skip(size_t size) override;
+  bool IsEof() override;
+  bool Seek(uint64_t offset) override;
+  std::optional<uint64_t> Size() const override;
+  ErrorType LastError() const override { return error_; }
+
+ private:
+  struct Buffer {
+    std::vector<uint8_t> data;
+    // Offset of the buffer in the file.
+    uint64_t offset = 0;
+    // Number of bytes expected to be read into the buffer.
+    size_t expected_size = 0;
+    // Number of bytes which are already read.
+    size_t size = 0;
+    bool in_flight = false;
+    bool failed = false;
+  };
+
+  // Copies (or just skips if `dst` is null) up to `size` bytes.
+  size_t Consume(uint8_t* dst, size_t size);
+  // Blocks until the current buffer is filled, returns false if there is no more data or reading
+  // has failed.
+  bool WaitCurrentBuffer();
+  // Reuses the buffer for reading the data following the last submitted request.
+  void SubmitNext(size_t index);
+  void HandleCompletion(const AsyncFileReader::Completion& completion);
+  // Waits for every in flight request, it is required before the buffers can be reused.
+  void Drain();
+  // Starts reading ahead from the `offset`.
+  void Restart(uint64_t offset);
+
+  std::unique_ptr<PositionalFile> file_;
+  std::unique_ptr<AsyncFileReader> reader_;
+  std::vector<Buffer> buffers_;
+  size_t current_ = 0;
+  // Read position inside the current buffer.
+  size_t position_ = 0;
+  // Offset of the next read request.
+  uint64_t next_offset_ = 0;
+  size_t in_flight_count_ = 0;
+  // Set once the data up to a failed read is consumed.
+  ErrorType error_ = ErrorType::kNoError;
+};
+
+}  // namespace pcapng_slicer
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace pcapng_slicer {
+
+// Body of a single block. The bytes are either owned by the object itself or borrowed from a data
+// source which is able to provide zero-copy views (e.g. memory mapped file). In the latter case the
+// owner keeps the borrowed memory alive for as long as this object exists.
+class BlockData {
+ public:
+  BlockData() = default;
+
+  // Copying is prohibited, because the view may point into the own storage.
+  BlockData(const BlockData&) = delete;
+  BlockData& operator=(const BlockData&) = delete;
+  BlockData(BlockData&&) = default;
+  BlockData& operator=(BlockData&&) = default;
+
+  // Makes the object to own `size` bytes and returns a writable view of them. Previously allocated
+  // storage is reused if possible.
+  std::span<uint8_t> Allocate(size_t size) {
+    owner_.reset();
+    if (storage_.capacity() < size) {
+      // Grow geometrically, so reused buffers stop reallocating quickly.
+      storage_.reserve(std::max(size, 2 * storage_.capacity()));
+    }
+    storage_.resize(size);
+    view_ = storage_;
+    return storage_;
+  }
+
+  // Makes the object to refer to the memory which is kept alive by the `owner`.
+  void Borrow(std::span<const uint8_t> view, std::shared_ptr<const void> owner) {
+    owner_ = std::move(owner);
+    view_ = view;
+  }
+
+  // Drops the data, but keeps the own storage allocated.
+  void Clear() {
+    owner_.reset();
+    storage_.clear();
+    view_ = {};
+  }
+
+  std::span<const uint8_t> view() const { return view_; }
+  size_t size() const { return view_.size(); }
+  // Size of the own storage, Allocate() of a larger size reallocates it.
+  size_t capacity() const { return storage_.capacity(); }
+  bool empty() const { return view_.empty(); }
+
+ private:
+  std::vector<uint8_t> storage_;
+  std::shared_ptr<const void> owner_;
+  std::span<const uint8_t> view_;
+};
+
+}  // namespace pcapng_slicer
@@ -0,0 +1,187 @@
+#include "pcapng_slicer/block_parser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "block_data.h"
+#include "block_parsing.h"
+#include "block_types.h"
+#include "interface_private.h"
+#include "packet_pool.h"
+#include "packet_private.h"
+#include "result.h"
+#include "section_private.h"
+
+namespace pcapng_slicer {
+namespace {
+
+// Puts the block body into `data`, either as a view of the block or as a copy of it.
+void SetBody(BlockData& data, std::span<const uint8_t> body, bool borrow) {
+  if (borrow) {
+    data.Borrow(body, nullptr);
+  } else {
+    std::memcpy(data.Allocate(body.size()).data(), body.data(), body.size());
+  }
+}
+
+}  // namespace
+
+BlockParser::BlockParser(PacketCallback callback)
+    : callback_(std::move(callback)), packet_pool_(std::make_shared<PacketPool>()) {}
+
+BlockParser::~BlockParser() = default;
+
+BlockParser::BlockParser(BlockParser&& other) = default;
+
+BlockParser& BlockParser::operator=(BlockParser&& other) = default;
+
+bool BlockParser::Feed(std::span<const uint8_t> chunk) {
+  if (last_error_ != ErrorType::kNoError) {
+    return false;
+  }
+  if (!pending_.empty()) {
+    if (const ErrorType error = CompletePendingBlock(chunk); error != ErrorType::kNoError) {
+      return Fail(error);
+    }
+    if (!pending_.empty()) {
+      return true;
+    }
+  }
+
+  // Blocks lying entirely within the chunk are parsed in place.
+  while (chunk.size() >= kEmptyBlockSize) {
+    const Result<BlockHeader> header =
+        PeekBlockHeader(chunk, section_ ? section_->swapped : false);
+    if (!header) {
+      return Fail(header.error());
+    }
+    if (chunk.size() < header->total_length) {
+      break;
+    }
+    if (const ErrorType error = ParseBlock(chunk.first(header->total_length), /*borrow=*/true);
+        error != ErrorType::kNoError) {
+      return Fail(error);
+    }
+    chunk = chunk.subspan(header->total_length);
+  }
+  pending_.assign(chunk.begin(), chunk.end());
+  return true;
+}
+
+bool BlockParser::Finish() {
+  if (last_error_ != ErrorType::kNoError) {
+    return false;
+  }
+  if (!pending_.empty()) {
+    return Fail(ErrorType::kTruncatedFile);
+  }
+  return true;
+}
+
+void BlockParser::Reset() {
+  section_.reset();
+  pending_.clear();
+  block_position_ = 0;
+  last_error_ = ErrorType::kNoError;
+}
+
+ErrorType BlockParser::CompletePendingBlock(std::span<const uint8_t>& chunk) {
+  const auto append = [&](size_t size) {
+    const auto part = chunk.first(std::min(size, chunk.size()));
+    pending_.insert(pending_.end(), part.begin(), part.end());
+    chunk = chunk.subspan(part.size());
+  };
+
+  if (pending_.size() < kEmptyBlockSize) {
+    append(kEmptyBlockSize - pending_.size());
+    if (pending_.size() < kEmptyBlockSize) {
+      return ErrorType::kNoError;
+    }
+  }
+  const Result<BlockHeader> header =
+      PeekBlockHeader(pending_, section_ ? section_->swapped : false);
+  if (!header) {
+    return header.error();
+  }
+  append(header->total_length - pending_.size());
+  if (pending_.size() < header->total_length) {
+    return ErrorType::kNoError;
+  }
+  // The pending storage is reused by the following blocks, so the block is copied.
+  const ErrorType error = ParseBlock(pending_, /*borrow=*/false);
+  pending_.clear();
+  return error;
+}
+
+ErrorType BlockParser::ParseBlock(std::span<const uint8_t> block, bool borrow) {
+  const Result<BlockHeader> header = PeekBlockHeader(block, section_ ? section_->swapped : false);
+  if (!header) {
+    return header.error();
+  }
+  // The body includes the Byte-Order Magic of a section header, like the Reader provides it.
+  const auto body = block.subspan(2 * sizeof(uint32_t), header->total_length - kEmptyBlockSize);
+  const uint64_t block_position = std::exchange(block_position_,
+                                                block_position_ + header->total_length);
+
+  if (header->type == static_cast<uint32_t>(PcapngBlockType::kSectionHeader)) {
+    // Sections and interfaces outlive the chunk, so they always own their data.
+    BlockData data;
+    SetBody(data, body, /*borrow=*/false);
+    Result<std::shared_ptr<SectionPrivate>> section =
+        ParseSectionHeaderBlock(std::move(data), block_position);
+    if (!section) {
+      return section.error();
+    }
+    section_ = std::move(*section);
+    return ErrorType::kNoError;
+  }
+  if (!section_) {
+    return ErrorType::kFirstBlockIsNotSectionHeader;
+  }
+
+  switch (header->type) {
+    case static_cast<uint32_t>(PcapngBlockType::kInterfaceDescription): {
+      BlockData data;
+      SetBody(data, body, /*borrow=*/false);
+      Result<std::shared_ptr<InterfacePrivate>> interface =
+          ParseInterfaceBlock(*section_, std::move(data), block_position);
+      if (!interface) {
+        return interface.error();
+      }
+      section_->PushInterface(std::move(*interface));
+      return ErrorType::kNoError;
+    }
+    case static_cast<uint32_t>(PcapngBlockType::kSimplePacket): {
+      auto packet = packet_pool_->AcquireSimplePacket();
+      SetBody(packet->data, body, borrow);
+      if (const ErrorType error = ParseSimplePacketBlock(*section_, *packet);
+          error != ErrorType::kNoError) {
+        return error;
+      }
+      callback_(Packet(std::move(packet)));
+      return ErrorType::kNoError;
+    }
+    case static_cast<uint32_t>(PcapngBlockType::kEnchancedPacket): {
+      auto packet = packet_pool_->AcquireEnchansedPacket();
+      SetBody(packet->data, body, borrow);
+      if (const ErrorType error = ParseEnchansedPacketBlock(*section_, *packet);
+          error != ErrorType::kNoError) {
+        return error;
+      }
+      callback_(Packet(std::move(packet)));
+      return ErrorType::kNoError;
+    }
+    default:
+      // Other blocks are skipped, like ReadPacket() does.
+      return ErrorType::kNoError;
+  }
+}
+
+bool BlockParser::Fail(ErrorType error) {
+  last_error_ = error;
+  pending_.clear();
+  return false;
+}
+
+}  // namespace pcapng_slicer
@@ -0,0 +1,249 @@
+#include "block_parsing.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+
+#include "block_types.h"
+#include "pcapng_slicer/error_type.h"
+#include "read_utils.h"
+
+namespace pcapng_slicer {
+namespace {
+
+// Calls `function.template operator()<kSwapped>()` specialised on the byte order of the section.
+template <typename Function>
+decltype(auto) DispatchByteOrder(bool swapped, Function&& function) {
+  return swapped ? function.template operator()<true>() : function.template operator()<false>();
+}
+
+}  // namespace
+
+Result<BlockHeader> PeekBlockHeader(std::span<const uint8_t> header, bool swapped) {
+  BlockHeader result;
+  uint32_t magic;
+  std::memcpy(&result, header.data(), sizeof(result));
+  std::memcpy(&magic, header.data() + sizeof(result), sizeof(magic));
+
+  uint32_t min_length = kEmptyBlockSize;
+  if (result.type == static_cast<uint32_t>(PcapngBlockType::kSectionHeader)) {
+    if (magic != kByteOrderMagic && magic != ByteSwap(kByteOrderMagic)) {
+      return ErrorType::kInvalidBlockDetected;
+    }
+    swapped = magic != kByteOrderMagic;
+    min_length += sizeof(magic);
+  }
+  if (swapped) {
+    result.type = ByteSwap(result.type);
+    result.total_length = ByteSwap(result.total_length);
+  }
+  if (result.total_length % kBlockAlignment != 0 || result.total_length < min_length) {
+    return ErrorType::kInvalidBlockSize;
+  }
+  return result;
+}
+
+//                         1                   2                   3
+//     0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//  0 |                   Block Type = 0x0A0D0D0A                     |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//  4 |                      Block Total Length                       |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//  8 |                      Byte-Order Magic                         |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+// 12 |          Major Version        |         Minor Version         |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+// 16 |                                                               |
+//    |                       Section Length                          |
+//    |                                                               |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+// 24 /                                                               /
+//    /                      Options (variable)                       /
+//    /                                                               /
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//    |                      Block Total Length                       |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+Result<std::shared_ptr<SectionPrivate>> ParseSectionHeaderBlock(BlockData data,
+                                                                uint64_t block_position) {
+  auto section = std::make_shared<SectionPrivate>();
+  section->data = std::move(data);
+
+  std::span<const uint8_t> data_slice = section->data.view();
+  if (data_slice.size() < 4 * sizeof(uint32_t)) {
+    return ErrorType::kInvalidBlockSize;
+  }
+
+  // Every field of the section is in the byte order of the host which has written it.
+  const auto magic = CastValue<uint32_t>(data_slice);
+  if (magic != kByteOrderMagic && magic != ByteSwap(kByteOrderMagic)) {
+    return ErrorType::kInvalidBlockDetected;
+  }
+  section->swapped = magic != kByteOrderMagic;
+
+  section->block_position = block_position;
+  DispatchByteOrder(section->swapped, [&]<bool kSwapped>() {
+    section->version_major = CastValue<uint16_t, kSwapped>(data_slice.subspan(4));
+    section->version_minor = CastValue<uint16_t, kSwapped>(data_slice.subspan(6));
+    section->section_length = CastValue<uint64_t, kSwapped>(data_slice.subspan(8));
+  });
+
+  return section;
+}
+
+//                         1                   2                   3
+//     0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//  0 |                    Block Type = 0x00000001                    |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//  4 |                      Block Total Length                       |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//  8 |           LinkType            |           Reserved            |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+// 12 |                            SnapLen                            |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+// 16 /                                                               /
+//    /                      Options (variable)                       /
+//    /                                                               /
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//    |                      Block Total Length                       |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+Result<std::shared_ptr<InterfacePrivate>> ParseInterfaceBlock(const SectionPrivate& section,
+                                                              BlockData data,
+                                                              uint64_t block_position) {
+  auto interface = std::make_shared<InterfacePrivate>();
+  interface->data = std::move(data);
+
+  std::span<const uint8_t> data_slice = interface->data.view();
+  if (data_slice.size() < 2 * sizeof(uint32_t)) {
+    return ErrorType::kInvalidBlockSize;
+  }
+
+  interface->block_position = block_position;
+  interface->swapped = section.swapped;
+  interface->link_type = CastValue<uint16_t>(data_slice, section.swapped);
+  interface->snap_len = CastValue<uint32_t>(data_slice.subspan(4), section.swapped);
+  if (interface->snap_len == 0) {
+    interface->snap_len = std::numeric_limits<uint32_t>::max();
+  }
+
+  // Timestamp options are parsed once here, so that packets are converted without looking at them.
+  for (const OptionView& option : OptionsView(data_slice.subspan(8), section.swapped)) {
+    if (option.GetCode() == kIfTsresol) {
+      if (option.GetRawData().size() != sizeof(uint8_t)) {
+        return ErrorType::kInvalidOptionSize;
+      }
+      interface->SetTimestampResolution(option.GetRawData()[0]);
+    } else if (option.GetCode() == kIfTsoffset) {
+      const std::optional<uint64_t> offset = option.GetUint64();
+      if (!offset) {
+        return ErrorType::kInvalidOptionSize;
+      }
+      interface->SetTimestampOffset(static_cast<int64_t>(*offset));
+    }
+  }
+
+  return interface;
+}
+
+//                         1                   2                   3
+//     0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//  0 |                    Block Type = 0x00000003                    |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//  4 |                      Block Total Length                       |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//  8 |                    Original Packet Length                     |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+// 12 /                                                               /
+//    /                          Packet Data                          /
+//    /              variable length, padded to 32 bits               /
+//    /                                                               /
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//    |                      Block Total Length                       |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ErrorType ParseSimplePacketBlock(SectionPrivate& section, SimplePacketPrivate& packet) {
+  if (section.GetInterfaceCount() == 0) {
+    return ErrorType::kInvalidInterfaceForPacket;
+  }
+
+  packet.interface = section.GetInterface(0);
+  if (packet.data.size() < sizeof(uint32_t)) {
+    return ErrorType::kInvalidBlockSize;
+  }
+
+  packet.original_length = CastValue<uint32_t>(packet.data.view(), section.swapped);
+  if (std::min(packet.original_length, packet.interface->snap_len) >
+      packet.data.size() - sizeof(uint32_t)) {
+    return ErrorType::kInvalidBlockSize;
+  }
+  return ErrorType::kNoError;
+}
+
+//                         1                   2                   3
+//     0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//  0 |                    Block Type = 0x00000006                    |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//  4 |                      Block Total Length                       |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//  8 |                         Interface ID                          |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+// 12 |                        Timestamp (High)                       |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+// 16 |                        Timestamp (Low)                        |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+// 20 |                    Captured Packet Length                     |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+// 24 |                    Original Packet Length                     |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+// 28 /                                                               /
+//    /                          Packet Data                          /
+//    /              variable length, padded to 32 bits               /
+//    /                                                               /
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//    /                                                               /
+//    /                      Options (variable)                       /
+//    /                                                               /
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//    |                      Block Total Length                       |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+template <bool kSwapped>
+ErrorType ParseEnchansedPacketBlockImpl(SectionPrivate& section, EnchansedPacketPrivate& packet) {
+  std::span<const uint8_t> packet_data_slice = packet.data.view();
+  if (packet_data_slice.size() < EnchansedPacketPrivate::kRequiredSize) {
+    return ErrorType::kInvalidBlockSize;
+  }
+
+  // All of the fixed fields are read (and swapped if needed) at once.
+  const auto [iface_id, timestamp_high, timestamp_low, captured_length, original_length] =
+      CastWords<5, kSwapped>(packet_data_slice);
+  if (iface_id >= section.GetInterfaceCount()) {
+    return ErrorType::kInvalidInterfaceForPacket;
+  }
+  packet.interface = section.GetInterface(iface_id);
+  packet.timestamp = (uint64_t{timestamp_high} << 32 | timestamp_low);
+
+  if (captured_length > packet_data_slice.size() - EnchansedPacketPrivate::kRequiredSize) {
+    return ErrorType::kInvalidBlockSize;
+  }
+
+  packet.original_length = original_length;
+  packet.packet_data_slice =
+      packet_data_slice.subspan(EnchansedPacketPrivate::kRequiredSize, captured_length);
+  packet.options_data_slice = packet_data_slice.subspan(
+      EnchansedPacketPrivate::kRequiredSize + captured_length + GetPaddingToOctet(captured_length));
+  return ErrorType::kNoError;
+}
+
+ErrorType ParseEnchansedPacketBlock(SectionPrivate& section, EnchansedPacketPrivate& packet) {
+  return DispatchByteOrder(section.swapped, [&]<bool kSwapped>() {
+    return ParseEnchansedPacketBlockImpl<kSwapped>(section, packet);
+  });
+}
+
+}  // namespace pcapng_slicer
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+
+#include "block_data.h"
+#include "block_types.h"
+#include "interface_private.h"
+#include "packet_private.h"
+#include "pcapng_slicer/error_type.h"
+#include "result.h"
+#include "section_private.h"
+
+// Parsing of the block bodies which is shared by all of the readers. All of the functions return
+// the error if the block is malformed, they never throw it.
+namespace pcapng_slicer {
+
+// Returns the type and the total length of the block starting with `header`, which holds at least
+// the first kEmptyBlockSize bytes of the block: the type, the length and the Byte-Order Magic if
+// the block is a section header. `swapped` is the byte order of the current section, section
+// headers define their own one. Used to find out how much data the block needs before reading it.
+Result<BlockHeader> PeekBlockHeader(std::span<const uint8_t> header, bool swapped);
+// Sets the byte order of the section according to its Byte-Order Magic, all of the following
+// blocks of the section are parsed accordingly.
+Result<std::shared_ptr<SectionPrivate>> ParseSectionHeaderBlock(BlockData data,
+                                                                uint64_t block_position);
+Result<std::shared_ptr<InterfacePrivate>> ParseInterfaceBlock(const SectionPrivate& section,
+                                                              BlockData data,
+                                                              uint64_t block_position);
+// Packet parsing functions expect the block body to be already read into `packet.data`.
+ErrorType ParseSimplePacketBlock(SectionPrivate& section, SimplePacketPrivate& packet);
+ErrorType ParseEnchansedPacketBlock(SectionPrivate& section, EnchansedPacketPrivate& packet);
+
+}  // namespace pcapng_slicer
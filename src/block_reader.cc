@@ -2,13 +2,14 @@
 
 #include <cassert>
 #include <cstdint>
+#include <cstring>
+#include <type_traits>
 #include <utility>
-#include <vector>
 
-#include "error.h"
-
-constexpr uint32_t kBlockAlignment = 4;
-constexpr uint32_t kEmptyBlockSize = 12;
+#include "block_parsing.h"
+#include "block_types.h"
+#include "read_utils.h"
+#include "scoped_timer.h"
 
 namespace pcapng_slicer {
 
@@ -26,106 +27,220 @@ namespace pcapng_slicer {
 //    |                      Block Total Length                       |
 //    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
 
-BlockReader::BlockReader(const std::filesystem::path& path) {
-  if (!std::filesystem::exists(path)) {
-    CloseAndThrow(ErrorType::kFileNotFound);
-  }
-  file_.open(path, std::ios::binary);
-  if (!file_) {
-    CloseAndThrow(ErrorType::kUnableToOpenFile);
-  }
+BlockReader::BlockReader(std::unique_ptr<DataSource> source, ReaderCounters* counters,
+                         bool follow)
+    : source_(std::move(source)), counters_(counters), follow_(follow) {
+  assert(source_);
 }
 
 ScopedBlock BlockReader::ReadBlock() {
   assert(IsValid() && !IsEof());
   assert(!has_scoped_block_);
 
-  const BlockHeader header = ReadBlockHeader();
-  if (header.total_length % kBlockAlignment != 0 || header.total_length < kEmptyBlockSize) {
-    CloseAndThrow(ErrorType::kInvalidBlockSize);
+  ScopedTimer timer(counters_, &ReaderStats::io_time_ns);
+  const Result<BlockHeader> header = ReadBlockHeader();
+  if (!header) {
+    return ScopedBlock(header.error());
   }
+  const uint32_t min_length = kEmptyBlockSize + (section_magic_ ? sizeof(uint32_t) : 0);
+  if (header->total_length % kBlockAlignment != 0 || header->total_length < min_length) {
+    return ScopedBlock(Close(ErrorType::kInvalidBlockSize));
+  }
+  if (counters_) {
+    CountBlock(*header);
+  }
+
+  return ScopedBlock(*header, block_position_, *this);
+}
 
-  return ScopedBlock(header, block_position_, *this);
+// A closed reader has nothing more to read.
+bool BlockReader::IsEof() {
+  if (!source_) {
+    return true;
+  }
+  return follow_ ? !WaitForBlock() : source_->IsEof();
 }
 
-bool BlockReader::IsEof() const {
+bool BlockReader::IsValid() const { return !!source_; }
+
+bool BlockReader::Seek(uint64_t offset) {
   assert(IsValid());
-  return file_.eof() || file_.peek() == std::char_traits<char>::eof();
+  assert(!has_scoped_block_);
+  if (!source_->Seek(offset)) {
+    return false;
+  }
+  block_position_ = offset;
+  section_magic_.reset();
+  return true;
 }
 
-bool BlockReader::IsValid() const { return !!file_; }
+std::optional<uint64_t> BlockReader::DataSize() const {
+  assert(IsValid());
+  return source_->Size();
+}
+
+// The block is read only once it is complete, so a block being written is neither mistaken for a
+// truncated one nor read twice. Its header is peeked to find out the length.
+bool BlockReader::WaitForBlock() {
+  const auto header = source_->WaitForData(kEmptyBlockSize);
+  if (!header) {
+    return false;
+  }
+  const Result<BlockHeader> peeked = PeekBlockHeader(*header, swapped_);
+  if (!peeked) {
+    return true;
+  }
+  return source_->WaitForData(peeked->total_length).has_value();
+}
 
-BlockHeader BlockReader::ReadBlockHeader() {
+Result<BlockHeader> BlockReader::ReadBlockHeader() {
   static_assert(sizeof(BlockHeader) == 8, "BlockHeader must be 8 bytes long");
-  BlockHeader result = ReadAs<BlockHeader>();
+  BlockHeader result;
+  if (!ReadAs(result)) {
+    return error_;
+  }
+
+  // Section header type is the same in both byte orders. The byte order of its length (and of all
+  // of the following blocks of the section) is defined by the Byte-Order Magic, which follows it.
+  section_magic_.reset();
+  if (result.type == static_cast<uint32_t>(PcapngBlockType::kSectionHeader)) {
+    uint32_t magic;
+    if (!ReadAs(magic)) {
+      return error_;
+    }
+    if (magic != kByteOrderMagic && magic != ByteSwap(kByteOrderMagic)) {
+      return Close(ErrorType::kInvalidBlockDetected);
+    }
+    swapped_ = magic != kByteOrderMagic;
+    section_magic_ = magic;
+  }
+
+  if (swapped_) {
+    result.type = ByteSwap(result.type);
+    result.total_length = ByteSwap(result.total_length);
+  }
   return result;
 }
 
-std::vector<uint8_t> BlockReader::ReadBlockData(uint32_t length) {
-  assert(IsValid() && !IsEof());
+ErrorType BlockReader::ReadBlockData(uint32_t length, BlockData& data) {
+  assert(IsValid());
   assert(length >= kEmptyBlockSize);
 
+  ScopedTimer timer(counters_, &ReaderStats::io_time_ns);
   const size_t block_data_size = length - kEmptyBlockSize;
-  std::vector<uint8_t> data(block_data_size);
-  file_.read(reinterpret_cast<char*>(data.data()), block_data_size);
-  if (file_.gcount() != block_data_size) {
-    CloseAndThrow(ErrorType::kTruncatedFile);
+  if (section_magic_) {
+    // The magic was read together with the header, so it's put back in front of the body.
+    const auto body = AllocateBody(data, block_data_size);
+    std::memcpy(body.data(), &*section_magic_, sizeof(uint32_t));
+    if (source_->Read(body.subspan(sizeof(uint32_t))) != block_data_size - sizeof(uint32_t)) {
+      return Close(ErrorType::kTruncatedFile);
+    }
+  } else if (auto view = source_->View(block_data_size)) {
+    data.Borrow(*view, source_->ViewOwner());
+  } else if (source_->Read(AllocateBody(data, block_data_size)) != block_data_size) {
+    return Close(ErrorType::kTruncatedFile);
   }
 
-  ValidateTailLengthIfNeeded(length);
-  ++block_position_;
-
-  return data;
+  block_position_ += length;
+  return ValidateTailLengthIfNeeded(length);
 }
 
+// Errors are kept by the reader.
 void BlockReader::SkipBlockData(uint32_t length) {
-  if (!IsValid() || IsEof()) {
+  if (!IsValid()) {
     return;
   }
 
-  const uint32_t block_data_size = length - kEmptyBlockSize;
-  file_.ignore(block_data_size);
-  ValidateTailLengthIfNeeded(length);
-  ++block_position_;
+  ScopedTimer timer(counters_, &ReaderStats::io_time_ns);
+  const uint32_t block_data_size =
+      length - kEmptyBlockSize - (section_magic_ ? sizeof(uint32_t) : 0);
+  if (source_->Skip(block_data_size) != block_data_size) {
+    Close(ErrorType::kTruncatedFile);
+    return;
+  }
+  block_position_ += length;
+  static_cast<void>(ValidateTailLengthIfNeeded(length));
 }
 
-void BlockReader::ValidateTailLengthIfNeeded(uint32_t length) {
-  assert(IsValid() && !IsEof());
+ErrorType BlockReader::ValidateTailLengthIfNeeded(uint32_t length) {
+  assert(IsValid());
   if (!validate_block_length_) {
-    file_.ignore(sizeof(uint32_t));
-    return;
+    if (source_->Skip(sizeof(uint32_t)) != sizeof(uint32_t)) {
+      return Close(ErrorType::kTruncatedFile);
+    }
+    return ErrorType::kNoError;
   }
 
-  const uint32_t tail_length = ReadAs<uint32_t>();
-  if (tail_length != length) {
-    CloseAndThrow(ErrorType::kInvalidBlockSize);
+  uint32_t tail_length;
+  if (!ReadAs(tail_length)) {
+    return error_;
+  }
+  if ((swapped_ ? ByteSwap(tail_length) : tail_length) != length) {
+    return Close(ErrorType::kInvalidBlockSize);
   }
+  return ErrorType::kNoError;
 }
 
-void BlockReader::CloseAndThrow(ErrorType type) {
-  file_.close();
-  throw Error{type};
+std::span<uint8_t> BlockReader::AllocateBody(BlockData& data, size_t size) {
+  if (counters_ && data.capacity() < size) {
+    counters_->Add(&ReaderStats::buffer_allocations_count);
+  }
+  return data.Allocate(size);
+}
+
+void BlockReader::CountBlock(const BlockHeader& header) {
+  switch (header.type) {
+    case static_cast<uint32_t>(PcapngBlockType::kSectionHeader):
+      counters_->Add(&ReaderStats::section_headers_count);
+      break;
+    case static_cast<uint32_t>(PcapngBlockType::kInterfaceDescription):
+      counters_->Add(&ReaderStats::interfaces_count);
+      break;
+    case static_cast<uint32_t>(PcapngBlockType::kSimplePacket):
+      counters_->Add(&ReaderStats::simple_packets_count);
+      break;
+    case static_cast<uint32_t>(PcapngBlockType::kEnchancedPacket):
+      counters_->Add(&ReaderStats::enhanced_packets_count);
+      break;
+    default:
+      counters_->Add(&ReaderStats::unknown_blocks_count);
+      break;
+  }
+  counters_->Add(&ReaderStats::bytes_read, header.total_length);
+}
+
+ErrorType BlockReader::Close(ErrorType error) {
+  // Data may end prematurely because the source has failed, its error is more precise.
+  if (error == ErrorType::kTruncatedFile && source_->LastError() != ErrorType::kNoError) {
+    error = source_->LastError();
+  }
+  source_.reset();
+  error_ = error;
+  return error;
 }
 
 template <typename T>
-T BlockReader::ReadAs() {
-  static_assert(std::copy_constructible<T>, "T must be an copyt constructible type");
-  assert(!!file_);
+bool BlockReader::ReadAs(T& value) {
+  static_assert(std::is_trivially_copyable_v<T>, "T must be a trivially copyable type");
+  assert(IsValid());
 
-  T value;
-  file_.read(reinterpret_cast<char*>(&value), sizeof(T));
-  if (file_.gcount() != sizeof(T)) {
-    CloseAndThrow(ErrorType::kTruncatedFile);
+  if (source_->Read(std::span(reinterpret_cast<uint8_t*>(&value), sizeof(T))) != sizeof(T)) {
+    Close(ErrorType::kTruncatedFile);
+    return false;
   }
-  return value;
+  return true;
 }
 
 ScopedBlock::ScopedBlock(BlockHeader header, uint64_t block_position, BlockReader& block_reader)
-    : header_(header), block_position_(block_position), block_reader_(&block_reader) {
+    : block_position_(block_position), header_(header), block_reader_(&block_reader) {
   assert(!std::exchange(block_reader_->has_scoped_block_, true) &&
          "Only one instance of ScopedBlock for a single BlockReader is allowed");
 }
 
+ScopedBlock::ScopedBlock(ErrorType error) : error_(error) {
+  assert(error != ErrorType::kNoError);
+}
+
 ScopedBlock::~ScopedBlock() {
   assert(!block_reader_ || std::exchange(block_reader_->has_scoped_block_, false));
   if (block_reader_ && block_reader_->IsValid()) {
@@ -138,11 +253,17 @@ uint32_t ScopedBlock::Length() const {
   return header_.total_length - kEmptyBlockSize;
 }
 
-std::vector<uint8_t> ScopedBlock::ReadData() {
+ErrorType ScopedBlock::ReadData(BlockData& data) {
   assert(block_reader_);
-  std::vector<uint8_t> result = block_reader_->ReadBlockData(header_.total_length);
+  const ErrorType error = block_reader_->ReadBlockData(header_.total_length, data);
   PreventPostReading();
-  return result;
+  return error;
+}
+
+BlockData ReadDataOrThrow(ScopedBlock& block) {
+  BlockData data;
+  ThrowIfError(block.ReadData(data));
+  return data;
 }
 
 void ScopedBlock::PreventPostReading() {
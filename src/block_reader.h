@@ -1,27 +1,28 @@
 #pragma once
 
 #include <cstdint>
-#include <filesystem>
-#include <fstream>
-#include <vector>
+#include <memory>
+#include <optional>
+#include <span>
 
+#include "block_data.h"
+#include "block_types.h"
+#include "data_source.h"
 #include "pcapng_slicer/error_type.h"
+#include "pcapng_slicer/stats.h"
+#include "result.h"
 
 namespace pcapng_slicer {
 
 class BlockReader;
 
-struct BlockHeader {
-  uint32_t type;
-  uint32_t total_length;
-};
-
 // Scoped block represents a single block of pcapng file, the reading of a block body is deferred
 // until it is needed. If body reading isn't necessary then the body reading will be skipped. It
-// must never outlive it's BlockReader.
+// must never outlive it's BlockReader. A block which failed to be read holds just the error.
 class ScopedBlock {
  public:
   ScopedBlock(BlockHeader header, uint64_t block_position, BlockReader& block_reader);
+  explicit ScopedBlock(ErrorType error);
   ~ScopedBlock();
 
   ScopedBlock(const ScopedBlock&) = delete;
@@ -30,45 +31,86 @@ class ScopedBlock {
   ScopedBlock& operator=(ScopedBlock&&) = delete;
 
   uint32_t Length() const;
-  std::vector<uint8_t> ReadData();
+  // Reads the block body into `data`, reusing its storage.
+  ErrorType ReadData(BlockData& data);
   void PreventPostReading();
 
+  // The error of reading the block header, the rest of the accessors are valid only if there is no
+  // error.
+  ErrorType error() const { return error_; }
+  // Offset of the block from the beginning of the data.
   uint64_t position() const { return block_position_; }
   uint32_t type() const { return header_.type; }
 
  private:
-  uint64_t block_position_;
-  BlockHeader header_;
-  BlockReader* block_reader_;
+  uint64_t block_position_ = 0;
+  BlockHeader header_ = {};
+  BlockReader* block_reader_ = nullptr;
+  ErrorType error_ = ErrorType::kNoError;
 };
 
-// This class is responsible for reading blocks from a file. It will position itself over the start
-// of the block and will provide to the user the main info about the block. It responsibility of the
-// caller to parse block contents.
+// Reads the body of the block and returns it, throws Error if reading fails. For the code which
+// handles errors by exceptions.
+BlockData ReadDataOrThrow(ScopedBlock& block);
+
+// This class is responsible for reading blocks from a data source. It will position itself over the
+// start of the block and will provide to the user the main info about the block. It responsibility
+// of the caller to parse block contents.
+//
+// Errors are returned rather than thrown, as truncated and corrupted files are common. Any error
+// closes the data source, after which the reader is no longer valid and LastError() returns it.
 class BlockReader {
  public:
-  BlockReader(const std::filesystem::path& path);
+  // Blocks and the time spent reading them are counted by the `counters`, if there are any. In the
+  // `follow` mode the source must support DataSource::WaitForData().
+  explicit BlockReader(std::unique_ptr<DataSource> source, ReaderCounters* counters = nullptr,
+                       bool follow = false);
 
   // Warning: reading block while other block is alive is en error.
   ScopedBlock ReadBlock();
-  bool IsEof() const;
+  // In the follow mode waits until the next block is written completely, and reports the end of
+  // data if it isn't written in time.
+  bool IsEof();
   bool IsValid() const;
+  // The error which has closed the reader, it may happen while skipping the body of a block.
+  ErrorType LastError() const { return error_; }
+  // Moves to the block at `offset` from the beginning of the data. Returns false if the data source
+  // doesn't support seeking.
+  bool Seek(uint64_t offset);
+  std::optional<uint64_t> DataSize() const;
 
  private:
   friend class ScopedBlock;
 
-  BlockHeader ReadBlockHeader();
-  std::vector<uint8_t> ReadBlockData(uint32_t length);
+  // Returns true once the next block is available as a whole, or its header is invalid, so the
+  // error is reported by ReadBlock().
+  bool WaitForBlock();
+  Result<BlockHeader> ReadBlockHeader();
+  ErrorType ReadBlockData(uint32_t length, BlockData& data);
   void SkipBlockData(uint32_t length);
-  void ValidateTailLengthIfNeeded(uint32_t length);
-  void CloseAndThrow(ErrorType type);
-
+  ErrorType ValidateTailLengthIfNeeded(uint32_t length);
+  // Allocates the body in `data`, counting the reallocation of its storage.
+  std::span<uint8_t> AllocateBody(BlockData& data, size_t size);
+  void CountBlock(const BlockHeader& header);
+  // Closes the reader and returns the error to be reported.
+  ErrorType Close(ErrorType error);
+
+  // Reads the value, returns false if the data has ended and the reader was closed.
   template <typename T>
-  T ReadAs();
+  bool ReadAs(T& value);
 
-  mutable std::ifstream file_;
+  std::unique_ptr<DataSource> source_;
+  ReaderCounters* counters_;
+  bool follow_;
+  // Offset of the next block from the beginning of the data.
   uint64_t block_position_ = 0;
   bool validate_block_length_ = false;
+  // Byte order of the current section.
+  bool swapped_ = false;
+  // Byte-Order Magic of the current block if it is a section header. It is read in advance to find
+  // out the byte order of the block length.
+  std::optional<uint32_t> section_magic_;
+  ErrorType error_ = ErrorType::kNoError;
 
 #ifndef NDEBUG
   bool has_scoped_block_ = false;
@@ -1,7 +1,31 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 namespace pcapng_slicer {
 
+// Every block starts at the offset aligned to this value.
+constexpr uint32_t kBlockAlignment = 4;
+// Size of a block without body: type and two lengths.
+constexpr uint32_t kEmptyBlockSize = 12;
+
+// Codes of the interface description block options.
+constexpr uint16_t kIfTsresol = 9;
+constexpr uint16_t kIfTsoffset = 14;
+// Timestamp resolution of an interface without if_tsresol option, microseconds.
+constexpr uint8_t kDefaultTimestampResolution = 6;
+
+// Section header body starts with Byte-Order Magic, versions and Section Length.
+constexpr size_t kSectionLengthOffset = 8;
+// Section Length of a section, which may be extended by other blocks.
+constexpr uint64_t kUnspecifiedSectionLength = 0xFFFFFFFFFFFFFFFF;
+
+struct BlockHeader {
+  uint32_t type;
+  uint32_t total_length;
+};
+
 enum class PcapngBlockType {
   kSectionHeader = 0x0A0D0D0A,
   kInterfaceDescription = 0x00000001,
@@ -0,0 +1,270 @@
+#include "block_writer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#include "compressing_flusher.h"
+#include "error.h"
+#include "output_file.h"
+#include "scoped_timer.h"
+
+namespace pcapng_slicer {
+namespace {
+
+// In gather mode smaller pieces are copied, as referencing them would cost more than the copy.
+constexpr size_t kMinExternalPartSize = 64;
+// Parts are written once there are that many of them, so a gather-write doesn't get too long.
+constexpr size_t kMaxGatherParts = 1024;
+
+}  // namespace
+
+// Writes submitted buffers into the sink on its own thread.
+class BackgroundFlusher : public BufferFlusher {
+ public:
+  BackgroundFlusher(OutputSink& sink, size_t buffers_count, size_t buffer_size) : sink_(sink) {
+    free_buffers_.resize(buffers_count);
+    for (auto& buffer : free_buffers_) {
+      buffer.reserve(buffer_size);
+    }
+    thread_ = std::thread([this] { Run(); });
+  }
+
+  // Buffers which are not written yet are discarded.
+  ~BackgroundFlusher() override {
+    {
+      std::lock_guard lock(mutex_);
+      stop_ = true;
+    }
+    submitted_cv_.notify_one();
+    thread_.join();
+  }
+
+  BackgroundFlusher(const BackgroundFlusher&) = delete;
+  BackgroundFlusher& operator=(const BackgroundFlusher&) = delete;
+  BackgroundFlusher(BackgroundFlusher&&) = delete;
+  BackgroundFlusher& operator=(BackgroundFlusher&&) = delete;
+
+  // BufferFlusher overrides:
+  std::optional<std::vector<uint8_t>> AcquireBuffer(bool wait) override {
+    std::unique_lock lock(mutex_);
+    if (wait) {
+      written_cv_.wait(lock, [this] { return failed_ || !free_buffers_.empty(); });
+    }
+    if (failed_) {
+      throw Error(ErrorType::kWriteError);
+    }
+    if (free_buffers_.empty()) {
+      return std::nullopt;
+    }
+    auto buffer = std::move(free_buffers_.back());
+    free_buffers_.pop_back();
+    return buffer;
+  }
+
+  void Submit(std::vector<uint8_t> buffer) override {
+    {
+      std::lock_guard lock(mutex_);
+      submitted_buffers_.push_back(std::move(buffer));
+    }
+    submitted_cv_.notify_one();
+  }
+
+  void Wait() override {
+    std::unique_lock lock(mutex_);
+    written_cv_.wait(lock, [this] { return submitted_buffers_.empty() && !writing_; });
+    if (failed_) {
+      throw Error(ErrorType::kWriteError);
+    }
+  }
+
+ private:
+  void Run() {
+    std::unique_lock lock(mutex_);
+    while (true) {
+      submitted_cv_.wait(lock, [this] { return stop_ || !submitted_buffers_.empty(); });
+      if (stop_) {
+        return;
+      }
+      auto buffer = std::move(submitted_buffers_.front());
+      submitted_buffers_.pop_front();
+      writing_ = true;
+
+      // After a failure the data is just discarded, the error is reported to the caller.
+      if (!failed_) {
+        lock.unlock();
+        bool failed = false;
+        try {
+          WriteOrThrow(sink_, buffer);
+        } catch (const Error&) {
+          failed = true;
+        }
+        lock.lock();
+        failed_ = failed_ || failed;
+      }
+
+      buffer.clear();
+      free_buffers_.push_back(std::move(buffer));
+      writing_ = false;
+      written_cv_.notify_one();
+    }
+  }
+
+  OutputSink& sink_;
+  std::mutex mutex_;
+  std::condition_variable submitted_cv_;
+  std::condition_variable written_cv_;
+  std::vector<std::vector<uint8_t>> free_buffers_;
+  std::deque<std::vector<uint8_t>> submitted_buffers_;
+  bool writing_ = false;
+  bool failed_ = false;
+  bool stop_ = false;
+  std::thread thread_;
+};
+
+BlockWriter::BlockWriter(std::unique_ptr<OutputSink> sink, const WriterConfig& config)
+    : sink_(std::move(sink)),
+      buffer_size_(std::max<size_t>(config.buffer_size, 1)),
+      drop_on_overflow_(config.overflow_policy == OverflowPolicy::kDrop),
+      compressed_(config.compression != OutputCompression::kNone),
+      gather_(config.gather_writes && !compressed_),
+      counters_(config.counters.get()) {
+  if (compressed_) {
+    // Every compressing thread may hold a buffer, while the writer fills one more.
+    const size_t buffers_count =
+        std::max<size_t>(config.buffers_count, std::max<size_t>(config.compression_threads, 1) + 1);
+    flusher_ =
+        std::make_unique<CompressingFlusher>(*sink_, config, buffers_count - 1, buffer_size_);
+  } else if (config.mode == WriteMode::kAsynchronous && !gather_) {
+    // One of the buffers is always owned by the writer.
+    const size_t buffers_count = std::max<size_t>(config.buffers_count, 2);
+    flusher_ = std::make_unique<BackgroundFlusher>(*sink_, buffers_count - 1, buffer_size_);
+  }
+  buffer_.reserve(buffer_size_);
+}
+
+BlockWriter::~BlockWriter() = default;
+
+bool BlockWriter::BeginBlock(size_t size) {
+  // Blocks which don't fit into the buffer at all are written directly by Write(). Gather mode has
+  // no buffers to wait for.
+  if (gather_ || buffer_.size() + size <= buffer_size_ || size > buffer_size_) {
+    return true;
+  }
+  return SubmitBuffer(/*wait=*/!drop_on_overflow_);
+}
+
+void BlockWriter::Write(std::span<const uint8_t> data) {
+  if (gather_) {
+    AddPart(data);
+    return;
+  }
+  if (buffer_.size() + data.size() > buffer_size_) {
+    // Compressed data must go through the flusher, so large blocks are put into a buffer of their
+    // own, which grows to fit them.
+    if (data.size() > buffer_size_ && !compressed_) {
+      Flush();
+      ScopedTimer timer(counters_, &WriterStats::io_time_ns);
+      WriteOrThrow(*sink_, data);
+      if (counters_) {
+        counters_->Add(&WriterStats::direct_writes_count);
+      }
+      return;
+    }
+    if (!buffer_.empty()) {
+      SubmitBuffer(/*wait=*/true);
+    }
+  }
+  buffer_.insert(buffer_.end(), data.begin(), data.end());
+}
+
+void BlockWriter::Flush() {
+  // Parts are used only in gather mode, the buffer holds the copied ones.
+  if (!parts_.empty()) {
+    WriteParts();
+  } else if (!buffer_.empty()) {
+    SubmitBuffer(/*wait=*/true);
+  }
+  if (flusher_) {
+    ScopedTimer timer(counters_, &WriterStats::io_time_ns);
+    flusher_->Wait();
+  }
+}
+
+void BlockWriter::Sync() {
+  Flush();
+  ScopedTimer timer(counters_, &WriterStats::io_time_ns);
+  if (!sink_->Sync()) {
+    throw Error(ErrorType::kWriteError);
+  }
+  if (counters_) {
+    counters_->Add(&WriterStats::syncs_count);
+  }
+}
+
+void BlockWriter::Close() {
+  Sync();
+  flusher_.reset();
+  if (!sink_->Close()) {
+    throw Error(ErrorType::kWriteError);
+  }
+}
+
+bool BlockWriter::SubmitBuffer(bool wait) {
+  ScopedTimer timer(counters_, &WriterStats::io_time_ns);
+  if (!flusher_) {
+    WriteOrThrow(*sink_, buffer_);
+    buffer_.clear();
+  } else {
+    auto free_buffer = flusher_->AcquireBuffer(wait);
+    if (!free_buffer) {
+      return false;
+    }
+    flusher_->Submit(std::exchange(buffer_, std::move(*free_buffer)));
+  }
+  if (counters_) {
+    counters_->Add(&WriterStats::buffers_flushed_count);
+  }
+  return true;
+}
+
+void BlockWriter::AddPart(std::span<const uint8_t> data) {
+  if (data.size() >= kMinExternalPartSize) {
+    parts_.push_back({.external = data.data(), .size = data.size()});
+    has_external_parts_ = true;
+  } else {
+    // Adjacent copied pieces make a single part.
+    if (parts_.empty() || parts_.back().external) {
+      parts_.push_back({.offset = buffer_.size()});
+    }
+    parts_.back().size += data.size();
+    buffer_.insert(buffer_.end(), data.begin(), data.end());
+  }
+  if (buffer_.size() >= buffer_size_ || parts_.size() >= kMaxGatherParts) {
+    WriteParts();
+  }
+}
+
+void BlockWriter::WriteParts() {
+  ScopedTimer timer(counters_, &WriterStats::io_time_ns);
+  gather_spans_.clear();
+  const std::span<const uint8_t> buffer = buffer_;
+  for (const Part& part : parts_) {
+    gather_spans_.push_back(part.external ? std::span(part.external, part.size)
+                                          : buffer.subspan(part.offset, part.size));
+  }
+  WriteOrThrow(*sink_, gather_spans_);
+  parts_.clear();
+  buffer_.clear();
+  has_external_parts_ = false;
+  if (counters_) {
+    counters_->Add(&WriterStats::buffers_flushed_count);
+  }
+}
+
+}  // namespace pcapng_slicer
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "buffer_flusher.h"
+#include "pcapng_slicer/output_sink.h"
+#include "pcapng_slicer/writer.h"
+
+namespace pcapng_slicer {
+
+// This class is responsible for writing serialised blocks into a sink. Blocks are accumulated in a
+// large contiguous buffer, which is written into the sink with a single call once it gets full.
+// Data which doesn't fit into the buffer at all is written directly, bypassing the buffer.
+//
+// In asynchronous mode full buffers are handed over to a background thread and writing continues
+// into the next free buffer, so the caller doesn't wait for the disk as long as there are free
+// buffers.
+//
+// Compressed output is always written asynchronously: every buffer is compressed into a frame of
+// its own on a pool of threads, large blocks become frames of their own too.
+//
+// In gather mode only small pieces like block headers are copied into the buffer, the rest is kept
+// as references to the caller's data. The pieces are written by a single gather-write at the end of
+// every call of the Writer, see FinishCall(), as the referenced data isn't valid after it.
+class BlockWriter {
+ public:
+  BlockWriter(std::unique_ptr<OutputSink> sink, const WriterConfig& config);
+  ~BlockWriter();
+
+  BlockWriter(const BlockWriter&) = delete;
+  BlockWriter& operator=(const BlockWriter&) = delete;
+  BlockWriter(BlockWriter&&) = delete;
+  BlockWriter& operator=(BlockWriter&&) = delete;
+
+  // Makes sure that the block of `size` bytes may be written without waiting. Returns false if it
+  // is impossible and the block should be dropped according to the overflow policy.
+  bool BeginBlock(size_t size);
+  // In gather mode the data may be referenced until FinishCall(), so it mustn't be a temporary
+  // unless it is small enough to be copied.
+  void Write(std::span<const uint8_t> data);
+  template <typename T>
+  void WriteValue(const T& value) {
+    Write(std::span(reinterpret_cast<const uint8_t*>(&value), sizeof(T)));
+  }
+  // Called at the end of every call of the Writer. In gather mode writes the pieces referring to
+  // the caller's data, does nothing otherwise.
+  void FinishCall() {
+    if (has_external_parts_) {
+      WriteParts();
+    }
+  }
+  // Writes the buffered data into the sink and waits until it is written. Throws Error if writing
+  // fails.
+  void Flush();
+  // Same as above, but also waits until the data reaches the storage.
+  void Sync();
+  // Syncs and closes the sink.
+  void Close();
+
+ private:
+  // Piece of the data written in gather mode, either a reference to the caller's data or a range of
+  // the buffer, which may be reallocated until it is written.
+  struct Part {
+    const uint8_t* external = nullptr;
+    size_t offset = 0;
+    size_t size = 0;
+  };
+
+  // Hands the current buffer over for writing. Returns false if `wait` is false and there is no
+  // free buffer to continue with.
+  bool SubmitBuffer(bool wait);
+  void AddPart(std::span<const uint8_t> data);
+  // Writes all of the parts by a single gather-write.
+  void WriteParts();
+
+  std::unique_ptr<OutputSink> sink_;
+  std::unique_ptr<BufferFlusher> flusher_;
+  std::vector<uint8_t> buffer_;
+  size_t buffer_size_;
+  bool drop_on_overflow_;
+  bool compressed_;
+  bool gather_;
+  std::vector<Part> parts_;
+  bool has_external_parts_ = false;
+  // Storage of the spans passed to the sink, kept to reuse it.
+  std::vector<std::span<const uint8_t>> gather_spans_;
+  WriterCounters* counters_;
+};
+
+}  // namespace pcapng_slicer
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace pcapng_slicer {
+
+// Writes the buffers filled by BlockWriter into the sink on other threads. The number of buffers is
+// fixed, a written buffer is returned to the free list to be reused by the caller.
+class BufferFlusher {
+ public:
+  virtual ~BufferFlusher() = default;
+
+  // Returns an empty buffer. If there is no free buffer, either waits for it or returns nullopt.
+  // Throws Error if writing has failed.
+  virtual std::optional<std::vector<uint8_t>> AcquireBuffer(bool wait) = 0;
+  // Buffers are written in the order of submission.
+  virtual void Submit(std::vector<uint8_t> buffer) = 0;
+  // Waits until every submitted buffer is written. Throws Error if writing has failed.
+  virtual void Wait() = 0;
+};
+
+}  // namespace pcapng_slicer
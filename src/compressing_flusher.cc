@@ -0,0 +1,133 @@
+#include "compressing_flusher.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "error.h"
+#include "output_file.h"
+
+namespace pcapng_slicer {
+
+CompressingFlusher::CompressingFlusher(OutputSink& sink, const WriterConfig& config,
+                                       size_t buffers_count, size_t buffer_size)
+    : sink_(sink) {
+  // Every thread has its own compressor, as their contexts can't be shared.
+  const size_t threads_count = std::max<size_t>(config.compression_threads, 1);
+  for (size_t i = 0; i < threads_count; ++i) {
+    compressors_.push_back(CreateCompressor(config.compression, config.compression_level));
+  }
+
+  free_buffers_.resize(buffers_count);
+  for (auto& buffer : free_buffers_) {
+    buffer.reserve(buffer_size);
+  }
+  for (auto& compressor : compressors_) {
+    threads_.emplace_back([this, &compressor] { Run(*compressor); });
+  }
+}
+
+CompressingFlusher::~CompressingFlusher() {
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+  }
+  submitted_cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+std::optional<std::vector<uint8_t>> CompressingFlusher::AcquireBuffer(bool wait) {
+  std::unique_lock lock(mutex_);
+  if (wait) {
+    written_cv_.wait(lock, [this] { return failed_ || !free_buffers_.empty(); });
+  }
+  if (failed_) {
+    throw Error(ErrorType::kWriteError);
+  }
+  if (free_buffers_.empty()) {
+    return std::nullopt;
+  }
+  auto buffer = std::move(free_buffers_.back());
+  free_buffers_.pop_back();
+  return buffer;
+}
+
+void CompressingFlusher::Submit(std::vector<uint8_t> buffer) {
+  {
+    std::lock_guard lock(mutex_);
+    Job& job = jobs_.emplace_back(Job{.buffer = std::move(buffer)});
+    if (!free_frames_.empty()) {
+      job.frame = std::move(free_frames_.back());
+      free_frames_.pop_back();
+    }
+  }
+  submitted_cv_.notify_one();
+}
+
+void CompressingFlusher::Wait() {
+  std::unique_lock lock(mutex_);
+  written_cv_.wait(lock, [this] { return jobs_.empty(); });
+  if (failed_) {
+    throw Error(ErrorType::kWriteError);
+  }
+}
+
+void CompressingFlusher::Run(Compressor& compressor) {
+  std::unique_lock lock(mutex_);
+  while (true) {
+    submitted_cv_.wait(lock, [this] { return stop_ || next_job_ < jobs_.size(); });
+    if (stop_) {
+      return;
+    }
+    // References to the elements of a deque stay valid while other elements are added or removed
+    // at its ends.
+    Job& job = jobs_[next_job_++];
+
+    // After a failure the data is just discarded, the error is reported to the caller.
+    if (!failed_) {
+      lock.unlock();
+      bool failed = false;
+      try {
+        compressor.CompressFrame(job.buffer, job.frame);
+      } catch (const Error&) {
+        failed = true;
+      }
+      lock.lock();
+      failed_ = failed_ || failed;
+    }
+    job.compressed = true;
+    WriteFrames(lock);
+  }
+}
+
+void CompressingFlusher::WriteFrames(std::unique_lock<std::mutex>& lock) {
+  if (writing_) {
+    return;
+  }
+  writing_ = true;
+  while (!jobs_.empty() && jobs_.front().compressed) {
+    Job& job = jobs_.front();
+    if (!failed_ && !stop_) {
+      lock.unlock();
+      bool failed = false;
+      try {
+        WriteOrThrow(sink_, job.frame);
+      } catch (const Error&) {
+        failed = true;
+      }
+      lock.lock();
+      failed_ = failed_ || failed;
+    }
+
+    job.buffer.clear();
+    free_buffers_.push_back(std::move(job.buffer));
+    free_frames_.push_back(std::move(job.frame));
+    jobs_.pop_front();
+    --next_job_;
+    written_cv_.notify_one();
+  }
+  writing_ = false;
+}
+
+}  // namespace pcapng_slicer
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "buffer_flusher.h"
+#include "compressor.h"
+#include "pcapng_slicer/output_sink.h"
+#include "pcapng_slicer/writer.h"
+
+namespace pcapng_slicer {
+
+// Compresses every submitted buffer into an independent frame on a pool of threads and writes the
+// frames into the sink in the submission order. Buffers are compressed in parallel, but a frame is
+// written only after every frame preceding it, by whichever thread has finished it last.
+//
+//   written         compressed       compressing      compressing       pending
+//  +---------+  +--------------+  +--------------+  +-------------+  +------------+
+//  | frame 0 |  |   frame 1    |  |   buffer 2   |  |  buffer 3   |  |  buffer 4  |
+//  +---------+  +--------------+  +--------------+  +-------------+  +------------+
+class CompressingFlusher : public BufferFlusher {
+ public:
+  // Throws Error if the compression format of the `config` isn't supported.
+  CompressingFlusher(OutputSink& sink, const WriterConfig& config, size_t buffers_count,
+                     size_t buffer_size);
+  // Buffers which are not written yet are discarded.
+  ~CompressingFlusher() override;
+
+  CompressingFlusher(const CompressingFlusher&) = delete;
+  CompressingFlusher& operator=(const CompressingFlusher&) = delete;
+  CompressingFlusher(CompressingFlusher&&) = delete;
+  CompressingFlusher& operator=(CompressingFlusher&&) = delete;
+
+  // BufferFlusher overrides:
+  std::optional<std::vector<uint8_t>> AcquireBuffer(bool wait) override;
+  void Submit(std::vector<uint8_t> buffer) override;
+  void Wait() override;
+
+ private:
+  struct Job {
+    std::vector<uint8_t> buffer;
+    std::vector<uint8_t> frame;
+    bool compressed = false;
+  };
+
+  void Run(Compressor& compressor);
+  // Writes the compressed frames from the head of the queue. Only one thread writes at a time, the
+  // others just leave their frames to it.
+  void WriteFrames(std::unique_lock<std::mutex>& lock);
+
+  OutputSink& sink_;
+  std::vector<std::unique_ptr<Compressor>> compressors_;
+  std::mutex mutex_;
+  std::condition_variable submitted_cv_;
+  std::condition_variable written_cv_;
+  std::vector<std::vector<uint8_t>> free_buffers_;
+  // Frames of the written jobs, kept to reuse their storage.
+  std::vector<std::vector<uint8_t>> free_frames_;
+  // Jobs in the submission order, the ones from `next_job_` on are not taken by any thread yet.
+  std::deque<Job> jobs_;
+  size_t next_job_ = 0;
+  bool writing_ = false;
+  bool failed_ = false;
+  bool stop_ = false;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace pcapng_slicer
@@ -0,0 +1,138 @@
+#include "compressor.h"
+
+#include "error.h"
+
+#ifdef PCAPNG_SLICER_HAS_ZSTD
+#include <zstd.h>
+#endif
+#ifdef PCAPNG_SLICER_HAS_LZ4
+#include <lz4frame.h>
+#endif
+
+namespace pcapng_slicer {
+namespace {
+
+#ifdef PCAPNG_SLICER_HAS_ZSTD
+
+class ZstdCompressor : public Compressor {
+ public:
+  explicit ZstdCompressor(int level) : context_(ZSTD_createCCtx()) {
+    if (!context_) {
+      throw Error(ErrorType::kWriteError);
+    }
+    // The parameters are sticky, so they apply to every frame compressed by the context.
+    ZSTD_CCtx_setParameter(context_, ZSTD_c_compressionLevel, level);
+    ZSTD_CCtx_setParameter(context_, ZSTD_c_checksumFlag, 1);
+  }
+
+  ~ZstdCompressor() override { ZSTD_freeCCtx(context_); }
+
+  ZstdCompressor(const ZstdCompressor&) = delete;
+  ZstdCompressor& operator=(const ZstdCompressor&) = delete;
+  ZstdCompressor(ZstdCompressor&&) = delete;
+  ZstdCompressor& operator=(ZstdCompressor&&) = delete;
+
+  void CompressFrame(std::span<const uint8_t> data, std::vector<uint8_t>& frame) override {
+    frame.resize(ZSTD_compressBound(data.size()));
+    const size_t size =
+        ZSTD_compress2(context_, frame.data(), frame.size(), data.data(), data.size());
+    if (ZSTD_isError(size)) {
+      throw Error(ErrorType::kWriteError);
+    }
+    frame.resize(size);
+  }
+
+ private:
+  ZSTD_CCtx* context_;
+};
+
+#endif
+
+#ifdef PCAPNG_SLICER_HAS_LZ4
+
+class Lz4Compressor : public Compressor {
+ public:
+  explicit Lz4Compressor(int level) {
+    if (LZ4F_isError(LZ4F_createCompressionContext(&context_, LZ4F_VERSION))) {
+      throw Error(ErrorType::kWriteError);
+    }
+    preferences_.compressionLevel = level;
+    preferences_.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+  }
+
+  ~Lz4Compressor() override { LZ4F_freeCompressionContext(context_); }
+
+  Lz4Compressor(const Lz4Compressor&) = delete;
+  Lz4Compressor& operator=(const Lz4Compressor&) = delete;
+  Lz4Compressor(Lz4Compressor&&) = delete;
+  Lz4Compressor& operator=(Lz4Compressor&&) = delete;
+
+  void CompressFrame(std::span<const uint8_t> data, std::vector<uint8_t>& frame) override {
+    preferences_.frameInfo.contentSize = data.size();
+    frame.resize(LZ4F_compressFrameBound(data.size(), &preferences_));
+
+    // The context is reused for every frame, unlike with LZ4F_compressFrame().
+    size_t size = LZ4F_compressBegin(context_, frame.data(), frame.size(), &preferences_);
+    ThrowIfError(size);
+    const size_t data_size = LZ4F_compressUpdate(context_, frame.data() + size,
+                                                 frame.size() - size, data.data(), data.size(),
+                                                 nullptr);
+    ThrowIfError(data_size);
+    size += data_size;
+    const size_t end_size =
+        LZ4F_compressEnd(context_, frame.data() + size, frame.size() - size, nullptr);
+    ThrowIfError(end_size);
+    frame.resize(size + end_size);
+  }
+
+ private:
+  static void ThrowIfError(size_t result) {
+    if (LZ4F_isError(result)) {
+      throw Error(ErrorType::kWriteError);
+    }
+  }
+
+  LZ4F_cctx* context_ = nullptr;
+  LZ4F_preferences_t preferences_{};
+};
+
+#endif
+
+}  // namespace
+
+bool IsCompressionSupported(OutputCompression compression) {
+  switch (compression) {
+    case OutputCompression::kNone:
+      return true;
+    case OutputCompression::kZstd:
+#ifdef PCAPNG_SLICER_HAS_ZSTD
+      return true;
+#else
+      return false;
+#endif
+    case OutputCompression::kLz4:
+#ifdef PCAPNG_SLICER_HAS_LZ4
+      return true;
+#else
+      return false;
+#endif
+  }
+  return false;
+}
+
+std::unique_ptr<Compressor> CreateCompressor(OutputCompression compression, int level) {
+  switch (compression) {
+#ifdef PCAPNG_SLICER_HAS_ZSTD
+    case OutputCompression::kZstd:
+      return std::make_unique<ZstdCompressor>(level);
+#endif
+#ifdef PCAPNG_SLICER_HAS_LZ4
+    case OutputCompression::kLz4:
+      return std::make_unique<Lz4Compressor>(level);
+#endif
+    default:
+      throw Error(ErrorType::kUnsupportedCompression);
+  }
+}
+
+}  // namespace pcapng_slicer
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "pcapng_slicer/writer.h"
+
+namespace pcapng_slicer {
+
+// Compresses independent frames of a single compression format. Every frame may be decompressed on
+// its own, so frames compressed in parallel may be just concatenated.
+class Compressor {
+ public:
+  virtual ~Compressor() = default;
+
+  // Replaces the content of `frame` with the compressed `data`, reusing its storage. Throws Error
+  // if compression fails.
+  virtual void CompressFrame(std::span<const uint8_t> data, std::vector<uint8_t>& frame) = 0;
+};
+
+bool IsCompressionSupported(OutputCompression compression);
+// Throws Error if the library was built without support of the `compression`.
+std::unique_ptr<Compressor> CreateCompressor(OutputCompression compression, int level);
+
+}  // namespace pcapng_slicer
@@ -0,0 +1,67 @@
+#include "data_source.h"
+
+#include "async_file_source.h"
+#include "decompressing_source.h"
+#include "decompressor.h"
+#include "error.h"
+#include "file_stream_source.h"
+#include "following_file_source.h"
+#include "mapped_file_source.h"
+#include "stream_source.h"
+
+namespace pcapng_slicer {
+
+namespace {
+
+std::unique_ptr<DataSource> CreateRawFileSource(const std::filesystem::path& path,
+                                                const ReaderConfig& config) {
+  switch (config.backend) {
+    case ReadBackend::kMemoryMapped:
+      return std::make_unique<MappedFileSource>(path);
+    case ReadBackend::kAsync:
+      return std::make_unique<AsyncFileSource>(path, config.read_ahead_buffer_size,
+                                               config.read_ahead_buffers_count);
+    case ReadBackend::kStream:
+    default:
+      return std::make_unique<FileStreamSource>(path);
+  }
+}
+
+}  // namespace
+
+std::unique_ptr<DataSource> CreateFileSource(const std::filesystem::path& path,
+                                             const ReaderConfig& config) {
+  const Compression compression = DetectCompression(path);
+  if (config.follow) {
+    // The decompressors treat the end of the compressed data as final.
+    if (compression != Compression::kNone) {
+      throw Error(ErrorType::kUnsupportedCompression);
+    }
+    return std::make_unique<FollowingFileSource>(path, config.read_ahead_buffer_size,
+                                                 config.follow_timeout);
+  }
+  if (compression == Compression::kNone) {
+    return CreateRawFileSource(path, config);
+  }
+  // The decompressor is created first, so unsupported formats fail before the file is opened.
+  auto decompressor = CreateDecompressor(compression);
+  return std::make_unique<DecompressingSource>(CreateRawFileSource(path, config),
+                                               std::move(decompressor),
+                                               config.decompression_buffer_size,
+                                               config.decompression_buffers_count);
+}
+
+std::unique_ptr<DataSource> CreateStreamSource(StreamReadFunction read,
+                                               const ReaderConfig& config) {
+  auto source = std::make_unique<StreamSource>(std::move(read), config.read_ahead_buffer_size);
+  // The magic is peeked from the buffer, as the stream can't be read twice.
+  const Compression compression = DetectCompression(source->Peek(sizeof(uint32_t)));
+  if (compression == Compression::kNone) {
+    return source;
+  }
+  return std::make_unique<DecompressingSource>(std::move(source), CreateDecompressor(compression),
+                                               config.decompression_buffer_size,
+                                               config.decompression_buffers_count);
+}
+
+}  // namespace pcapng_slicer
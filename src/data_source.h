@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+
+#include "pcapng_slicer/error_type.h"
+#include "pcapng_slicer/reader.h"
+
+namespace pcapng_slicer {
+
+// Sequential source of raw pcapng bytes, BlockReader pulls all of the data through it. Sources
+// which keep the whole data in memory may additionally provide zero-copy views of it.
+class DataSource {
+ public:
+  virtual ~DataSource() = default;
+
+  // Copies up to dst.size() bytes into `dst` and returns the number of copied bytes. Returned value
+  // less than dst.size() means that the end of data was reached.
+  virtual size_t Read(std::span<uint8_t> dst) = 0;
+  // Skips up to `size` bytes and returns the number of actually skipped bytes.
+  virtual size_t Skip(size_t size) = 0;
+  virtual bool IsEof() = 0;
+  // Moves to the `offset` from the beginning of the data, returns false if the source doesn't
+  // support seeking or the offset is out of range.
+  virtual bool Seek(uint64_t offset) { return false; }
+  // Returns the failure which has ended the data prematurely, reads just stop at it like at the
+  // end of data.
+  virtual ErrorType LastError() const { return ErrorType::kNoError; }
+  // Returns the total size of the data if it is known.
+  virtual std::optional<uint64_t> Size() const { return std::nullopt; }
+
+  // Returns a view of the next `size` bytes and moves past them, if the source is able to provide
+  // it without copying. Returns nullopt otherwise, in this case Read() must be used.
+  virtual std::optional<std::span<const uint8_t>> View(size_t size) { return std::nullopt; }
+  // Returns an object which keeps memory returned by View() alive.
+  virtual std::shared_ptr<const void> ViewOwner() const { return nullptr; }
+
+  // Waits until the next `size` bytes are available and returns a view of them without moving past
+  // them. Returns nullopt if they didn't appear in time. Supported by the sources following a file
+  // which is still being written, see ReaderConfig::follow.
+  virtual std::optional<std::span<const uint8_t>> WaitForData(size_t size) { return std::nullopt; }
+};
+
+// Creates a source reading the file at `path` with the backend requested by the `config`.
+// Compressed files are recognised by their magic bytes and decompressed transparently, throws Error
+// if the compression format isn't supported. Followed files must be uncompressed, they are read by
+// FollowingFileSource regardless of the backend.
+std::unique_ptr<DataSource> CreateFileSource(const std::filesystem::path& path,
+                                             const ReaderConfig& config);
+// Creates a source reading the stream through `read`, compressed streams are recognised and
+// decompressed like the files are.
+std::unique_ptr<DataSource> CreateStreamSource(StreamReadFunction read,
+                                               const ReaderConfig& config);
+
+}  // namespace pcapng_slicer
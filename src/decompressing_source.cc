@@ -0,0 +1,154 @@
+#include "decompressing_source.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+#include "error.h"
+
+namespace pcapng_slicer {
+namespace {
+
+// Size of a single read of the compressed data.
+constexpr size_t kInputBufferSize = 256 * 1024;
+
+}  // namespace
+
+DecompressingSource::DecompressingSource(std::unique_ptr<DataSource> source,
+                                         std::unique_ptr<Decompressor> decompressor,
+                                         size_t buffer_size, size_t buffers_count)
+    : source_(std::move(source)), decompressor_(std::move(decompressor)), input_(kInputBufferSize) {
+  assert(source_ && decompressor_);
+  // One of the buffers may be owned by the reader, another one by the decompressing thread.
+  free_buffers_.resize(std::max<size_t>(buffers_count, 2));
+  for (auto& buffer : free_buffers_) {
+    buffer.data.resize(std::max<size_t>(buffer_size, 1));
+  }
+  thread_ = std::thread([this] { Run(); });
+}
+
+DecompressingSource::~DecompressingSource() {
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+  }
+  free_cv_.notify_one();
+  thread_.join();
+}
+
+size_t DecompressingSource::Read(std::span<uint8_t> dst) {
+  return Consume(dst.data(), dst.size());
+}
+
+size_t DecompressingSource::Skip(size_t size) { return Consume(nullptr, size); }
+
+bool DecompressingSource::IsEof() {
+  // A failure must not look like the end of data, so the reader finds out that the data is short.
+  return !WaitCurrentBuffer() && !error_;
+}
+
+ErrorType DecompressingSource::LastError() const {
+  std::lock_guard lock(mutex_);
+  return error_.value_or(ErrorType::kNoError);
+}
+
+size_t DecompressingSource::Consume(uint8_t* dst, size_t size) {
+  size_t consumed = 0;
+  while (consumed < size && WaitCurrentBuffer()) {
+    const size_t chunk_size = std::min(size - consumed, current_->size - position_);
+    if (dst) {
+      std::memcpy(dst + consumed, current_->data.data() + position_, chunk_size);
+    }
+    position_ += chunk_size;
+    consumed += chunk_size;
+  }
+  return consumed;
+}
+
+bool DecompressingSource::WaitCurrentBuffer() {
+  if (current_ && position_ < current_->size) {
+    return true;
+  }
+
+  {
+    std::unique_lock lock(mutex_);
+    if (current_) {
+      free_buffers_.push_back(std::move(*current_));
+      current_.reset();
+      free_cv_.notify_one();
+    }
+    filled_cv_.wait(lock, [this] { return finished_ || !filled_buffers_.empty(); });
+    if (filled_buffers_.empty()) {
+      return false;
+    }
+    current_ = std::move(filled_buffers_.front());
+    filled_buffers_.pop_front();
+  }
+  position_ = 0;
+  return true;
+}
+
+void DecompressingSource::Run() {
+  std::optional<ErrorType> error;
+  std::unique_lock lock(mutex_);
+  while (true) {
+    free_cv_.wait(lock, [this] { return stop_ || !free_buffers_.empty(); });
+    if (stop_) {
+      return;
+    }
+    Buffer buffer = std::move(free_buffers_.back());
+    free_buffers_.pop_back();
+
+    lock.unlock();
+    bool more_data = false;
+    try {
+      more_data = Fill(buffer);
+    } catch (const Error& e) {
+      error = e.type();
+    }
+    lock.lock();
+
+    if (buffer.size > 0) {
+      filled_buffers_.push_back(std::move(buffer));
+    } else {
+      free_buffers_.push_back(std::move(buffer));
+    }
+    if (!more_data) {
+      finished_ = true;
+      error_ = error;
+    }
+    filled_cv_.notify_one();
+    if (finished_) {
+      return;
+    }
+  }
+}
+
+bool DecompressingSource::Fill(Buffer& buffer) {
+  const std::span<uint8_t> output(buffer.data);
+  buffer.size = 0;
+  while (buffer.size < output.size()) {
+    if (pending_input_.empty() && !input_eof_) {
+      const size_t read = source_->Read(input_);
+      pending_input_ = std::span(input_).first(read);
+      input_eof_ = read < input_.size();
+    }
+
+    const size_t produced = decompressor_->Decompress(pending_input_, output.subspan(buffer.size));
+    buffer.size += produced;
+    if (produced == 0 && pending_input_.empty() && input_eof_) {
+      // The input may fail right at a frame boundary, which must not look like the end of data.
+      if (const ErrorType error = source_->LastError(); error != ErrorType::kNoError) {
+        throw Error(error);
+      }
+      if (!decompressor_->IsFrameComplete()) {
+        throw Error(ErrorType::kTruncatedFile);
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace pcapng_slicer
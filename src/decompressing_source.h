@@ -0,0 +1,91 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "data_source.h"
+#include "decompressor.h"
+#include "pcapng_slicer/error_type.h"
+
+namespace pcapng_slicer {
+
+// Decompresses the data of another source on its own thread, so parsing of the data overlaps with
+// the decompression. Decompressed data is passed through a ring of buffers: the thread fills free
+// buffers in the data order and the reader returns every consumed buffer back to it.
+//
+//   consumed          filled            filled          being filled
+//  +----------+  +--------------+  +-------------+  +-------------+
+//  | buffer 0 |  |   buffer 1   |  |  buffer 2   |  |  buffer 3   |
+//  +----------+  +--------------+  +-------------+  +-------------+
+//       ^ read position
+//
+// Seeking is not supported, as the compressed formats don't allow to find the data at an arbitrary
+// offset without decompressing everything before it.
+class DecompressingSource : public DataSource {
+ public:
+  DecompressingSource(std::unique_ptr<DataSource> source,
+                      std::unique_ptr<Decompressor> decompressor, size_t buffer_size,
+                      size_t buffers_count);
+  ~DecompressingSource() override;
+
+  DecompressingSource(const DecompressingSource&) = delete;
+  DecompressingSource& operator=(const DecompressingSource&) = delete;
+  DecompressingSource(DecompressingSource&&) = delete;
+  DecompressingSource& operator=(DecompressingSource&&) = delete;
+
+  // DataSource overrides. If the compressed data is corrupted or truncated, the data ends after the
+  // last byte decompressed before the failure, but IsEof() doesn't report the end of data.
+  size_t Read(std::span<uint8_t> dst) override;
+  size_t Skip(size_t size) override;
+  bool IsEof() override;
+  ErrorType LastError() const override;
+
+ private:
+  struct Buffer {
+    std::vector<uint8_t> data;
+    // Number of decompressed bytes in the buffer.
+    size_t size = 0;
+  };
+
+  // Copies (or just skips if `dst` is null) up to `size` bytes.
+  size_t Consume(uint8_t* dst, size_t size);
+  // Blocks until the current buffer has unread data, returns false if there is no more data.
+  bool WaitCurrentBuffer();
+
+  // Decompressing thread.
+  void Run();
+  // Fills the `buffer` with the decompressed data, returns false if the end of data is reached.
+  bool Fill(Buffer& buffer);
+
+  // Accessed by the decompressing thread only.
+  std::unique_ptr<DataSource> source_;
+  std::unique_ptr<Decompressor> decompressor_;
+  std::vector<uint8_t> input_;
+  std::span<const uint8_t> pending_input_;
+  bool input_eof_ = false;
+
+  // Accessed by the reader only.
+  std::optional<Buffer> current_;
+  size_t position_ = 0;
+
+  mutable std::mutex mutex_;
+  std::condition_variable free_cv_;
+  std::condition_variable filled_cv_;
+  std::vector<Buffer> free_buffers_;
+  std::deque<Buffer> filled_buffers_;
+  // Set once the thread has decompressed everything or failed, `error_` is set in the latter case.
+  bool finished_ = false;
+  std::optional<ErrorType> error_;
+  bool stop_ = false;
+  std::thread thread_;
+};
+
+}  // namespace pcapng_slicer
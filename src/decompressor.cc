@@ -0,0 +1,233 @@
+#include "decompressor.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <limits>
+
+#include "error.h"
+
+#ifdef PCAPNG_SLICER_HAS_ZLIB
+#include <zlib.h>
+#endif
+#ifdef PCAPNG_SLICER_HAS_ZSTD
+#include <zstd.h>
+#endif
+#ifdef PCAPNG_SLICER_HAS_LZ4
+#include <lz4frame.h>
+#endif
+
+namespace pcapng_slicer {
+namespace {
+
+constexpr std::array<uint8_t, 2> kGzipMagic = {0x1f, 0x8b};
+constexpr std::array<uint8_t, 4> kZstdMagic = {0x28, 0xb5, 0x2f, 0xfd};
+constexpr std::array<uint8_t, 4> kLz4Magic = {0x04, 0x22, 0x4d, 0x18};
+
+template <size_t N>
+bool StartsWith(std::span<const uint8_t> data, const std::array<uint8_t, N>& magic) {
+  return data.size() >= N && std::equal(magic.begin(), magic.end(), data.begin());
+}
+
+// Decoding failure, which is reported once the data decoded before it is returned.
+class Failure {
+ public:
+  // Throws Error right away if nothing was decoded by the failed call.
+  void Set(size_t produced) {
+    failed_ = true;
+    ThrowIfSet(produced);
+  }
+  void ThrowIfSet(size_t produced = 0) const {
+    if (failed_ && produced == 0) {
+      throw Error(ErrorType::kDecompressionError);
+    }
+  }
+
+ private:
+  bool failed_ = false;
+};
+
+#ifdef PCAPNG_SLICER_HAS_ZLIB
+
+class GzipDecompressor : public Decompressor {
+ public:
+  GzipDecompressor() {
+    // 16 is added to the window bits to accept the gzip wrapper only.
+    if (inflateInit2(&stream_, MAX_WBITS + 16) != Z_OK) {
+      throw Error(ErrorType::kDecompressionError);
+    }
+  }
+
+  ~GzipDecompressor() override { inflateEnd(&stream_); }
+
+  GzipDecompressor(const GzipDecompressor&) = delete;
+  GzipDecompressor& operator=(const GzipDecompressor&) = delete;
+  GzipDecompressor(GzipDecompressor&&) = delete;
+  GzipDecompressor& operator=(GzipDecompressor&&) = delete;
+
+  size_t Decompress(std::span<const uint8_t>& input, std::span<uint8_t> output) override {
+    failed_.ThrowIfSet();
+    // Data following the end of a member is the next member.
+    if (member_complete_ && !input.empty()) {
+      inflateReset(&stream_);
+      member_complete_ = false;
+    }
+
+    constexpr size_t kMaxSize = std::numeric_limits<uInt>::max();
+    stream_.next_in = const_cast<Bytef*>(input.data());
+    stream_.avail_in = static_cast<uInt>(std::min(input.size(), kMaxSize));
+    stream_.next_out = output.data();
+    stream_.avail_out = static_cast<uInt>(std::min(output.size(), kMaxSize));
+    const uInt available_in = stream_.avail_in;
+    const uInt available_out = stream_.avail_out;
+
+    const int result = inflate(&stream_, Z_NO_FLUSH);
+    const size_t produced = available_out - stream_.avail_out;
+    if (result == Z_STREAM_END) {
+      member_complete_ = true;
+    } else if (result != Z_OK && result != Z_BUF_ERROR) {
+      failed_.Set(produced);
+    }
+    input = input.subspan(available_in - stream_.avail_in);
+    return produced;
+  }
+
+  bool IsFrameComplete() const override { return member_complete_; }
+
+ private:
+  z_stream stream_{};
+  bool member_complete_ = false;
+  Failure failed_;
+};
+
+#endif
+
+#ifdef PCAPNG_SLICER_HAS_ZSTD
+
+class ZstdDecompressor : public Decompressor {
+ public:
+  ZstdDecompressor() : context_(ZSTD_createDCtx()) {
+    if (!context_) {
+      throw Error(ErrorType::kDecompressionError);
+    }
+  }
+
+  ~ZstdDecompressor() override { ZSTD_freeDCtx(context_); }
+
+  ZstdDecompressor(const ZstdDecompressor&) = delete;
+  ZstdDecompressor& operator=(const ZstdDecompressor&) = delete;
+  ZstdDecompressor(ZstdDecompressor&&) = delete;
+  ZstdDecompressor& operator=(ZstdDecompressor&&) = delete;
+
+  size_t Decompress(std::span<const uint8_t>& input, std::span<uint8_t> output) override {
+    failed_.ThrowIfSet();
+    ZSTD_inBuffer in{.src = input.data(), .size = input.size(), .pos = 0};
+    ZSTD_outBuffer out{.dst = output.data(), .size = output.size(), .pos = 0};
+    // Frames following each other are decoded by the same context without resetting it.
+    const size_t result = ZSTD_decompressStream(context_, &out, &in);
+    if (ZSTD_isError(result)) {
+      failed_.Set(out.pos);
+    } else if (in.pos > 0 || out.pos > 0) {
+      // Idle calls after the end of a frame return the size of the next frame header.
+      frame_complete_ = result == 0;
+    }
+    input = input.subspan(in.pos);
+    return out.pos;
+  }
+
+  bool IsFrameComplete() const override { return frame_complete_; }
+
+ private:
+  ZSTD_DCtx* context_;
+  bool frame_complete_ = true;
+  Failure failed_;
+};
+
+#endif
+
+#ifdef PCAPNG_SLICER_HAS_LZ4
+
+class Lz4Decompressor : public Decompressor {
+ public:
+  Lz4Decompressor() {
+    if (LZ4F_isError(LZ4F_createDecompressionContext(&context_, LZ4F_VERSION))) {
+      throw Error(ErrorType::kDecompressionError);
+    }
+  }
+
+  ~Lz4Decompressor() override { LZ4F_freeDecompressionContext(context_); }
+
+  Lz4Decompressor(const Lz4Decompressor&) = delete;
+  Lz4Decompressor& operator=(const Lz4Decompressor&) = delete;
+  Lz4Decompressor(Lz4Decompressor&&) = delete;
+  Lz4Decompressor& operator=(Lz4Decompressor&&) = delete;
+
+  size_t Decompress(std::span<const uint8_t>& input, std::span<uint8_t> output) override {
+    failed_.ThrowIfSet();
+    size_t consumed = input.size();
+    size_t produced = output.size();
+    // The context is ready for the next frame as soon as the previous one is decoded.
+    const size_t result =
+        LZ4F_decompress(context_, output.data(), &produced, input.data(), &consumed, nullptr);
+    if (LZ4F_isError(result)) {
+      failed_.Set(produced);
+    } else if (consumed > 0 || produced > 0) {
+      // Idle calls after the end of a frame return the size of the next frame header.
+      frame_complete_ = result == 0;
+    }
+    input = input.subspan(consumed);
+    return produced;
+  }
+
+  bool IsFrameComplete() const override { return frame_complete_; }
+
+ private:
+  LZ4F_dctx* context_ = nullptr;
+  bool frame_complete_ = true;
+  Failure failed_;
+};
+
+#endif
+
+}  // namespace
+
+Compression DetectCompression(std::span<const uint8_t> magic) {
+  if (StartsWith(magic, kGzipMagic)) {
+    return Compression::kGzip;
+  }
+  if (StartsWith(magic, kZstdMagic)) {
+    return Compression::kZstd;
+  }
+  if (StartsWith(magic, kLz4Magic)) {
+    return Compression::kLz4;
+  }
+  return Compression::kNone;
+}
+
+Compression DetectCompression(const std::filesystem::path& path) {
+  std::array<uint8_t, 4> magic{};
+  std::ifstream file(path, std::ios::binary);
+  file.read(reinterpret_cast<char*>(magic.data()), magic.size());
+  return DetectCompression(std::span(magic).first(file.gcount()));
+}
+
+std::unique_ptr<Decompressor> CreateDecompressor(Compression compression) {
+  switch (compression) {
+#ifdef PCAPNG_SLICER_HAS_ZLIB
+    case Compression::kGzip:
+      return std::make_unique<GzipDecompressor>();
+#endif
+#ifdef PCAPNG_SLICER_HAS_ZSTD
+    case Compression::kZstd:
+      return std::make_unique<ZstdDecompressor>();
+#endif
+#ifdef PCAPNG_SLICER_HAS_LZ4
+    case Compression::kLz4:
+      return std::make_unique<Lz4Decompressor>();
+#endif
+    default:
+      throw Error(ErrorType::kUnsupportedCompression);
+  }
+}
+
+}  // namespace pcapng_slicer
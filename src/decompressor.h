@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+namespace pcapng_slicer {
+
+// Compression format of a capture, recognised by the magic bytes at the beginning of the file.
+enum class Compression {
+  kNone,
+  kGzip,
+  kZstd,
+  kLz4,
+};
+
+// Returns the compression format of the data starting with `magic`.
+Compression DetectCompression(std::span<const uint8_t> magic);
+// Same as above, but reads the magic from the beginning of the file. Unreadable or too short files
+// are reported as not compressed, opening them as plain captures reports the actual error.
+Compression DetectCompression(const std::filesystem::path& path);
+
+// Streaming decoder of a single compression format. Concatenated frames (or gzip members) are
+// decoded one after another as a single stream.
+class Decompressor {
+ public:
+  virtual ~Decompressor() = default;
+
+  // Decodes the data from the beginning of `input` into `output`, advances `input` past the
+  // consumed data and returns the number of produced bytes. The decoder may keep the decoded data
+  // which doesn't fit into `output`, it is returned by the next calls even if `input` is empty.
+  // Throws Error if the data is corrupted, but the data decoded before the corruption is returned
+  // first.
+  virtual size_t Decompress(std::span<const uint8_t>& input, std::span<uint8_t> output) = 0;
+  // Returns true if the data decoded so far ends at a frame boundary, so the end of the input there
+  // means that the stream is complete rather than truncated.
+  virtual bool IsFrameComplete() const = 0;
+};
+
+// Throws Error if the library was built without support of the `compression`.
+std::unique_ptr<Decompressor> CreateDecompressor(Compression compression);
+
+}  // namespace pcapng_slicer
@@ -0,0 +1,40 @@
+#include "file_stream_source.h"
+
+#include "error.h"
+
+namespace pcapng_slicer {
+
+FileStreamSource::FileStreamSource(const std::filesystem::path& path) {
+  file_.open(path, std::ios::binary);
+  if (!file_) {
+    throw Error(ErrorType::kUnableToOpenFile);
+  }
+  size_ = std::filesystem::file_size(path);
+}
+
+size_t FileStreamSource::Read(std::span<uint8_t> dst) {
+  file_.read(reinterpret_cast<char*>(dst.data()), dst.size());
+  return file_.gcount();
+}
+
+size_t FileStreamSource::Skip(size_t size) {
+  file_.ignore(size);
+  return file_.gcount();
+}
+
+bool FileStreamSource::IsEof() {
+  return file_.eof() || file_.peek() == std::char_traits<char>::eof();
+}
+
+bool FileStreamSource::Seek(uint64_t offset) {
+  if (offset > size_) {
+    return false;
+  }
+  file_.clear();
+  file_.seekg(offset);
+  return !!file_;
+}
+
+std::optional<uint64_t> FileStreamSource::Size() const { return size_; }
+
+}  // namespace pcapng_slicer
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+
+#include "data_source.h"
+
+namespace pcapng_slicer {
+
+// Reads file through the std::ifstream, every read copies the data into caller's buffer.
+class FileStreamSource : public DataSource {
+ public:
+  explicit FileStreamSource(const std::filesystem::path& path);
+
+  // DataSource overrides:
+  size_t Read(std::span<uint8_t> dst) override;
+  size_t Skip(size_t size) override;
+  bool IsEof() override;
+  bool Seek(uint64_t offset) override;
+  std::optional<uint64_t> Size() const override;
+
+ private:
+  std::ifstream file_;
+  uint64_t size_ = 0;
+};
+
+}  // namespace pcapng_slicer
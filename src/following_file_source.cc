@@ -0,0 +1,105 @@
+#include "following_file_source.h"
+
+#include <algorithm>
+#include <array>
+#include <thread>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace pcapng_slicer {
+namespace {
+
+constexpr std::chrono::milliseconds kMinPollInterval{1};
+
+}  // namespace
+
+FileWatcher::FileWatcher(const std::filesystem::path& path) : poll_interval_(kMinPollInterval) {
+#ifdef __linux__
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd_ >= 0 && inotify_add_watch(inotify_fd_, path.c_str(), IN_MODIFY) < 0) {
+    close(inotify_fd_);
+    inotify_fd_ = -1;
+  }
+#endif
+}
+
+FileWatcher::~FileWatcher() {
+#ifdef __linux__
+  if (inotify_fd_ >= 0) {
+    close(inotify_fd_);
+  }
+#endif
+}
+
+void FileWatcher::Wait(std::chrono::milliseconds timeout) {
+#ifdef __linux__
+  if (inotify_fd_ >= 0) {
+    // The wait is bounded anyway, as some modifications aren't reported, e.g. ones made through a
+    // shared mapping or on another host of a network file system.
+    pollfd fd{.fd = inotify_fd_, .events = POLLIN, .revents = 0};
+    if (poll(&fd, 1, static_cast<int>(std::min(timeout, kMaxPollInterval).count())) > 0) {
+      // The events themselves aren't needed, the caller checks the file anyway.
+      std::array<char, 4096> events;
+      while (read(inotify_fd_, events.data(), events.size()) > 0) {
+      }
+    }
+    return;
+  }
+#endif
+  std::this_thread::sleep_for(std::min(timeout, poll_interval_));
+  poll_interval_ = std::min(poll_interval_ * 2, kMaxPollInterval);
+}
+
+void FileWatcher::Reset() { poll_interval_ = kMinPollInterval; }
+
+FollowingFileSource::FollowingFileSource(const std::filesystem::path& path, size_t buffer_size,
+                                         std::chrono::milliseconds timeout)
+    : file_(path), watcher_(path), timeout_(timeout), buffer_(buffer_size) {}
+
+size_t FollowingFileSource::Read(std::span<uint8_t> dst) {
+  return buffer_.Read(dst, [this](std::span<uint8_t> part) { return ReadMore(part); });
+}
+
+size_t FollowingFileSource::Skip(size_t size) {
+  // BlockReader skips only the blocks which were waited for as a whole, so the rest is normally
+  // empty and it's not checked against the size of the file.
+  file_offset_ += size - buffer_.Consume(size);
+  return size;
+}
+
+bool FollowingFileSource::IsEof() {
+  return !Fill(1);
+}
+
+std::optional<std::span<const uint8_t>> FollowingFileSource::WaitForData(size_t size) {
+  const auto deadline = std::chrono::steady_clock::now() + timeout_;
+  while (!Fill(size)) {
+    const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    if (remaining <= std::chrono::milliseconds::zero()) {
+      return std::nullopt;
+    }
+    watcher_.Wait(remaining);
+  }
+  watcher_.Reset();
+  return buffer_.data().first(size);
+}
+
+bool FollowingFileSource::Fill(size_t size) {
+  return buffer_.Fill(size, [this](std::span<uint8_t> part) { return ReadMore(part); });
+}
+
+// Failed reads are treated like the end of data, which may be followed by more data later.
+int64_t FollowingFileSource::ReadMore(std::span<uint8_t> dst) {
+  const int64_t result = file_.ReadAt(dst, file_offset_);
+  if (result > 0) {
+    file_offset_ += static_cast<uint64_t>(result);
+  }
+  return result;
+}
+
+}  // namespace pcapng_slicer
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+
+#include "async_file_source.h"
+#include "data_source.h"
+#include "read_buffer.h"
+
+namespace pcapng_slicer {
+
+// Waits for the file to be modified. inotify is used on Linux, elsewhere (or if inotify isn't
+// available) the file is polled with an interval growing up to kMaxPollInterval.
+class FileWatcher {
+ public:
+  static constexpr std::chrono::milliseconds kMaxPollInterval{100};
+
+  explicit FileWatcher(const std::filesystem::path& path);
+  ~FileWatcher();
+
+  FileWatcher(const FileWatcher&) = delete;
+  FileWatcher& operator=(const FileWatcher&) = delete;
+
+  // Blocks until the file may have been modified, but no longer than `timeout`.
+  void Wait(std::chrono::milliseconds timeout);
+  // Restarts polling from the shortest interval, called once the file has grown.
+  void Reset();
+
+ private:
+  int inotify_fd_ = -1;
+  std::chrono::milliseconds poll_interval_;
+};
+
+// Reads a file which is still being written, so the end of the file is not the end of data. The
+// data is read into a buffer by pread() at the own offset, and WaitForData() reads whatever was
+// appended since the last attempt, so nothing is read twice.
+class FollowingFileSource : public DataSource {
+ public:
+  FollowingFileSource(const std::filesystem::path& path, size_t buffer_size,
+                      std::chrono::milliseconds timeout);
+
+  // DataSource overrides:
+  size_t Read(std::span<uint8_t> dst) override;
+  size_t Skip(size_t size) override;
+  bool IsEof() override;
+  std::optional<std::span<const uint8_t>> WaitForData(size_t size) override;
+
+ private:
+  // Reads the data appended since the last read into `dst`.
+  int64_t ReadMore(std::span<uint8_t> dst);
+  // Buffers at least `size` bytes if the data has them, see ReadBuffer::Fill().
+  bool Fill(size_t size);
+
+  PositionalFile file_;
+  FileWatcher watcher_;
+  std::chrono::milliseconds timeout_;
+  ReadBuffer buffer_;
+  // Offset of the data following the buffered one.
+  uint64_t file_offset_ = 0;
+};
+
+}  // namespace pcapng_slicer
@@ -1,6 +1,8 @@
 #include "pcapng_slicer/interface.h"
+#include <limits>
 #include <span>
 
+#include "block_types.h"
 #include "interface_private.h"
 
 constexpr size_t kOptionsOffset = 2 * sizeof(uint32_t);
@@ -22,11 +24,38 @@ Interface::Interface(Interface&& other) = default;
 
 Interface& Interface::operator=(Interface&& other) = default;
 
+bool Interface::operator==(const Interface& other) const {
+  return interface_impl_ == other.interface_impl_;
+}
+
+uint16_t Interface::GetLinkType() const {
+  return interface_impl_ ? interface_impl_->link_type : 0;
+}
+
+uint32_t Interface::GetSnapLen() const {
+  if (!interface_impl_ || interface_impl_->snap_len == std::numeric_limits<uint32_t>::max()) {
+    return 0;
+  }
+  return interface_impl_->snap_len;
+}
+
+uint8_t Interface::GetTimestampResolution() const {
+  return interface_impl_ ? interface_impl_->timestamp_resolution : kDefaultTimestampResolution;
+}
+
 Options Interface::ParseOptions() const {
   if (!interface_impl_ || interface_impl_->data.size() < kOptionsOffset) {
     return Options{};
   }
-  return Options(std::span<const uint8_t>(interface_impl_->data).subspan(kOptionsOffset));
+  return Options(GetOptions());
+}
+
+OptionsView Interface::GetOptions() const {
+  if (!interface_impl_ || interface_impl_->data.size() < kOptionsOffset) {
+    return OptionsView{};
+  }
+  return OptionsView(interface_impl_->data.view().subspan(kOptionsOffset),
+                     interface_impl_->swapped);
 }
 
 }  // namespace pcapng_slicer
@@ -0,0 +1,50 @@
+#include "interface_private.h"
+
+#include <limits>
+
+namespace pcapng_slicer {
+namespace {
+
+constexpr uint64_t kNsPerSecond = 1'000'000'000;
+// Largest number of units per second, whose fraction may be multiplied by kNsPerSecond.
+constexpr uint64_t kMaxExactUnitsPerSecond = std::numeric_limits<uint64_t>::max() / kNsPerSecond;
+
+}  // namespace
+
+//  if_tsresol:
+//    +-+-+-+-+-+-+-+-+
+//    |B|   Exponent  |
+//    +-+-+-+-+-+-+-+-+
+//  B = 0: a unit is 10^-Exponent seconds, B = 1: a unit is 2^-Exponent seconds.
+void InterfacePrivate::SetTimestampResolution(uint8_t resolution) {
+  timestamp_resolution = resolution;
+  const bool power_of_two = resolution & 0x80;
+  const uint8_t exponent = resolution & 0x7F;
+  if (power_of_two ? exponent > 63 : exponent > 19) {
+    return;
+  }
+
+  uint64_t units = 1;
+  for (uint8_t i = 0; i < exponent; ++i) {
+    units *= power_of_two ? 2 : 10;
+  }
+  units_per_second = units;
+  ns_multiplier = kNsPerSecond % units == 0 ? kNsPerSecond / units : 0;
+  fraction_shift = 0;
+  while ((units_per_second >> fraction_shift) > kMaxExactUnitsPerSecond) {
+    ++fraction_shift;
+  }
+}
+
+void InterfacePrivate::SetTimestampOffset(int64_t offset) {
+  // Wraps around like the timestamps themselves do.
+  offset_ns = static_cast<uint64_t>(offset) * kNsPerSecond;
+}
+
+uint64_t InterfacePrivate::FractionalToNanoseconds(uint64_t timestamp) const {
+  const uint64_t seconds = timestamp / units_per_second;
+  const uint64_t fraction = (timestamp % units_per_second) >> fraction_shift;
+  return seconds * kNsPerSecond + fraction * kNsPerSecond / (units_per_second >> fraction_shift);
+}
+
+}  // namespace pcapng_slicer
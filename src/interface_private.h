@@ -1,15 +1,46 @@
 #pragma once
 
 #include <cstdint>
-#include <vector>
+
+#include "block_data.h"
+#include "block_types.h"
 
 namespace pcapng_slicer {
 
 struct InterfacePrivate {
-  std::vector<uint8_t> data;
+  // Converts a raw packet timestamp into nanoseconds since the epoch. Interfaces with a resolution
+  // of a whole number of nanoseconds (including the default microseconds) take a single multiply.
+  uint64_t ToNanoseconds(uint64_t timestamp) const {
+    if (ns_multiplier != 0) [[likely]] {
+      return timestamp * ns_multiplier + offset_ns;
+    }
+    return FractionalToNanoseconds(timestamp) + offset_ns;
+  }
+  // Slow path of the above for the resolutions like 2^-N seconds.
+  uint64_t FractionalToNanoseconds(uint64_t timestamp) const;
+
+  // Applies the value of if_tsresol option. Resolutions finer than 2^-63 or 10^-19 seconds can't be
+  // represented, timestamps of such interfaces are converted as microseconds.
+  void SetTimestampResolution(uint8_t resolution);
+  // Applies the value of if_tsoffset option, in seconds.
+  void SetTimestampOffset(int64_t offset);
+
+  BlockData data;
   uint64_t block_position;
   uint32_t link_type;
   uint32_t snap_len;
+  // Byte order of the section the interface belongs to.
+  bool swapped = false;
+
+  // Value of if_tsresol option.
+  uint8_t timestamp_resolution = kDefaultTimestampResolution;
+  // Timestamp conversion factors, precomputed when the interface is parsed.
+  uint64_t units_per_second = 1'000'000;
+  // Nanoseconds per timestamp unit or 0 if a unit is not a whole number of nanoseconds.
+  uint64_t ns_multiplier = 1'000;
+  // Fractions of a second are shifted right by this value to avoid overflow on conversion.
+  uint32_t fraction_shift = 0;
+  uint64_t offset_ns = 0;
 };
 
 }  // namespace pcapng_slicer
@@ -0,0 +1,144 @@
+#include "mapped_file_source.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "error.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace pcapng_slicer {
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+  HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    throw Error(ErrorType::kUnableToOpenFile);
+  }
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size)) {
+    CloseHandle(file);
+    throw Error(ErrorType::kUnableToOpenFile);
+  }
+  size_ = static_cast<size_t>(file_size.QuadPart);
+  if (size_ == 0) {
+    // Empty files can't be mapped.
+    CloseHandle(file);
+    return;
+  }
+
+  mapping_handle_ = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (!mapping_handle_) {
+    throw Error(ErrorType::kUnableToOpenFile);
+  }
+
+  data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_handle_, FILE_MAP_READ, 0, 0, 0));
+  if (!data_) {
+    CloseHandle(mapping_handle_);
+    throw Error(ErrorType::kUnableToOpenFile);
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (data_) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_handle_) {
+    CloseHandle(mapping_handle_);
+  }
+}
+
+#else
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw Error(ErrorType::kUnableToOpenFile);
+  }
+
+  struct stat file_stat {};
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    throw Error(ErrorType::kUnableToOpenFile);
+  }
+  size_ = static_cast<size_t>(file_stat.st_size);
+  if (size_ == 0) {
+    // Empty files can't be mapped.
+    close(fd);
+    return;
+  }
+
+  void* address = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping holds its own reference to the file.
+  close(fd);
+  if (address == MAP_FAILED) {
+    throw Error(ErrorType::kUnableToOpenFile);
+  }
+  madvise(address, size_, MADV_SEQUENTIAL);
+  data_ = static_cast<const uint8_t*>(address);
+}
+
+MappedFile::~MappedFile() {
+  if (data_) {
+    munmap(const_cast<uint8_t*>(data_), size_);
+  }
+}
+
+#endif
+
+MappedFileSource::MappedFileSource(const std::filesystem::path& path)
+    : file_(std::make_shared<const MappedFile>(path)), data_(file_->data()) {}
+
+size_t MappedFileSource::Read(std::span<uint8_t> dst) {
+  const size_t size = std::min(dst.size(), data_.size() - offset_);
+  if (size > 0) {
+    std::memcpy(dst.data(), data_.data() + offset_, size);
+    offset_ += size;
+  }
+  return size;
+}
+
+size_t MappedFileSource::Skip(size_t size) {
+  size = std::min(size, data_.size() - offset_);
+  offset_ += size;
+  return size;
+}
+
+bool MappedFileSource::IsEof() { return offset_ >= data_.size(); }
+
+bool MappedFileSource::Seek(uint64_t offset) {
+  if (offset > data_.size()) {
+    return false;
+  }
+  offset_ = offset;
+  return true;
+}
+
+std::optional<uint64_t> MappedFileSource::Size() const { return data_.size(); }
+
+std::optional<std::span<const uint8_t>> MappedFileSource::View(size_t size) {
+  if (data_.size() - offset_ < size) {
+    return std::nullopt;
+  }
+  auto result = data_.subspan(offset_, size);
+  offset_ += size;
+  return result;
+}
+
+std::shared_ptr<const void> MappedFileSource::ViewOwner() const { return file_; }
+
+}  // namespace pcapng_slicer
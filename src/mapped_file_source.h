@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+#include "data_source.h"
+
+namespace pcapng_slicer {
+
+// Read-only memory mapping of a whole file, the mapping is released on destruction.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::filesystem::path& path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&&) = delete;
+  MappedFile& operator=(MappedFile&&) = delete;
+
+  std::span<const uint8_t> data() const { return {data_, size_}; }
+
+ private:
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  void* mapping_handle_ = nullptr;
+#endif
+};
+
+// Provides zero-copy views directly into the memory mapped file. The mapping is shared with every
+// block borrowed from it, so it stays alive until the last of them is destroyed.
+class MappedFileSource : public DataSource {
+ public:
+  explicit MappedFileSource(const std::filesystem::path& path);
+
+  // DataSource overrides:
+  size_t Read(std::span<uint8_t> dst) override;
+  size_t Skip(size_t size) override;
+  bool IsEof() override;
+  bool Seek(uint64_t offset) override;
+  std::optional<uint64_t> Size() const override;
+  std::optional<std::span<const uint8_t>> View(size_t size) override;
+  std::shared_ptr<const void> ViewOwner() const override;
+
+ private:
+  std::shared_ptr<const MappedFile> file_;
+  std::span<const uint8_t> data_;
+  size_t offset_ = 0;
+};
+
+}  // namespace pcapng_slicer
@@ -0,0 +1,213 @@
+#include "pcapng_slicer/merger.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "block_types.h"
+#include "error.h"
+#include "pcapng_slicer/interface.h"
+#include "pcapng_slicer/options.h"
+#include "pcapng_slicer/packet.h"
+
+namespace pcapng_slicer {
+namespace {
+
+struct MergeInput {
+  Reader reader;
+  // The earliest packet of the input, which isn't written yet.
+  std::optional<Packet> packet;
+  // Output ids of the input interfaces. Inputs usually have just a few interfaces, so the search is
+  // linear.
+  std::vector<std::pair<Interface, uint32_t>> interfaces;
+};
+
+// Codes of the options with fixed size numeric values, which are in the byte order of the input.
+struct NumericOptionCodes {
+  std::span<const uint16_t> uint32_codes;
+  std::span<const uint16_t> uint64_codes;
+};
+
+// if_tzone; if_speed, if_tsoffset, if_txspeed and if_rxspeed.
+constexpr auto kInterfaceUint32Codes = std::to_array<uint16_t>({10});
+constexpr auto kInterfaceUint64Codes = std::to_array<uint16_t>({8, kIfTsoffset, 16, 17});
+// epb_flags, epb_queue; epb_dropcount and epb_packetid.
+constexpr auto kPacketUint32Codes = std::to_array<uint16_t>({2, 6});
+constexpr auto kPacketUint64Codes = std::to_array<uint16_t>({4, 5});
+
+struct HeapEntry {
+  uint64_t timestamp_ns;
+  size_t input_index;
+};
+
+// Heap functions build a max heap, so the comparison is reversed to get the earliest packet on top.
+bool IsLater(const HeapEntry& lhs, const HeapEntry& rhs) {
+  return std::tie(lhs.timestamp_ns, lhs.input_index) > std::tie(rhs.timestamp_ns, rhs.input_index);
+}
+
+template <typename T>
+void AppendValue(std::vector<uint8_t>& values, T value) {
+  const size_t offset = values.size();
+  values.resize(offset + sizeof(value));
+  std::memcpy(values.data() + offset, &value, sizeof(value));
+}
+
+// Copies the options into `values` converting the numeric ones and the PEN of the custom ones to
+// the host byte order, which the Writer writes. Other values, like strings and addresses, have no
+// byte order or an unknown one, so they are copied as they are. `options` point into `values`.
+void CopyOptions(const OptionsView& view, const NumericOptionCodes& numeric_codes,
+                 std::vector<uint8_t>& values, std::vector<WriterOption>& options) {
+  size_t values_size = 0;
+  for (const OptionView& option : view) {
+    values_size += option.GetValue().size();
+  }
+  // Converted values have the same size, so the reserved memory is never reallocated.
+  values.clear();
+  values.reserve(values_size);
+  options.clear();
+
+  const auto contains = [](std::span<const uint16_t> codes, uint16_t code) {
+    return std::ranges::find(codes, code) != codes.end();
+  };
+  for (const OptionView& option : view) {
+    const size_t offset = values.size();
+    const std::optional<uint32_t> uint32_value =
+        contains(numeric_codes.uint32_codes, option.GetCode()) ? option.GetUint32() : std::nullopt;
+    const std::optional<uint64_t> uint64_value =
+        contains(numeric_codes.uint64_codes, option.GetCode()) ? option.GetUint64() : std::nullopt;
+    if (const std::optional<uint32_t> pen = option.GetPenCode()) {
+      AppendValue(values, *pen);
+      values.insert(values.end(), option.GetRawData().begin(), option.GetRawData().end());
+    } else if (uint32_value) {
+      AppendValue(values, *uint32_value);
+    } else if (uint64_value) {
+      AppendValue(values, *uint64_value);
+    } else {
+      values.insert(values.end(), option.GetRawData().begin(), option.GetRawData().end());
+    }
+    options.push_back({.code = option.GetCode(),
+                       .value = std::span(values).subspan(offset, values.size() - offset)});
+  }
+}
+
+// Returns the id of the `interface` in the output, adding it on the first use.
+uint32_t MapInterface(Writer& writer, MergeInput& input, const Interface& interface) {
+  for (const auto& [input_interface, output_id] : input.interfaces) {
+    if (input_interface == interface) {
+      return output_id;
+    }
+  }
+
+  std::vector<uint8_t> values;
+  std::vector<WriterOption> options;
+  CopyOptions(interface.GetOptions(),
+              {.uint32_codes = kInterfaceUint32Codes, .uint64_codes = kInterfaceUint64Codes},
+              values, options);
+  // if_tsresol is written by the Writer itself.
+  std::erase_if(options, [](const WriterOption& option) { return option.code == kIfTsresol; });
+  const std::optional<uint32_t> output_id =
+      writer.AddInterface({.link_type = interface.GetLinkType(),
+                           .snap_len = interface.GetSnapLen(),
+                           .timestamp_resolution = interface.GetTimestampResolution(),
+                           .options = options});
+  if (!output_id) {
+    throw Error(writer.LastError());
+  }
+  input.interfaces.emplace_back(interface, *output_id);
+  return *output_id;
+}
+
+}  // namespace
+
+Merger::Merger(const MergerConfig& config) : config_(config) {}
+
+bool Merger::Merge(std::span<const std::filesystem::path> inputs,
+                   const std::filesystem::path& output) {
+  last_error_ = ErrorType::kNoError;
+  merged_packets_count_ = 0;
+  try {
+    MergeImpl(inputs, output);
+  } catch (const Error& e) {
+    last_error_ = e.type();
+  }
+  return last_error_ == ErrorType::kNoError;
+}
+
+void Merger::MergeImpl(std::span<const std::filesystem::path> inputs,
+                       const std::filesystem::path& output) {
+  std::vector<MergeInput> merge_inputs(inputs.size());
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    if (!merge_inputs[i].reader.Open(inputs[i], config_.reader_config)) {
+      throw Error(merge_inputs[i].reader.LastError());
+    }
+  }
+
+  Writer writer;
+  if (!writer.Open(output, config_.writer_config)) {
+    throw Error(writer.LastError());
+  }
+
+  std::vector<HeapEntry> heap;
+  heap.reserve(merge_inputs.size());
+  // Reads the next packet of the input and puts it into the heap.
+  const auto advance = [&](size_t index) {
+    MergeInput& input = merge_inputs[index];
+    input.packet = input.reader.ReadPacket();
+    if (!input.packet) {
+      if (input.reader.LastError() != ErrorType::kNoError) {
+        throw Error(input.reader.LastError());
+      }
+      return;
+    }
+    heap.push_back({.timestamp_ns = input.packet->GetTimestampNs(), .input_index = index});
+    std::ranges::push_heap(heap, IsLater);
+  };
+
+  for (size_t i = 0; i < merge_inputs.size(); ++i) {
+    advance(i);
+  }
+
+  // Reused between the packets to avoid allocations.
+  std::vector<uint8_t> option_values;
+  std::vector<WriterOption> options;
+  while (!heap.empty()) {
+    std::ranges::pop_heap(heap, IsLater);
+    const size_t index = heap.back().input_index;
+    heap.pop_back();
+
+    MergeInput& input = merge_inputs[index];
+    const Packet& packet = *input.packet;
+    CopyOptions(packet.GetOptions(),
+                {.uint32_codes = kPacketUint32Codes, .uint64_codes = kPacketUint64Codes},
+                option_values, options);
+    const PacketDescription description{
+        .interface_id = MapInterface(writer, input, packet.GetInterface()),
+        .timestamp = packet.GetTimestamp(),
+        .original_length = packet.GetOriginalLength(),
+        .options = options,
+    };
+    const uint64_t dropped_packets_count = writer.DroppedPacketsCount();
+    if (!writer.WritePacket(description, packet.GetData())) {
+      throw Error(writer.LastError());
+    }
+    // WritePacket() succeeds for the packets dropped because of OverflowPolicy::kDrop.
+    if (writer.DroppedPacketsCount() == dropped_packets_count) {
+      ++merged_packets_count_;
+    }
+
+    advance(index);
+  }
+
+  writer.Close();
+  if (writer.LastError() != ErrorType::kNoError) {
+    throw Error(writer.LastError());
+  }
+}
+
+}  // namespace pcapng_slicer
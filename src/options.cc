@@ -1,5 +1,6 @@
 #include "pcapng_slicer/options.h"
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <vector>
@@ -13,22 +14,18 @@ constexpr uint16_t kOptComment = 1;
 constexpr auto kCustomCodes = std::to_array({2988, 2989, 19372, 19373});
 
 namespace pcapng_slicer {
-namespace {
-std::vector<uint8_t> GetOptionBody(std::span<const uint8_t> data, uint32_t length) {
-  if (data.size() < length) {
-    throw Error(ErrorType::kInvalidOptionSize);
-  }
-  return std::vector<uint8_t>(data.begin(), data.begin() + length);
-}
-}  // namespace
 
 Options::Options() {}
 
-Options::Options(std::span<const uint8_t> data) {
-  try {
-    ParseOptions(data);
-  } catch (const Error&) {
-    // TODO: Save en error to notify the user about it.
+Options::Options(std::span<const uint8_t> data) : Options(OptionsView(data)) {}
+
+Options::Options(const OptionsView& options_view) {
+  // TODO: Save en error to notify the user if options are malformed.
+  for (const OptionView& view : options_view) {
+    Option& option = options_.emplace_back();
+    option.code_ = view.GetCode();
+    option.pen_ = view.GetPenCode();
+    option.data_.assign(view.GetRawData().begin(), view.GetRawData().end());
   }
 }
 
@@ -84,35 +81,78 @@ const Option* Options::operator[](size_t index) {
 // /                        Custom Data                            /
 // /              variable length, padded to 32 bits               /
 // +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-void Options::ParseOptions(std::span<const uint8_t> data) {
-  while (!data.empty()) {
-    if (data.size() < 2 * sizeof(uint16_t)) {
-      throw Error(ErrorType::kInvalidOptionSize);
-    }
+OptionsView::Iterator::Iterator(std::span<const uint8_t> data, bool swapped)
+    : data_(data), at_end_(false) {
+  option_.swapped_ = swapped;
+  ++*this;
+}
+
+// The custom option length includes the PEN.
+OptionsView::Iterator& OptionsView::Iterator::operator++() {
+  if (data_.size() < 2 * sizeof(uint16_t)) {
+    at_end_ = true;
+    return *this;
+  }
+
+  const auto code = CastValue<uint16_t>(data_, option_.swapped_);
+  const auto length = CastValue<uint16_t>(data_.subspan(2), option_.swapped_);
+  const auto body = data_.subspan(2 * sizeof(uint16_t));
+  if (code == kEndofopt || body.size() < length) {
+    at_end_ = true;
+    return *this;
+  }
 
-    const auto code = CastValue<uint16_t>(data);
-    const auto length = CastValue<uint16_t>(data.subspan(2));
-    if (code == kEndofopt) {
-      break;
+  option_.code_ = code;
+  option_.data_ = body.first(length);
+  option_.pen_.reset();
+  if (std::ranges::find(kCustomCodes, code) != kCustomCodes.end()) {
+    if (length < sizeof(uint32_t)) {
+      at_end_ = true;
+      return *this;
     }
+    option_.pen_ = CastValue<uint32_t>(option_.data_, option_.swapped_);
+    option_.data_ = option_.data_.subspan(sizeof(uint32_t));
+  }
+
+  data_ = body.subspan(std::min<size_t>(body.size(), length + GetPaddingToOctet(length)));
+  return *this;
+}
 
-    Option new_option;
-    new_option.code_ = code;
-    data = data.subspan(2 * sizeof(uint16_t));
-    if (std::ranges::find(kCustomCodes, code) == kCustomCodes.end()) {
-      new_option.data_ = GetOptionBody(data, length);
-    } else {
-      if (data.size() < sizeof(uint32_t)) {
-        throw Error(ErrorType::kInvalidOptionSize);
-      }
-      new_option.pen_ = CastValue<uint32_t>(data);
-      data = data.subspan(sizeof(uint32_t));
-      new_option.data_ = GetOptionBody(data, length);
+std::optional<OptionView> OptionsView::Find(uint16_t code) const {
+  for (const OptionView& option : *this) {
+    if (option.GetCode() == code) {
+      return option;
     }
-    options_.push_back(std::move(new_option));
+  }
+  return std::nullopt;
+}
+
+bool OptionView::IsString() const { return code_ == kOptComment; }
+
+std::span<const uint8_t> OptionView::GetValue() const {
+  if (!pen_) {
+    return data_;
+  }
+  // PEN directly precedes the custom data.
+  return std::span(data_.data() - sizeof(uint32_t), data_.size() + sizeof(uint32_t));
+}
 
-    data = data.subspan(length + GetPaddingToOctet(length));
+std::optional<uint32_t> OptionView::GetUint32() const {
+  if (data_.size() != sizeof(uint32_t)) {
+    return std::nullopt;
   }
+  return CastValue<uint32_t>(data_, swapped_);
+}
+
+std::optional<uint64_t> OptionView::GetUint64() const {
+  if (data_.size() != sizeof(uint64_t)) {
+    return std::nullopt;
+  }
+  return CastValue<uint64_t>(data_, swapped_);
+}
+
+std::string_view OptionView::GetDataAsString() const {
+  return std::string_view(reinterpret_cast<const char*>(data_.data()), data_.size());
 }
 
 uint16_t Option::GetCode() const { return code_; }
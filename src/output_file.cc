@@ -0,0 +1,170 @@
+#include "output_file.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <climits>
+#include <limits>
+
+#include "error.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace pcapng_slicer {
+
+#ifdef _WIN32
+
+OutputFile::OutputFile(const std::filesystem::path& path) {
+  handle_ = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_NEW,
+                        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (handle_ == INVALID_HANDLE_VALUE) {
+    handle_ = nullptr;
+    throw Error(GetLastError() == ERROR_FILE_EXISTS ? ErrorType::kFileAlreadyExists
+                                                    : ErrorType::kUnableToOpenFile);
+  }
+}
+
+OutputFile::OutputFile(int fd)
+    : owned_(false), handle_(reinterpret_cast<void*>(_get_osfhandle(fd))) {
+  if (handle_ == INVALID_HANDLE_VALUE) {
+    handle_ = nullptr;
+    throw Error(ErrorType::kUnableToOpenFile);
+  }
+}
+
+OutputFile::~OutputFile() {
+  if (handle_ && owned_) {
+    CloseHandle(handle_);
+  }
+}
+
+bool OutputFile::Write(std::span<const std::span<const uint8_t>> parts) {
+  for (auto data : parts) {
+    while (!data.empty()) {
+      const auto size =
+          static_cast<DWORD>(std::min<size_t>(data.size(), std::numeric_limits<DWORD>::max()));
+      DWORD written = 0;
+      if (!WriteFile(handle_, data.data(), size, &written, nullptr)) {
+        return false;
+      }
+      data = data.subspan(written);
+    }
+  }
+  return true;
+}
+
+bool OutputFile::Sync() {
+  // Flushing a pipe would wait for the reader to drain it.
+  if (GetFileType(handle_) != FILE_TYPE_DISK) {
+    return true;
+  }
+  return FlushFileBuffers(handle_);
+}
+
+bool OutputFile::Close() {
+  const bool closed = !owned_ || CloseHandle(handle_);
+  handle_ = nullptr;
+  return closed;
+}
+
+#else
+
+namespace {
+
+// Number of parts passed to a single writev() call.
+#ifdef IOV_MAX
+constexpr size_t kMaxWriteParts = std::min<size_t>(IOV_MAX, 256);
+#else
+constexpr size_t kMaxWriteParts = 16;
+#endif
+
+}  // namespace
+
+OutputFile::OutputFile(const std::filesystem::path& path) {
+  fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+  if (fd_ < 0) {
+    throw Error(errno == EEXIST ? ErrorType::kFileAlreadyExists : ErrorType::kUnableToOpenFile);
+  }
+}
+
+OutputFile::OutputFile(int fd) : owned_(false), fd_(fd) {
+  if (fd_ < 0) {
+    throw Error(ErrorType::kUnableToOpenFile);
+  }
+}
+
+OutputFile::~OutputFile() {
+  if (fd_ >= 0 && owned_) {
+    close(fd_);
+  }
+}
+
+bool OutputFile::Write(std::span<const std::span<const uint8_t>> parts) {
+  std::array<iovec, kMaxWriteParts> iovecs;
+  // The first part which isn't written completely and the number of its written bytes.
+  size_t part_index = 0;
+  size_t part_offset = 0;
+  while (true) {
+    size_t count = 0;
+    for (size_t i = part_index; i < parts.size() && count < iovecs.size(); ++i) {
+      const size_t offset = i == part_index ? part_offset : 0;
+      if (parts[i].size() > offset) {
+        iovecs[count++] = {.iov_base = const_cast<uint8_t*>(parts[i].data() + offset),
+                           .iov_len = parts[i].size() - offset};
+      }
+    }
+    if (count == 0) {
+      return true;
+    }
+
+    const ssize_t written = writev(fd_, iovecs.data(), static_cast<int>(count));
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    auto remaining = static_cast<size_t>(written);
+    while (part_index < parts.size() && remaining >= parts[part_index].size() - part_offset) {
+      remaining -= parts[part_index].size() - part_offset;
+      ++part_index;
+      part_offset = 0;
+    }
+    part_offset += remaining;
+  }
+}
+
+bool OutputFile::Sync() {
+  // Pipes and sockets have nothing to sync, fsync() fails for them with EINVAL.
+  return fsync(fd_) == 0 || errno == EINVAL;
+}
+
+bool OutputFile::Close() {
+  const int result = owned_ ? close(fd_) : 0;
+  fd_ = -1;
+  return result == 0;
+}
+
+#endif
+
+void WriteOrThrow(OutputSink& sink, std::span<const std::span<const uint8_t>> parts) {
+  if (!sink.Write(parts)) {
+    throw Error(ErrorType::kWriteError);
+  }
+}
+
+void WriteOrThrow(OutputSink& sink, std::span<const uint8_t> data) {
+  WriteOrThrow(sink, std::span(&data, 1));
+}
+
+}  // namespace pcapng_slicer
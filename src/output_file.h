@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+#include "pcapng_slicer/output_sink.h"
+
+namespace pcapng_slicer {
+
+// Write-only file, which is closed on destruction. Every call goes straight to the system, so the
+// caller is responsible for the buffering. Parts of a write are gathered by a single writev() call.
+class OutputFile : public OutputSink {
+ public:
+  // Creates a new file, throws Error if it fails. An existing file is never overwritten, it fails
+  // with kFileAlreadyExists.
+  explicit OutputFile(const std::filesystem::path& path);
+  // Writes into the file descriptor of the caller, e.g. a pipe or a socket. It isn't closed by
+  // Close(), and Sync() is a no-op unless the descriptor refers to a file on a disk.
+  explicit OutputFile(int fd);
+  ~OutputFile() override;
+
+  OutputFile(const OutputFile&) = delete;
+  OutputFile& operator=(const OutputFile&) = delete;
+  OutputFile(OutputFile&&) = delete;
+  OutputFile& operator=(OutputFile&&) = delete;
+
+  // OutputSink overrides:
+  bool Write(std::span<const std::span<const uint8_t>> parts) override;
+  bool Sync() override;
+  bool Close() override;
+
+ private:
+  bool owned_ = true;
+#ifdef _WIN32
+  void* handle_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+};
+
+// Write helpers for the code handling errors by exceptions, throw Error if writing fails.
+void WriteOrThrow(OutputSink& sink, std::span<const std::span<const uint8_t>> parts);
+void WriteOrThrow(OutputSink& sink, std::span<const uint8_t> data);
+
+}  // namespace pcapng_slicer
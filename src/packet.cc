@@ -14,9 +14,15 @@ Packet::Packet(std::unique_ptr<PacketPrivate> packet_impl) : packet_impl_(std::m
 
 Packet::Packet(Packet&& other) = default;
 
-Packet& Packet::operator=(Packet&& other) = default;
+Packet& Packet::operator=(Packet&& other) {
+  if (this != &other) {
+    PacketPrivate::Recycle(std::move(packet_impl_));
+    packet_impl_ = std::move(other.packet_impl_);
+  }
+  return *this;
+}
 
-Packet::~Packet() = default;
+Packet::~Packet() { PacketPrivate::Recycle(std::move(packet_impl_)); }
 
 Interface Packet::GetInterface() const {
   if (!packet_impl_) {
@@ -46,10 +52,26 @@ uint64_t Packet::GetTimestamp() const {
   return packet_impl_->GetTimestamp();
 }
 
+uint64_t Packet::GetTimestampNs() const {
+  if (!packet_impl_) {
+    return -1;
+  }
+  return packet_impl_->GetTimestampNs();
+}
+
+std::chrono::sys_time<std::chrono::nanoseconds> Packet::GetTime() const {
+  return std::chrono::sys_time<std::chrono::nanoseconds>(
+      std::chrono::nanoseconds(static_cast<int64_t>(GetTimestampNs())));
+}
+
 bool Packet::IsValid() const { return !!packet_impl_; }
 
 Options Packet::ParseOptions() const {
-  return packet_impl_ ? packet_impl_->ParseOptions() : Options{};
+  return Options(GetOptions());
+}
+
+OptionsView Packet::GetOptions() const {
+  return packet_impl_ ? packet_impl_->GetOptions() : OptionsView{};
 }
 
 Packet::operator bool() const { return IsValid(); }
@@ -0,0 +1,353 @@
+#include "pcapng_slicer/packet_filter.h"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace pcapng_slicer {
+namespace {
+
+// Instruction classes and fields, the values are the same as in linux/bpf_common.h.
+constexpr uint16_t kLd = 0x00;
+constexpr uint16_t kLdx = 0x01;
+constexpr uint16_t kSt = 0x02;
+constexpr uint16_t kStx = 0x03;
+constexpr uint16_t kAlu = 0x04;
+constexpr uint16_t kJmp = 0x05;
+constexpr uint16_t kRet = 0x06;
+constexpr uint16_t kMisc = 0x07;
+
+constexpr uint16_t kW = 0x00;
+constexpr uint16_t kH = 0x08;
+constexpr uint16_t kB = 0x10;
+
+constexpr uint16_t kImm = 0x00;
+constexpr uint16_t kAbs = 0x20;
+constexpr uint16_t kInd = 0x40;
+constexpr uint16_t kMem = 0x60;
+constexpr uint16_t kLen = 0x80;
+constexpr uint16_t kMsh = 0xa0;
+
+constexpr uint16_t kAdd = 0x00;
+constexpr uint16_t kSub = 0x10;
+constexpr uint16_t kMul = 0x20;
+constexpr uint16_t kDiv = 0x30;
+constexpr uint16_t kOr = 0x40;
+constexpr uint16_t kAnd = 0x50;
+constexpr uint16_t kLsh = 0x60;
+constexpr uint16_t kRsh = 0x70;
+constexpr uint16_t kNeg = 0x80;
+constexpr uint16_t kMod = 0x90;
+constexpr uint16_t kXor = 0xa0;
+
+constexpr uint16_t kJa = 0x00;
+constexpr uint16_t kJeq = 0x10;
+constexpr uint16_t kJgt = 0x20;
+constexpr uint16_t kJge = 0x30;
+constexpr uint16_t kJset = 0x40;
+
+constexpr uint16_t kK = 0x00;
+constexpr uint16_t kX = 0x08;
+constexpr uint16_t kA = 0x10;
+
+constexpr uint16_t kTax = 0x00;
+constexpr uint16_t kTxa = 0x80;
+
+constexpr size_t kMemWords = 16;
+constexpr size_t kMaxInstructions = 4096;
+
+constexpr uint16_t GetClass(uint16_t code) { return code & 0x07; }
+constexpr uint16_t GetOperation(uint16_t code) { return code & 0xf0; }
+
+// Loads the value of N bytes at `offset` in network byte order. Returns false if it is out of the
+// packet.
+template <size_t N>
+bool Load(std::span<const uint8_t> data, uint64_t offset, uint32_t& value) {
+  if (offset + N > data.size()) {
+    return false;
+  }
+  value = 0;
+  for (size_t i = 0; i < N; ++i) {
+    value = value << 8 | data[offset + i];
+  }
+  return true;
+}
+
+bool IsValidInstruction(const BpfInstruction& instruction, size_t pc, size_t size) {
+  const uint16_t code = instruction.code;
+  switch (GetClass(code)) {
+    case kLd:
+      switch (code) {
+        case kLd | kW | kAbs:
+        case kLd | kH | kAbs:
+        case kLd | kB | kAbs:
+        case kLd | kW | kInd:
+        case kLd | kH | kInd:
+        case kLd | kB | kInd:
+        case kLd | kW | kImm:
+        case kLd | kW | kLen:
+          return true;
+        case kLd | kW | kMem:
+          return instruction.k < kMemWords;
+        default:
+          return false;
+      }
+    case kLdx:
+      switch (code) {
+        case kLdx | kW | kImm:
+        case kLdx | kW | kLen:
+        case kLdx | kB | kMsh:
+          return true;
+        case kLdx | kW | kMem:
+          return instruction.k < kMemWords;
+        default:
+          return false;
+      }
+    case kSt:
+    case kStx:
+      return code == GetClass(code) && instruction.k < kMemWords;
+    case kAlu:
+      if (code == (kAlu | kNeg)) {
+        return true;
+      }
+      switch (GetOperation(code)) {
+        case kAdd:
+        case kSub:
+        case kMul:
+        case kOr:
+        case kAnd:
+        case kLsh:
+        case kRsh:
+        case kXor:
+          return code <= 0xff;
+        case kDiv:
+        case kMod:
+          return code <= 0xff && (code & kX || instruction.k != 0);
+        default:
+          return false;
+      }
+    case kJmp:
+      if (code == (kJmp | kJa)) {
+        return instruction.k < size - pc - 1;
+      }
+      switch (GetOperation(code)) {
+        case kJeq:
+        case kJgt:
+        case kJge:
+        case kJset:
+          return code <= 0xff && instruction.jt < size - pc - 1 && instruction.jf < size - pc - 1;
+        default:
+          return false;
+      }
+    case kRet:
+      return code == (kRet | kK) || code == (kRet | kA);
+    case kMisc:
+      return code == (kMisc | kTax) || code == (kMisc | kTxa);
+  }
+  return false;
+}
+
+}  // namespace
+
+std::optional<BpfProgram> BpfProgram::Create(std::vector<BpfInstruction> instructions) {
+  if (instructions.empty() || instructions.size() > kMaxInstructions ||
+      GetClass(instructions.back().code) != kRet) {
+    return std::nullopt;
+  }
+  for (size_t pc = 0; pc < instructions.size(); ++pc) {
+    if (!IsValidInstruction(instructions[pc], pc, instructions.size())) {
+      return std::nullopt;
+    }
+  }
+  return BpfProgram(std::move(instructions));
+}
+
+// Jumps go forward only and the last instruction is a return, so the loop always terminates.
+uint32_t BpfProgram::Run(std::span<const uint8_t> data, uint32_t original_length) const {
+  uint32_t a = 0;
+  uint32_t x = 0;
+  std::array<uint32_t, kMemWords> mem{};
+
+  for (size_t pc = 0;; ++pc) {
+    const BpfInstruction& instruction = instructions_[pc];
+    const uint32_t k = instruction.k;
+    switch (instruction.code) {
+      case kLd | kW | kAbs:
+        if (!Load<4>(data, k, a)) {
+          return 0;
+        }
+        break;
+      case kLd | kH | kAbs:
+        if (!Load<2>(data, k, a)) {
+          return 0;
+        }
+        break;
+      case kLd | kB | kAbs:
+        if (!Load<1>(data, k, a)) {
+          return 0;
+        }
+        break;
+      case kLd | kW | kInd:
+        if (!Load<4>(data, uint64_t{x} + k, a)) {
+          return 0;
+        }
+        break;
+      case kLd | kH | kInd:
+        if (!Load<2>(data, uint64_t{x} + k, a)) {
+          return 0;
+        }
+        break;
+      case kLd | kB | kInd:
+        if (!Load<1>(data, uint64_t{x} + k, a)) {
+          return 0;
+        }
+        break;
+      case kLd | kW | kImm:
+        a = k;
+        break;
+      case kLd | kW | kLen:
+        a = original_length;
+        break;
+      case kLd | kW | kMem:
+        a = mem[k];
+        break;
+      case kLdx | kW | kImm:
+        x = k;
+        break;
+      case kLdx | kW | kLen:
+        x = original_length;
+        break;
+      case kLdx | kW | kMem:
+        x = mem[k];
+        break;
+      case kLdx | kB | kMsh:
+        if (!Load<1>(data, k, x)) {
+          return 0;
+        }
+        x = (x & 0xf) << 2;
+        break;
+      case kSt:
+        mem[k] = a;
+        break;
+      case kStx:
+        mem[k] = x;
+        break;
+
+      case kAlu | kAdd | kK:
+        a += k;
+        break;
+      case kAlu | kAdd | kX:
+        a += x;
+        break;
+      case kAlu | kSub | kK:
+        a -= k;
+        break;
+      case kAlu | kSub | kX:
+        a -= x;
+        break;
+      case kAlu | kMul | kK:
+        a *= k;
+        break;
+      case kAlu | kMul | kX:
+        a *= x;
+        break;
+      case kAlu | kDiv | kK:
+        a /= k;
+        break;
+      case kAlu | kDiv | kX:
+        if (x == 0) {
+          return 0;
+        }
+        a /= x;
+        break;
+      case kAlu | kMod | kK:
+        a %= k;
+        break;
+      case kAlu | kMod | kX:
+        if (x == 0) {
+          return 0;
+        }
+        a %= x;
+        break;
+      case kAlu | kOr | kK:
+        a |= k;
+        break;
+      case kAlu | kOr | kX:
+        a |= x;
+        break;
+      case kAlu | kAnd | kK:
+        a &= k;
+        break;
+      case kAlu | kAnd | kX:
+        a &= x;
+        break;
+      case kAlu | kXor | kK:
+        a ^= k;
+        break;
+      case kAlu | kXor | kX:
+        a ^= x;
+        break;
+      // Shifts by 32 or more bits give zero, instead of being undefined.
+      case kAlu | kLsh | kK:
+        a = k < 32 ? a << k : 0;
+        break;
+      case kAlu | kLsh | kX:
+        a = x < 32 ? a << x : 0;
+        break;
+      case kAlu | kRsh | kK:
+        a = k < 32 ? a >> k : 0;
+        break;
+      case kAlu | kRsh | kX:
+        a = x < 32 ? a >> x : 0;
+        break;
+      case kAlu | kNeg:
+        a = -a;
+        break;
+
+      case kJmp | kJa:
+        pc += k;
+        break;
+      case kJmp | kJeq | kK:
+        pc += a == k ? instruction.jt : instruction.jf;
+        break;
+      case kJmp | kJeq | kX:
+        pc += a == x ? instruction.jt : instruction.jf;
+        break;
+      case kJmp | kJgt | kK:
+        pc += a > k ? instruction.jt : instruction.jf;
+        break;
+      case kJmp | kJgt | kX:
+        pc += a > x ? instruction.jt : instruction.jf;
+        break;
+      case kJmp | kJge | kK:
+        pc += a >= k ? instruction.jt : instruction.jf;
+        break;
+      case kJmp | kJge | kX:
+        pc += a >= x ? instruction.jt : instruction.jf;
+        break;
+      case kJmp | kJset | kK:
+        pc += (a & k) ? instruction.jt : instruction.jf;
+        break;
+      case kJmp | kJset | kX:
+        pc += (a & x) ? instruction.jt : instruction.jf;
+        break;
+
+      case kRet | kK:
+        return k;
+      case kRet | kA:
+        return a;
+
+      case kMisc | kTax:
+        x = a;
+        break;
+      case kMisc | kTxa:
+        a = x;
+        break;
+    }
+  }
+}
+
+}  // namespace pcapng_slicer
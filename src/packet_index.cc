@@ -0,0 +1,279 @@
+#include "pcapng_slicer/packet_index.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+
+#include "block_parsing.h"
+#include "block_reader.h"
+#include "block_types.h"
+#include "data_source.h"
+#include "error.h"
+#include "packet_private.h"
+#include "read_utils.h"
+#include "section_private.h"
+
+namespace pcapng_slicer {
+namespace {
+
+constexpr std::array<char, 8> kIndexMagic = {'P', 'C', 'N', 'G', 'I', 'D', 'X', '\0'};
+constexpr uint32_t kIndexVersion = 2;
+
+// Sidecar file layout, all values are stored in the native byte order:
+//   IndexFileHeader
+//   `sections_count` times: IndexFileSection followed by `interfaces_count` of uint64_t offsets
+//   `entries_count` times: PacketIndexEntry
+struct IndexFileHeader {
+  std::array<char, 8> magic;
+  uint32_t version;
+  uint32_t entry_size;
+  uint64_t capture_size;
+  uint64_t sections_count;
+  uint64_t entries_count;
+};
+
+struct IndexFileSection {
+  uint64_t offset;
+  uint64_t first_packet;
+  uint64_t interfaces_count;
+};
+
+static_assert(sizeof(PacketIndexEntry) == 24);
+static_assert(sizeof(IndexFileHeader) == 40);
+static_assert(sizeof(IndexFileSection) == 24);
+
+template <typename T, size_t N>
+void WriteValues(std::ofstream& file, std::span<T, N> values) {
+  file.write(reinterpret_cast<const char*>(values.data()), values.size_bytes());
+}
+
+template <typename T, size_t N>
+void ReadValues(std::ifstream& file, std::span<T, N> values) {
+  file.read(reinterpret_cast<char*>(values.data()), values.size_bytes());
+  if (static_cast<size_t>(file.gcount()) != values.size_bytes()) {
+    throw Error(ErrorType::kInvalidIndex);
+  }
+}
+
+}  // namespace
+
+PacketIndex::PacketIndex() = default;
+
+PacketIndex::~PacketIndex() = default;
+
+PacketIndex::PacketIndex(const PacketIndex& other) = default;
+
+PacketIndex& PacketIndex::operator=(const PacketIndex& other) = default;
+
+PacketIndex::PacketIndex(PacketIndex&& other) = default;
+
+PacketIndex& PacketIndex::operator=(PacketIndex&& other) = default;
+
+bool PacketIndex::Build(const std::filesystem::path& capture_path) {
+  last_error_ = ErrorType::kNoError;
+  try {
+    BuildImpl(capture_path);
+    return true;
+  } catch (const Error& e) {
+    Reset();
+    last_error_ = e.type();
+    return false;
+  }
+}
+
+bool PacketIndex::Save(const std::filesystem::path& index_path) {
+  last_error_ = ErrorType::kNoError;
+  std::ofstream file(index_path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    last_error_ = ErrorType::kUnableToOpenFile;
+    return false;
+  }
+
+  const IndexFileHeader header{
+      .magic = kIndexMagic,
+      .version = kIndexVersion,
+      .entry_size = sizeof(PacketIndexEntry),
+      .capture_size = capture_size_,
+      .sections_count = sections_.size(),
+      .entries_count = entries_.size(),
+  };
+  WriteValues(file, std::span(&header, 1));
+  for (const Section& section : sections_) {
+    const IndexFileSection section_header{
+        .offset = section.offset,
+        .first_packet = section.first_packet,
+        .interfaces_count = section.interface_offsets.size(),
+    };
+    WriteValues(file, std::span(&section_header, 1));
+    WriteValues(file, std::span(section.interface_offsets));
+  }
+  WriteValues(file, std::span(entries_));
+
+  file.close();
+  if (!file) {
+    last_error_ = ErrorType::kWriteError;
+    return false;
+  }
+  return true;
+}
+
+bool PacketIndex::Load(const std::filesystem::path& index_path) {
+  last_error_ = ErrorType::kNoError;
+  try {
+    LoadImpl(index_path);
+    return true;
+  } catch (const Error& e) {
+    Reset();
+    last_error_ = e.type();
+    return false;
+  }
+}
+
+std::optional<size_t> PacketIndex::FindPacketByTime(uint64_t timestamp) const {
+  const auto it = std::ranges::lower_bound(
+      time_order_, timestamp, {}, [this](uint64_t number) { return entries_[number].timestamp; });
+  if (it == time_order_.end()) {
+    return std::nullopt;
+  }
+  return *it;
+}
+
+void PacketIndex::BuildImpl(const std::filesystem::path& capture_path) {
+  Reset();
+  if (!std::filesystem::exists(capture_path)) {
+    throw Error(ErrorType::kFileNotFound);
+  }
+
+  BlockReader block_reader(CreateFileSource(capture_path, {.backend = ReadBackend::kMemoryMapped}));
+  capture_size_ = block_reader.DataSize().value_or(0);
+
+  std::shared_ptr<SectionPrivate> section;
+  SimplePacketPrivate simple_packet;
+  EnchansedPacketPrivate enchansed_packet;
+  while (!block_reader.IsEof()) {
+    ScopedBlock block = block_reader.ReadBlock();
+    ThrowIfError(block.error());
+    const uint64_t position = block.position();
+    if (!section && block.type() != static_cast<uint32_t>(PcapngBlockType::kSectionHeader)) {
+      throw Error(ErrorType::kFirstBlockIsNotSectionHeader);
+    }
+
+    switch (block.type()) {
+      case static_cast<uint32_t>(PcapngBlockType::kSectionHeader):
+        section = ValueOrThrow(ParseSectionHeaderBlock(ReadDataOrThrow(block), position));
+        sections_.push_back({.offset = position, .first_packet = entries_.size()});
+        break;
+      case static_cast<uint32_t>(PcapngBlockType::kInterfaceDescription):
+        section->PushInterface(
+            ValueOrThrow(ParseInterfaceBlock(*section, ReadDataOrThrow(block), position)));
+        sections_.back().interface_offsets.push_back(position);
+        break;
+      case static_cast<uint32_t>(PcapngBlockType::kSimplePacket):
+        ThrowIfError(block.ReadData(simple_packet.data));
+        ThrowIfError(ParseSimplePacketBlock(*section, simple_packet));
+        entries_.push_back({
+            .offset = position,
+            .timestamp = simple_packet.GetTimestampNs(),
+            .interface_id = 0,
+            .captured_length = static_cast<uint32_t>(simple_packet.GetData().size()),
+        });
+        simple_packet.Reset();
+        break;
+      case static_cast<uint32_t>(PcapngBlockType::kEnchancedPacket):
+        ThrowIfError(block.ReadData(enchansed_packet.data));
+        ThrowIfError(ParseEnchansedPacketBlock(*section, enchansed_packet));
+        entries_.push_back({
+            .offset = position,
+            .timestamp = enchansed_packet.GetTimestampNs(),
+            .interface_id = CastValue<uint32_t>(enchansed_packet.data.view(), section->swapped),
+            .captured_length = static_cast<uint32_t>(enchansed_packet.GetData().size()),
+        });
+        enchansed_packet.Reset();
+        break;
+      default:
+        break;
+    }
+  }
+  ThrowIfError(block_reader.LastError());
+
+  BuildTimeOrder();
+}
+
+void PacketIndex::LoadImpl(const std::filesystem::path& index_path) {
+  Reset();
+  if (!std::filesystem::exists(index_path)) {
+    throw Error(ErrorType::kFileNotFound);
+  }
+  std::ifstream file(index_path, std::ios::binary);
+  if (!file) {
+    throw Error(ErrorType::kUnableToOpenFile);
+  }
+  const uint64_t file_size = std::filesystem::file_size(index_path);
+
+  IndexFileHeader header;
+  ReadValues(file, std::span(&header, 1));
+  if (header.magic != kIndexMagic || header.version != kIndexVersion ||
+      header.entry_size != sizeof(PacketIndexEntry) ||
+      header.entries_count > file_size / sizeof(PacketIndexEntry) ||
+      header.sections_count > file_size / sizeof(IndexFileSection)) {
+    throw Error(ErrorType::kInvalidIndex);
+  }
+  capture_size_ = header.capture_size;
+
+  sections_.resize(header.sections_count);
+  for (Section& section : sections_) {
+    IndexFileSection section_header;
+    ReadValues(file, std::span(&section_header, 1));
+    if (section_header.interfaces_count > file_size / sizeof(uint64_t) ||
+        section_header.first_packet > header.entries_count ||
+        (&section != &sections_.front() &&
+         section_header.first_packet < (&section - 1)->first_packet)) {
+      throw Error(ErrorType::kInvalidIndex);
+    }
+    section.offset = section_header.offset;
+    section.first_packet = section_header.first_packet;
+    section.interface_offsets.resize(section_header.interfaces_count);
+    ReadValues(file, std::span(section.interface_offsets));
+  }
+
+  entries_.resize(header.entries_count);
+  ReadValues(file, std::span(entries_));
+  if (!entries_.empty() && (sections_.empty() || sections_.front().first_packet != 0)) {
+    throw Error(ErrorType::kInvalidIndex);
+  }
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    if (entries_[i].offset >= capture_size_ ||
+        entries_[i].interface_id >= GetPacketSection(i).interface_offsets.size()) {
+      throw Error(ErrorType::kInvalidIndex);
+    }
+  }
+
+  BuildTimeOrder();
+}
+
+void PacketIndex::BuildTimeOrder() {
+  time_order_.resize(entries_.size());
+  for (size_t i = 0; i < time_order_.size(); ++i) {
+    time_order_[i] = i;
+  }
+  std::ranges::stable_sort(time_order_, {},
+                           [this](uint64_t number) { return entries_[number].timestamp; });
+}
+
+const PacketIndex::Section& PacketIndex::GetPacketSection(size_t packet_number) const {
+  assert(packet_number < entries_.size() && !sections_.empty());
+  auto it = std::ranges::upper_bound(sections_, packet_number, {}, &Section::first_packet);
+  assert(it != sections_.begin());
+  return *std::prev(it);
+}
+
+void PacketIndex::Reset() {
+  capture_size_ = 0;
+  sections_.clear();
+  entries_.clear();
+  time_order_.clear();
+}
+
+}  // namespace pcapng_slicer
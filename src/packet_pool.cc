@@ -0,0 +1,62 @@
+#include "packet_pool.h"
+
+#include <cassert>
+
+namespace pcapng_slicer {
+
+PacketPool::PacketPool() {
+  // Free lists never grow beyond this capacity, so releasing a packet never allocates.
+  free_simple_packets_.reserve(kMaxFreePackets);
+  free_enchansed_packets_.reserve(kMaxFreePackets);
+}
+
+std::unique_ptr<SimplePacketPrivate> PacketPool::AcquireSimplePacket(ReaderCounters* counters) {
+  return Acquire(free_simple_packets_, counters);
+}
+
+std::unique_ptr<EnchansedPacketPrivate> PacketPool::AcquireEnchansedPacket(
+    ReaderCounters* counters) {
+  return Acquire(free_enchansed_packets_, counters);
+}
+
+void PacketPool::Release(std::unique_ptr<PacketPrivate> packet) {
+  assert(packet && !packet->pool);
+  packet->Reset();
+
+  std::lock_guard lock(mutex_);
+  switch (packet->kind()) {
+    case PacketPrivate::Kind::kSimple:
+      if (free_simple_packets_.size() < kMaxFreePackets) {
+        free_simple_packets_.emplace_back(static_cast<SimplePacketPrivate*>(packet.release()));
+      }
+      break;
+    case PacketPrivate::Kind::kEnchansed:
+      if (free_enchansed_packets_.size() < kMaxFreePackets) {
+        free_enchansed_packets_.emplace_back(static_cast<EnchansedPacketPrivate*>(packet.release()));
+      }
+      break;
+  }
+}
+
+template <typename T>
+std::unique_ptr<T> PacketPool::Acquire(std::vector<std::unique_ptr<T>>& free_packets,
+                                       ReaderCounters* counters) {
+  std::unique_ptr<T> packet;
+  {
+    std::lock_guard lock(mutex_);
+    if (!free_packets.empty()) {
+      packet = std::move(free_packets.back());
+      free_packets.pop_back();
+    }
+  }
+  if (!packet) {
+    packet = std::make_unique<T>();
+    if (counters) {
+      counters->Add(&ReaderStats::packet_allocations_count);
+    }
+  }
+  packet->pool = shared_from_this();
+  return packet;
+}
+
+}  // namespace pcapng_slicer
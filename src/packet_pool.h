@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "packet_private.h"
+#include "pcapng_slicer/stats.h"
+
+namespace pcapng_slicer {
+
+// Recycles packet implementations together with their block buffers, so that the steady-state read
+// loop doesn't allocate. Packets are returned into the pool from the Packet destructor, which may be
+// called from any thread, and the pool is kept alive by every packet acquired from it.
+class PacketPool : public std::enable_shared_from_this<PacketPool> {
+ public:
+  // Maximum number of free objects of a single kind which are kept for reuse.
+  static constexpr size_t kMaxFreePackets = 1024;
+
+  PacketPool();
+
+  // Packets allocated because there was no free one are counted by the `counters`, if any.
+  std::unique_ptr<SimplePacketPrivate> AcquireSimplePacket(ReaderCounters* counters = nullptr);
+  std::unique_ptr<EnchansedPacketPrivate> AcquireEnchansedPacket(
+      ReaderCounters* counters = nullptr);
+  void Release(std::unique_ptr<PacketPrivate> packet);
+
+ private:
+  template <typename T>
+  std::unique_ptr<T> Acquire(std::vector<std::unique_ptr<T>>& free_packets,
+                             ReaderCounters* counters);
+
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<SimplePacketPrivate>> free_simple_packets_;
+  std::vector<std::unique_ptr<EnchansedPacketPrivate>> free_enchansed_packets_;
+};
+
+}  // namespace pcapng_slicer
@@ -3,9 +3,21 @@
 #include <cassert>
 #include <cstdint>
 
+#include "packet_pool.h"
+
 namespace pcapng_slicer {
 
-Options PacketPrivate::ParseOptions() const { return Options{}; }
+OptionsView PacketPrivate::GetOptions() const { return OptionsView{}; }
+
+void PacketPrivate::Recycle(std::unique_ptr<PacketPrivate> packet) {
+  if (!packet || !packet->pool) {
+    // Packets without a pool are simply destroyed.
+    return;
+  }
+  // The pool must not be referenced by its own free objects.
+  std::shared_ptr<PacketPool> pool = std::move(packet->pool);
+  pool->Release(std::move(packet));
+}
 
 std::shared_ptr<InterfacePrivate> SimplePacketPrivate::GetInterface() const { return interface; }
 
@@ -13,13 +25,20 @@ uint32_t SimplePacketPrivate::GetOriginalLength() const { return original_length
 
 uint64_t SimplePacketPrivate::GetTimestamp() const { return 0; }
 
+uint64_t SimplePacketPrivate::GetTimestampNs() const { return 0; }
+
 std::span<const uint8_t> SimplePacketPrivate::GetData() const {
   assert(interface);
 
   const auto real_length = std::min(original_length, interface->snap_len);
   assert(data.size() >= real_length + sizeof(uint32_t));
 
-  return std::span<const uint8_t>(data.begin() + sizeof(uint32_t), real_length);
+  return data.view().subspan(sizeof(uint32_t), real_length);
+}
+
+void SimplePacketPrivate::Reset() {
+  interface.reset();
+  data.Clear();
 }
 
 std::shared_ptr<InterfacePrivate> EnchansedPacketPrivate::GetInterface() const { return interface; }
@@ -28,8 +47,21 @@ uint32_t EnchansedPacketPrivate::GetOriginalLength() const { return original_len
 
 uint64_t EnchansedPacketPrivate::GetTimestamp() const { return timestamp; }
 
+uint64_t EnchansedPacketPrivate::GetTimestampNs() const {
+  return interface->ToNanoseconds(timestamp);
+}
+
 std::span<const uint8_t> EnchansedPacketPrivate::GetData() const { return packet_data_slice; }
 
-Options EnchansedPacketPrivate::ParseOptions() const { return Options(options_data_slice); }
+OptionsView EnchansedPacketPrivate::GetOptions() const {
+  return OptionsView(options_data_slice, interface && interface->swapped);
+}
+
+void EnchansedPacketPrivate::Reset() {
+  interface.reset();
+  data.Clear();
+  packet_data_slice = {};
+  options_data_slice = {};
+}
 
 }  // namespace pcapng_slicer
@@ -2,35 +2,61 @@
 
 #include <sys/types.h>
 
+#include <memory>
 #include <span>
 #include <vector>
 
+#include "block_data.h"
 #include "interface_private.h"
 #include "pcapng_slicer/options.h"
 
 namespace pcapng_slicer {
 
+class PacketPool;
+
 class PacketPrivate {
  public:
+  enum class Kind { kSimple, kEnchansed };
+
+  explicit PacketPrivate(Kind kind) : kind_(kind) {}
   virtual ~PacketPrivate() = default;
 
   virtual std::shared_ptr<InterfacePrivate> GetInterface() const = 0;
   virtual std::span<const uint8_t> GetData() const = 0;
   virtual uint32_t GetOriginalLength() const = 0;
   virtual uint64_t GetTimestamp() const = 0;
-  virtual Options ParseOptions() const;
+  virtual uint64_t GetTimestampNs() const = 0;
+  // Returns options of the packet, which may be empty if the packet has no options.
+  virtual OptionsView GetOptions() const;
+  // Drops all references held by the packet, but keeps allocated buffers for further reuse.
+  virtual void Reset() = 0;
+
+  // Returns the packet into its pool if it has one, otherwise simply destroys it.
+  static void Recycle(std::unique_ptr<PacketPrivate> packet);
+
+  Kind kind() const { return kind_; }
+
+  // The pool this packet will be returned to, when it is no longer used.
+  std::shared_ptr<PacketPool> pool;
+
+ private:
+  Kind kind_;
 };
 
 class SimplePacketPrivate : public PacketPrivate {
  public:
+  SimplePacketPrivate() : PacketPrivate(Kind::kSimple) {}
+
   // PacketPrivate overrides:
   std::shared_ptr<InterfacePrivate> GetInterface() const override;
   uint32_t GetOriginalLength() const override;
   uint64_t GetTimestamp() const override;
+  uint64_t GetTimestampNs() const override;
   std::span<const uint8_t> GetData() const override;
+  void Reset() override;
 
   std::shared_ptr<InterfacePrivate> interface;
-  std::vector<uint8_t> data;
+  BlockData data;
   uint32_t original_length;
 };
 
@@ -38,16 +64,20 @@ class EnchansedPacketPrivate : public PacketPrivate {
  public:
   static constexpr size_t kRequiredSize = 5 * sizeof(uint32_t);
 
+  EnchansedPacketPrivate() : PacketPrivate(Kind::kEnchansed) {}
+
   // PacketPrivate overrides:
   std::shared_ptr<InterfacePrivate> GetInterface() const override;
   uint32_t GetOriginalLength() const override;
   uint64_t GetTimestamp() const override;
+  uint64_t GetTimestampNs() const override;
   std::span<const uint8_t> GetData() const override;
-  Options ParseOptions() const override;
+  OptionsView GetOptions() const override;
+  void Reset() override;
 
   std::shared_ptr<InterfacePrivate> interface;
 
-  std::vector<uint8_t> data;
+  BlockData data;
   std::span<const uint8_t> packet_data_slice;
   std::span<const uint8_t> options_data_slice;
 
@@ -0,0 +1,433 @@
+#include "pcapng_slicer/parallel_scanner.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "block_data.h"
+#include "block_parsing.h"
+#include "block_types.h"
+#include "error.h"
+#include "interface_private.h"
+#include "mapped_file_source.h"
+#include "packet_pool.h"
+#include "packet_private.h"
+#include "read_utils.h"
+#include "section_private.h"
+
+namespace pcapng_slicer {
+namespace {
+
+// Number of consecutive valid blocks required to accept a resynchronisation point, unless the end
+// of the file is reached earlier.
+constexpr int kResyncConfirmBlocks = 4;
+// Each worker thread gets several ranges on average, so uneven ranges are balanced.
+constexpr size_t kRangesPerThread = 4;
+
+constexpr auto kKnownBlockTypes = std::to_array<uint32_t>({
+    static_cast<uint32_t>(PcapngBlockType::kSectionHeader),
+    static_cast<uint32_t>(PcapngBlockType::kInterfaceDescription),
+    static_cast<uint32_t>(PcapngBlockType::kSimplePacket),
+    static_cast<uint32_t>(PcapngBlockType::kNameResolutionBlock),
+    static_cast<uint32_t>(PcapngBlockType::kInterfaceStatisticsBlock),
+    static_cast<uint32_t>(PcapngBlockType::kEnchancedPacket),
+    static_cast<uint32_t>(PcapngBlockType::kSystemdJournalExportBlock),
+    static_cast<uint32_t>(PcapngBlockType::kDecriptionSecretsBlock),
+    static_cast<uint32_t>(PcapngBlockType::kCustomBlock1),
+    static_cast<uint32_t>(PcapngBlockType::kCustomBlock2),
+});
+
+// Part of the file processed by a single task.
+struct Range {
+  // The range consists of the blocks starting before this offset.
+  uint64_t limit = 0;
+  // Offset of the first block of the range.
+  uint64_t begin = 0;
+  // Offset of the first block after the range.
+  uint64_t end = 0;
+  // Byte order at the beginning and at the end of the range.
+  bool swapped = false;
+  bool end_swapped = false;
+  ErrorType error = ErrorType::kNoError;
+  // Offsets of section header and interface description blocks.
+  std::vector<uint64_t> structure_blocks;
+
+  // Section state at the beginning of the range.
+  std::shared_ptr<SectionPrivate> section;
+  size_t interfaces_count = 0;
+  // Sections started inside of the range in the file order.
+  std::vector<std::shared_ptr<SectionPrivate>> sections;
+};
+
+// The first error detected by the workers, the one with the lowest offset wins.
+class ScanErrorState {
+ public:
+  void SetError(ErrorType error, uint64_t offset) {
+    std::lock_guard lock(mutex_);
+    if (offset < error_offset_) {
+      error_ = error;
+      error_offset_ = offset;
+    }
+    stop_ = true;
+  }
+
+  void SetException(std::exception_ptr exception) {
+    std::lock_guard lock(mutex_);
+    if (!exception_) {
+      exception_ = std::move(exception);
+    }
+    stop_ = true;
+  }
+
+  bool ShouldStop() const { return stop_.load(std::memory_order_relaxed); }
+
+  // Rethrows the user exception if any and returns the error.
+  ErrorType Finish() const {
+    if (exception_) {
+      std::rethrow_exception(exception_);
+    }
+    return error_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::atomic<bool> stop_ = false;
+  std::exception_ptr exception_;
+  ErrorType error_ = ErrorType::kNoError;
+  uint64_t error_offset_ = std::numeric_limits<uint64_t>::max();
+};
+
+struct BlockBoundary {
+  uint64_t offset = 0;
+  bool swapped = false;
+};
+
+uint32_t BlockType(std::span<const uint8_t> file, uint64_t offset, bool swapped) {
+  return CastValue<uint32_t>(file.subspan(offset), swapped);
+}
+
+uint32_t BlockLength(std::span<const uint8_t> file, uint64_t offset, bool swapped) {
+  return CastValue<uint32_t>(file.subspan(offset + sizeof(uint32_t)), swapped);
+}
+
+// Returns the byte order of the block at `offset`. Section header defines it by its Byte-Order
+// Magic, other blocks keep the byte order of the current section. Returns nullopt if the magic is
+// invalid.
+std::optional<bool> GetBlockByteOrder(std::span<const uint8_t> file, uint64_t offset,
+                                      bool swapped) {
+  // Section header type is the same in both byte orders.
+  if (BlockType(file, offset, false) != static_cast<uint32_t>(PcapngBlockType::kSectionHeader) ||
+      file.size() - offset < 3 * sizeof(uint32_t)) {
+    return swapped;
+  }
+
+  const auto magic = CastValue<uint32_t>(file.subspan(offset + 2 * sizeof(uint32_t)));
+  if (magic == kByteOrderMagic) {
+    return false;
+  }
+  if (magic == ByteSwap(kByteOrderMagic)) {
+    return true;
+  }
+  return std::nullopt;
+}
+
+// Validates both leading and trailing lengths of the block at `offset`.
+ErrorType ValidateBlock(std::span<const uint8_t> file, uint64_t offset, bool swapped) {
+  const auto block = file.subspan(offset);
+  if (block.size() < 2 * sizeof(uint32_t)) {
+    return ErrorType::kTruncatedFile;
+  }
+
+  const uint32_t length = BlockLength(file, offset, swapped);
+  if (length % kBlockAlignment != 0 || length < kEmptyBlockSize) {
+    return ErrorType::kInvalidBlockSize;
+  }
+  if (block.size() < length) {
+    return ErrorType::kTruncatedFile;
+  }
+  if (CastValue<uint32_t>(block.subspan(length - sizeof(uint32_t)), swapped) != length) {
+    return ErrorType::kInvalidBlockSize;
+  }
+  return ErrorType::kNoError;
+}
+
+bool IsBlockBoundary(std::span<const uint8_t> file, uint64_t offset, bool swapped) {
+  if (file.size() - offset < kEmptyBlockSize ||
+      std::ranges::find(kKnownBlockTypes, BlockType(file, offset, swapped)) ==
+          kKnownBlockTypes.end()) {
+    return false;
+  }
+
+  for (int i = 0; i < kResyncConfirmBlocks && offset != file.size(); ++i) {
+    const std::optional<bool> block_swapped = GetBlockByteOrder(file, offset, swapped);
+    if (!block_swapped || ValidateBlock(file, offset, *block_swapped) != ErrorType::kNoError) {
+      return false;
+    }
+    swapped = *block_swapped;
+    offset += BlockLength(file, offset, swapped);
+  }
+  return true;
+}
+
+// Returns the first block boundary in [from, limit) or `limit` if there is none. The byte order of
+// the section isn't known, so both of them are tried.
+BlockBoundary FindBlockBoundary(std::span<const uint8_t> file, uint64_t from, uint64_t limit) {
+  uint64_t offset = from + GetPaddingToOctet(from);
+  for (; offset < limit; offset += kBlockAlignment) {
+    for (const bool swapped : {false, true}) {
+      if (IsBlockBoundary(file, offset, swapped)) {
+        return {.offset = offset, .swapped = swapped};
+      }
+    }
+  }
+  return {.offset = limit};
+}
+
+// Follows the blocks chain from `begin` until the range limit.
+void WalkRange(std::span<const uint8_t> file, BlockBoundary begin, Range& range) {
+  range.begin = begin.offset;
+  range.swapped = begin.swapped;
+  range.error = ErrorType::kNoError;
+  range.structure_blocks.clear();
+
+  uint64_t offset = begin.offset;
+  bool swapped = begin.swapped;
+  while (offset < range.limit && offset < file.size()) {
+    const std::optional<bool> block_swapped = GetBlockByteOrder(file, offset, swapped);
+    if (!block_swapped) {
+      range.error = ErrorType::kInvalidBlockDetected;
+      break;
+    }
+    swapped = *block_swapped;
+    range.error = ValidateBlock(file, offset, swapped);
+    if (range.error != ErrorType::kNoError) {
+      break;
+    }
+
+    const uint32_t type = BlockType(file, offset, swapped);
+    if (type == static_cast<uint32_t>(PcapngBlockType::kSectionHeader) ||
+        type == static_cast<uint32_t>(PcapngBlockType::kInterfaceDescription)) {
+      range.structure_blocks.push_back(offset);
+    }
+    offset += BlockLength(file, offset, swapped);
+  }
+  range.end = offset;
+  range.end_swapped = swapped;
+}
+
+BlockData BorrowBlockBody(const std::shared_ptr<const MappedFile>& mapping, uint64_t offset,
+                          bool swapped) {
+  const auto file = mapping->data();
+  const uint32_t length = BlockLength(file, offset, swapped);
+  BlockData data;
+  data.Borrow(file.subspan(offset + 2 * sizeof(uint32_t), length - kEmptyBlockSize), mapping);
+  return data;
+}
+
+// Parses the section header and interface blocks sequentially and assigns the section state to
+// every range.
+void ParseStructureBlocks(const std::shared_ptr<const MappedFile>& mapping,
+                          std::vector<Range>& ranges) {
+  const auto file = mapping->data();
+  std::shared_ptr<SectionPrivate> section;
+  size_t interfaces_count = 0;
+  for (Range& range : ranges) {
+    range.section = section;
+    range.interfaces_count = interfaces_count;
+    for (const uint64_t offset : range.structure_blocks) {
+      if (BlockType(file, offset, false) ==
+          static_cast<uint32_t>(PcapngBlockType::kSectionHeader)) {
+        // The magic was already validated by the walk.
+        const bool swapped = GetBlockByteOrder(file, offset, false).value();
+        section = ValueOrThrow(
+            ParseSectionHeaderBlock(BorrowBlockBody(mapping, offset, swapped), offset));
+        interfaces_count = 0;
+        range.sections.push_back(section);
+      } else {
+        assert(section);
+        section->PushInterface(ValueOrThrow(ParseInterfaceBlock(
+            *section, BorrowBlockBody(mapping, offset, section->swapped), offset)));
+        ++interfaces_count;
+      }
+    }
+  }
+}
+
+void ScanRange(const std::shared_ptr<const MappedFile>& mapping, const Range& range,
+               PacketPool& pool, ScanErrorState& error_state,
+               const ParallelScanner::PacketCallback& callback) {
+  const auto file = mapping->data();
+  std::shared_ptr<SectionPrivate> section = range.section;
+  size_t interfaces_count = range.interfaces_count;
+  auto next_section = range.sections.begin();
+  bool swapped = range.swapped;
+
+  uint64_t offset = range.begin;
+  try {
+    for (; offset < range.end && !error_state.ShouldStop();
+         offset += BlockLength(file, offset, swapped)) {
+      std::unique_ptr<PacketPrivate> packet;
+      switch (BlockType(file, offset, swapped)) {
+        case static_cast<uint32_t>(PcapngBlockType::kSectionHeader):
+          assert(next_section != range.sections.end());
+          section = *next_section++;
+          swapped = section->swapped;
+          interfaces_count = 0;
+          break;
+        case static_cast<uint32_t>(PcapngBlockType::kInterfaceDescription):
+          ++interfaces_count;
+          break;
+        case static_cast<uint32_t>(PcapngBlockType::kSimplePacket): {
+          if (interfaces_count == 0) {
+            throw Error(ErrorType::kInvalidInterfaceForPacket);
+          }
+          auto simple_packet = pool.AcquireSimplePacket();
+          simple_packet->data = BorrowBlockBody(mapping, offset, swapped);
+          ThrowIfError(ParseSimplePacketBlock(*section, *simple_packet));
+          packet = std::move(simple_packet);
+          break;
+        }
+        case static_cast<uint32_t>(PcapngBlockType::kEnchancedPacket): {
+          auto enchansed_packet = pool.AcquireEnchansedPacket();
+          enchansed_packet->data = BorrowBlockBody(mapping, offset, swapped);
+          // Interfaces defined later in the section are not available yet.
+          const auto body = enchansed_packet->data.view();
+          if (body.size() >= sizeof(uint32_t) &&
+              CastValue<uint32_t>(body, swapped) >= interfaces_count) {
+            throw Error(ErrorType::kInvalidInterfaceForPacket);
+          }
+          ThrowIfError(ParseEnchansedPacketBlock(*section, *enchansed_packet));
+          packet = std::move(enchansed_packet);
+          break;
+        }
+        default:
+          // Ignore unkown blocks.
+          break;
+      }
+
+      if (packet) {
+        const Interface interface(packet->GetInterface());
+        callback(Packet(std::move(packet)), interface, offset);
+      }
+    }
+  } catch (const Error& e) {
+    error_state.SetError(e.type(), offset);
+  } catch (...) {
+    error_state.SetException(std::current_exception());
+  }
+}
+
+// Calls `task(task_index, worker_index)` for every task using up to `threads_count` threads.
+template <typename Task>
+void RunParallel(size_t tasks_count, size_t threads_count, const Task& task) {
+  std::atomic<size_t> next_task = 0;
+  auto worker = [&](size_t worker_index) {
+    for (size_t i = next_task++; i < tasks_count; i = next_task++) {
+      task(i, worker_index);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < threads_count; ++i) {
+    threads.emplace_back(worker, i);
+  }
+  // The calling thread works too.
+  worker(0);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace
+
+ParallelScanner::ParallelScanner(const ParallelScannerConfig& config) : config_(config) {
+  if (config_.threads_count == 0) {
+    config_.threads_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+  config_.min_range_size = std::max<uint64_t>(config_.min_range_size, kBlockAlignment);
+}
+
+bool ParallelScanner::Scan(const std::filesystem::path& path, const PacketCallback& callback) {
+  last_error_ = ErrorType::kNoError;
+  try {
+    ScanImpl(path, callback);
+  } catch (const Error& e) {
+    last_error_ = e.type();
+  }
+  return last_error_ == ErrorType::kNoError;
+}
+
+void ParallelScanner::ScanImpl(const std::filesystem::path& path, const PacketCallback& callback) {
+  if (!std::filesystem::exists(path)) {
+    throw Error(ErrorType::kFileNotFound);
+  }
+  const auto mapping = std::make_shared<const MappedFile>(path);
+  const auto file = mapping->data();
+  if (file.size() < 2 * sizeof(uint32_t)) {
+    throw Error(ErrorType::kTruncatedFile);
+  }
+  if (BlockType(file, 0, false) != static_cast<uint32_t>(PcapngBlockType::kSectionHeader)) {
+    throw Error(ErrorType::kFirstBlockIsNotSectionHeader);
+  }
+
+  const uint64_t max_ranges_count = config_.threads_count * kRangesPerThread;
+  const uint64_t ranges_count = std::clamp<uint64_t>(
+      (file.size() + config_.min_range_size - 1) / config_.min_range_size, 1, max_ranges_count);
+  const size_t threads_count = std::min<size_t>(config_.threads_count, ranges_count);
+  std::vector<Range> ranges(ranges_count);
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    ranges[i].limit = file.size() * (i + 1) / ranges.size();
+  }
+
+  // Find block boundaries and structure blocks of every range concurrently.
+  RunParallel(ranges.size(), threads_count, [&](size_t index, size_t) {
+    Range& range = ranges[index];
+    const uint64_t from = index == 0 ? 0 : ranges[index - 1].limit;
+    WalkRange(file, index == 0 ? BlockBoundary{} : FindBlockBoundary(file, from, range.limit),
+              range);
+  });
+
+  // The first range always starts at a real boundary, so walking the chain verifies every following
+  // resynchronisation point. Ranges which were resynchronised wrongly are walked again.
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    if (i > 0 && (ranges[i].begin != ranges[i - 1].end ||
+                  ranges[i].swapped != ranges[i - 1].end_swapped)) {
+      WalkRange(file, {.offset = ranges[i - 1].end, .swapped = ranges[i - 1].end_swapped},
+                ranges[i]);
+    }
+    if (ranges[i].error != ErrorType::kNoError) {
+      // Blocks before the error are still scanned, like the Reader does.
+      ranges.resize(i + 1);
+      break;
+    }
+  }
+  const ErrorType walk_error = ranges.back().error;
+
+  ParseStructureBlocks(mapping, ranges);
+
+  ScanErrorState error_state;
+  std::vector<std::shared_ptr<PacketPool>> pools(threads_count);
+  for (auto& pool : pools) {
+    pool = std::make_shared<PacketPool>();
+  }
+  RunParallel(ranges.size(), threads_count, [&](size_t index, size_t worker_index) {
+    ScanRange(mapping, ranges[index], *pools[worker_index], error_state, callback);
+  });
+
+  if (const ErrorType error = error_state.Finish(); error != ErrorType::kNoError) {
+    throw Error(error);
+  }
+  if (walk_error != ErrorType::kNoError) {
+    throw Error(walk_error);
+  }
+}
+
+}  // namespace pcapng_slicer
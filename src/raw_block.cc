@@ -0,0 +1,19 @@
+#include "pcapng_slicer/raw_block.h"
+
+#include "block_data.h"
+
+namespace pcapng_slicer {
+
+RawBlock::RawBlock() = default;
+
+RawBlock::~RawBlock() = default;
+
+RawBlock::RawBlock(RawBlock&& other) = default;
+
+RawBlock& RawBlock::operator=(RawBlock&& other) = default;
+
+std::span<const uint8_t> RawBlock::GetBody() const {
+  return data_ ? data_->view() : std::span<const uint8_t>{};
+}
+
+}  // namespace pcapng_slicer
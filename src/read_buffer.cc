@@ -0,0 +1,16 @@
+#include "read_buffer.h"
+
+namespace pcapng_slicer {
+
+void ReadBuffer::MakeRoom(size_t size) {
+  if (begin_ > 0) {
+    std::memmove(buffer_.data(), buffer_.data() + begin_, this->size());
+    end_ -= begin_;
+    begin_ = 0;
+  }
+  if (buffer_.size() < size) {
+    buffer_.resize(size);
+  }
+}
+
+}  // namespace pcapng_slicer
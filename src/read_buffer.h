@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+namespace pcapng_slicer {
+
+// Data read ahead from a source which is read sequentially. The source is given by the function
+// `int64_t read(std::span<uint8_t>)`, which reads the next data into the span and returns the
+// number of read bytes, or zero (negative) if there is no more data at the moment.
+//
+// The unread data is moved to the front of the buffer when it is refilled, which is cheap as it is
+// just the tail of the previous read, so the buffer never wraps and views of it are contiguous.
+class ReadBuffer {
+ public:
+  explicit ReadBuffer(size_t capacity) : buffer_(std::max<size_t>(capacity, 1)) {}
+
+  size_t size() const { return end_ - begin_; }
+  // The unread data, valid until the next call of a non-const function.
+  std::span<const uint8_t> data() const {
+    return std::span<const uint8_t>(buffer_).subspan(begin_, size());
+  }
+  // Moves past up to `size` bytes of the unread data and returns the number of skipped bytes.
+  size_t Consume(size_t size) {
+    size = std::min(size, this->size());
+    begin_ += size;
+    return size;
+  }
+
+  // Reads until at least `size` bytes are buffered, the buffer grows if it is smaller. Returns
+  // false if the source has no more data.
+  template <typename ReadFunction>
+  bool Fill(size_t size, ReadFunction&& read) {
+    if (this->size() >= size) {
+      return true;
+    }
+    MakeRoom(size);
+    while (end_ < size) {
+      const int64_t result = read(std::span(buffer_).subspan(end_));
+      if (result <= 0) {
+        return false;
+      }
+      end_ += static_cast<size_t>(result);
+    }
+    return true;
+  }
+
+  // Copies up to dst.size() bytes into `dst` and returns the number of copied bytes. Reads larger
+  // than the buffer bypass it, as buffering would just add a copy.
+  template <typename ReadFunction>
+  size_t Read(std::span<uint8_t> dst, ReadFunction&& read) {
+    size_t copied = 0;
+    while (copied < dst.size()) {
+      const size_t remaining = dst.size() - copied;
+      if (size() == 0 && remaining >= buffer_.size()) {
+        const int64_t result = read(dst.subspan(copied));
+        if (result <= 0) {
+          break;
+        }
+        copied += static_cast<size_t>(result);
+        continue;
+      }
+      if (!Fill(1, read)) {
+        break;
+      }
+      const size_t size = std::min(remaining, this->size());
+      std::memcpy(dst.data() + copied, buffer_.data() + begin_, size);
+      begin_ += size;
+      copied += size;
+    }
+    return copied;
+  }
+
+ private:
+  // Moves the unread data to the front and grows the buffer to at least `size` bytes if needed.
+  void MakeRoom(size_t size);
+
+  std::vector<uint8_t> buffer_;
+  // Range of the unread data.
+  size_t begin_ = 0;
+  size_t end_ = 0;
+};
+
+}  // namespace pcapng_slicer
@@ -1,16 +1,84 @@
 #pragma once
 
+#include <array>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <span>
 #include <type_traits>
 
+#ifdef _MSC_VER
+#include <stdlib.h>
+#endif
+
 namespace pcapng_slicer {
 
+// Byte-Order Magic of a section written by a host with the same byte order as ours.
+constexpr uint32_t kByteOrderMagic = 0x1A2B3C4D;
+
 template <typename T>
+T ByteSwap(T value) {
+  static_assert(std::is_integral_v<T>);
+  using U = std::make_unsigned_t<T>;
+  if constexpr (sizeof(T) == 1) {
+    return value;
+  } else if constexpr (sizeof(T) == 2) {
+#ifdef _MSC_VER
+    return static_cast<T>(_byteswap_ushort(static_cast<U>(value)));
+#else
+    return static_cast<T>(__builtin_bswap16(static_cast<U>(value)));
+#endif
+  } else if constexpr (sizeof(T) == 4) {
+#ifdef _MSC_VER
+    return static_cast<T>(_byteswap_ulong(static_cast<U>(value)));
+#else
+    return static_cast<T>(__builtin_bswap32(static_cast<U>(value)));
+#endif
+  } else {
+    static_assert(sizeof(T) == 8);
+#ifdef _MSC_VER
+    return static_cast<T>(_byteswap_uint64(static_cast<U>(value)));
+#else
+    return static_cast<T>(__builtin_bswap64(static_cast<U>(value)));
+#endif
+  }
+}
+
+// Reads a value of the section with the given byte order. Code which is specialised on kSwapped at
+// compile time has no overhead for the sections with the native byte order.
+template <typename T, bool kSwapped = false>
 T CastValue(std::span<const uint8_t> data) {
-  static_assert(std::is_trivially_constructible_v<T>);
+  static_assert(std::is_trivially_copyable_v<T>);
   assert(data.size() >= sizeof(T));
-  return *reinterpret_cast<const uint32_t*>(&data[0]);
+  // Block data is not guaranteed to be aligned, so the value is copied.
+  T value;
+  std::memcpy(&value, data.data(), sizeof(T));
+  if constexpr (kSwapped) {
+    value = ByteSwap(value);
+  }
+  return value;
+}
+
+// Same as above, for the code which isn't specialised on the byte order.
+template <typename T>
+T CastValue(std::span<const uint8_t> data, bool swapped) {
+  return swapped ? CastValue<T, true>(data) : CastValue<T, false>(data);
+}
+
+// Reads N consecutive 32-bit fields at once. Swapping of the whole array is a simple loop, which
+// compilers turn into vector shuffles.
+template <size_t N, bool kSwapped = false>
+std::array<uint32_t, N> CastWords(std::span<const uint8_t> data) {
+  assert(data.size() >= N * sizeof(uint32_t));
+  std::array<uint32_t, N> words;
+  std::memcpy(words.data(), data.data(), N * sizeof(uint32_t));
+  if constexpr (kSwapped) {
+    for (uint32_t& word : words) {
+      word = ByteSwap(word);
+    }
+  }
+  return words;
 }
 
 template <typename T>
@@ -3,271 +3,460 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
-#include <limits>
+#include <cstring>
+#include <functional>
 #include <memory>
 #include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "block_parsing.h"
 #include "block_reader.h"
 #include "block_types.h"
+#include "data_source.h"
 #include "error.h"
 #include "interface_private.h"
+#include "packet_pool.h"
 #include "packet_private.h"
 #include "pcapng_slicer/error_type.h"
 #include "read_utils.h"
+#include "result.h"
+#include "scoped_timer.h"
 #include "section_private.h"
+#include "stream_source.h"
 
 namespace pcapng_slicer {
 
 Reader::Reader() = default;
 
-Reader::~Reader() = default;
+Reader::~Reader() { PacketPrivate::Recycle(std::move(peeked_packet_)); }
 
 Reader::Reader(Reader&& other) = default;
 
 Reader& Reader::operator=(Reader&& other) = default;
 
-bool Reader::Open(const std::filesystem::path& path) {
-  try {
-    OpenImpl(path);
-  } catch (const Error& e) {
-    EnterErrorState(e.type());
+bool Reader::Open(const std::filesystem::path& path, const ReaderConfig& config) {
+  return OpenSource(
+      [&] {
+        if (!std::filesystem::exists(path)) {
+          throw Error(ErrorType::kFileNotFound);
+        }
+        return CreateFileSource(path, config);
+      },
+      config);
+}
+
+bool Reader::OpenStream(int fd, const ReaderConfig& config) {
+  return OpenStream(ReadFromDescriptor(fd), config);
+}
+
+bool Reader::OpenStream(StreamReadFunction read, const ReaderConfig& config) {
+  // Reading a stream blocks until more data arrives, so there is nothing to follow.
+  ReaderConfig stream_config = config;
+  stream_config.follow = false;
+  return OpenSource([&] { return CreateStreamSource(std::move(read), stream_config); },
+                    stream_config);
+}
+
+bool Reader::OpenSource(const std::function<std::unique_ptr<DataSource>()>& create_source,
+                        const ReaderConfig& config) {
+  if (const ErrorType error = OpenImpl(create_source, config); error != ErrorType::kNoError) {
+    EnterErrorState(error);
     return false;
   }
   assert(section_);
   return true;
 }
 
-void Reader::OpenImpl(const std::filesystem::path& path) {
+ErrorType Reader::OpenImpl(const std::function<std::unique_ptr<DataSource>()>& create_source,
+                           const ReaderConfig& config) {
   last_error_ = ErrorType::kNoError;
   section_.reset();
-  block_reader_ = std::make_unique<BlockReader>(path);
+  index_.reset();
+  PacketPrivate::Recycle(std::move(peeked_packet_));
+  if (!packet_pool_) {
+    packet_pool_ = std::make_shared<PacketPool>();
+  }
+  counters_ = config.counters;
+  // Opening the data source is the only part of the reading which throws.
+  try {
+    block_reader_ =
+        std::make_unique<BlockReader>(create_source(), counters_.get(), config.follow);
+  } catch (const Error& e) {
+    return e.type();
+  }
 
+  // A followed file may not have the section header written yet.
+  if (block_reader_->IsEof()) {
+    return ErrorType::kTruncatedFile;
+  }
   ScopedBlock block = block_reader_->ReadBlock();
+  if (block.error() != ErrorType::kNoError) {
+    return block.error();
+  }
   if (block.type() != static_cast<uint32_t>(PcapngBlockType::kSectionHeader)) {
-    // Must reset, because block_reader_ will be invalidated in EnterErrorState().
-    throw Error(ErrorType::kFirstBlockIsNotSectionHeader);
+    return ErrorType::kFirstBlockIsNotSectionHeader;
   }
-
-  ParseSectionHeader(block);
+  if (const ErrorType error = ParseSectionHeader(block); error != ErrorType::kNoError) {
+    return error;
+  }
+  section_header_pending_ = true;
+  return ErrorType::kNoError;
 }
 
 std::optional<Packet> Reader::ReadPacket() {
+  if (!CanRead()) {
+    return std::nullopt;
+  }
+
+  do {
+    Result<std::unique_ptr<PacketPrivate>> packet = ReadNextBlock();
+    if (!packet) {
+      EnterErrorState(packet.error());
+      return std::nullopt;
+    }
+    if (*packet) {
+      CountPackets(1);
+      return std::make_optional<Packet>(std::move(*packet));
+    }
+  } while (!block_reader_->IsEof());
+  return std::nullopt;
+}
+
+bool Reader::CanRead() {
   if (!block_reader_ && last_error_ == ErrorType::kNoError) {
     last_error_ = ErrorType::kFileWasClosed;
   }
-  if (last_error_ != ErrorType::kNoError || !block_reader_ || block_reader_->IsEof()) {
+  return last_error_ == ErrorType::kNoError && block_reader_ && !block_reader_->IsEof();
+}
+
+template <typename Consumer>
+size_t Reader::ReadPacketsImpl(size_t max_count, Consumer&& consumer) {
+  if (max_count == 0 || !CanRead()) {
+    return 0;
+  }
+
+  size_t count = 0;
+  do {
+    Result<std::unique_ptr<PacketPrivate>> packet = ReadNextBlock();
+    if (!packet) {
+      EnterErrorState(packet.error());
+      break;
+    }
+    if (*packet) {
+      consumer(std::move(*packet));
+      ++count;
+    }
+  } while (count < max_count && !block_reader_->IsEof());
+  CountPackets(count);
+  return count;
+}
+
+size_t Reader::ReadPackets(std::span<Packet> packets) {
+  size_t count = 0;
+  ReadPacketsImpl(packets.size(), [&](std::unique_ptr<PacketPrivate> packet) {
+    packets[count++] = Packet(std::move(packet));
+  });
+  return count;
+}
+
+size_t Reader::ReadPackets(std::vector<Packet>& packets, size_t max_count) {
+  return ReadPacketsImpl(max_count, [&](std::unique_ptr<PacketPrivate> packet) {
+    packets.emplace_back(std::move(packet));
+  });
+}
+
+std::optional<PacketView> Reader::PeekPacket() {
+  if (!CanRead()) {
     return std::nullopt;
   }
 
-  try {
-    do {
-      if (std::unique_ptr<PacketPrivate> packet = ReadNextBlock()) {
-        return std::make_optional<Packet>(std::move(packet));
-      }
-    } while (!block_reader_->IsEof() && last_error_ == ErrorType::kNoError);
+  std::unique_ptr<PacketPrivate> packet;
+  do {
+    Result<std::unique_ptr<PacketPrivate>> result = ReadNextBlock();
+    if (!result) {
+      EnterErrorState(result.error());
+      return std::nullopt;
+    }
+    packet = std::move(*result);
+  } while (!packet && !block_reader_->IsEof());
+  // The previous packet is either reused by now or not suitable for reuse.
+  PacketPrivate::Recycle(std::move(peeked_packet_));
+  peeked_packet_ = std::move(packet);
+  if (!peeked_packet_) {
     return std::nullopt;
-  } catch (const Error& e) {
-    EnterErrorState(e.type());
+  }
+
+  // Interface is accessed without copying the shared pointer.
+  const InterfacePrivate* interface =
+      peeked_packet_->kind() == PacketPrivate::Kind::kSimple
+          ? static_cast<const SimplePacketPrivate&>(*peeked_packet_).interface.get()
+          : static_cast<const EnchansedPacketPrivate&>(*peeked_packet_).interface.get();
+  return PacketView{
+      .data = peeked_packet_->GetData(),
+      .original_length = peeked_packet_->GetOriginalLength(),
+      .link_type = static_cast<uint16_t>(interface->link_type),
+      .timestamp = peeked_packet_->GetTimestamp(),
+  };
+}
+
+std::optional<Packet> Reader::TakePeekedPacket() {
+  if (!peeked_packet_) {
     return std::nullopt;
   }
+  CountPackets(1);
+  return std::make_optional<Packet>(std::move(peeked_packet_));
 }
 
-std::unique_ptr<PacketPrivate> Reader::ReadNextBlock() {
-  assert(block_reader_);
+bool Reader::ReadRawBlock(RawBlock& block) {
+  if (!block.data_) {
+    block.data_ = std::make_unique<BlockData>();
+  }
+  // The section header may be the only block of the file, so it is checked before the end of file.
+  if (IsValid() && std::exchange(section_header_pending_, false)) {
+    const auto body = section_->data.view();
+    std::memcpy(block.data_->Allocate(body.size()).data(), body.data(), body.size());
+    block.type_ = static_cast<uint32_t>(PcapngBlockType::kSectionHeader);
+    block.position_ = section_->block_position;
+    block.swapped_ = section_->swapped;
+    return true;
+  }
+  if (!CanRead()) {
+    return false;
+  }
 
-  ScopedBlock block = block_reader_->ReadBlock();
-  switch (block.type()) {
-    case static_cast<uint32_t>(PcapngBlockType::kSectionHeader):
-      ParseSectionHeader(block);
-      return nullptr;
-    case static_cast<uint32_t>(PcapngBlockType::kInterfaceDescription):
-      ParseInterface(block);
-      return nullptr;
-    case static_cast<uint32_t>(PcapngBlockType::kSimplePacket):
-      return ParseSimplePacket(block);
-    case static_cast<uint32_t>(PcapngBlockType::kEnchancedPacket):
-      return ParseEnchansedPacket(block);
-    default:
-      // Ignore unkown blocks.
-      return nullptr;
+  if (const ErrorType error = ReadRawBlockImpl(block); error != ErrorType::kNoError) {
+    EnterErrorState(error);
+    return false;
+  }
+  return true;
+}
+
+ErrorType Reader::ReadRawBlockImpl(RawBlock& block) {
+  ScopedBlock scoped_block = block_reader_->ReadBlock();
+  if (scoped_block.error() != ErrorType::kNoError) {
+    return scoped_block.error();
+  }
+  block.type_ = scoped_block.type();
+  block.position_ = scoped_block.position();
+  if (const ErrorType error = scoped_block.ReadData(*block.data_); error != ErrorType::kNoError) {
+    return error;
+  }
+
+  // Structure blocks are rare, so they are just copied for parsing.
+  if (block.type_ == static_cast<uint32_t>(PcapngBlockType::kSectionHeader) ||
+      block.type_ == static_cast<uint32_t>(PcapngBlockType::kInterfaceDescription)) {
+    const auto body = block.data_->view();
+    BlockData data;
+    std::memcpy(data.Allocate(body.size()).data(), body.data(), body.size());
+    if (block.type_ == static_cast<uint32_t>(PcapngBlockType::kSectionHeader)) {
+      Result<std::shared_ptr<SectionPrivate>> section =
+          ParseSectionHeaderBlock(std::move(data), block.position_);
+      if (!section) {
+        return section.error();
+      }
+      section_ = std::move(*section);
+    } else {
+      Result<std::shared_ptr<InterfacePrivate>> interface =
+          ParseInterfaceBlock(*section_, std::move(data), block.position_);
+      if (!interface) {
+        return interface.error();
+      }
+      section_->PushInterface(std::move(*interface));
+    }
   }
+  block.swapped_ = section_->swapped;
+  return ErrorType::kNoError;
 }
 
-//                         1                   2                   3
-//     0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-//  0 |                   Block Type = 0x0A0D0D0A                     |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-//  4 |                      Block Total Length                       |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-//  8 |                      Byte-Order Magic                         |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-// 12 |          Major Version        |         Minor Version         |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-// 16 |                                                               |
-//    |                       Section Length                          |
-//    |                                                               |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-// 24 /                                                               /
-//    /                      Options (variable)                       /
-//    /                                                               /
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-//    |                      Block Total Length                       |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-void Reader::ParseSectionHeader(ScopedBlock& block) {
-  auto section = std::make_shared<SectionPrivate>();
-  section->data = block.ReadData();
-
-  std::span<const uint8_t> data_slice(section->data);
-  if (data_slice.size() < 4 * sizeof(uint32_t)) {
-    throw Error(ErrorType::kInvalidBlockSize);
-  }
-
-  section->block_position = block.position();
-  section->version_major = CastValue<uint16_t>(data_slice.subspan(4));
-  section->version_minor = CastValue<uint16_t>(data_slice.subspan(6));
-  section->section_length = CastValue<uint64_t>(data_slice.subspan(8));
-
-  section_ = std::move(section);
+bool Reader::SetIndex(PacketIndex index) {
+  if (!IsValid() || block_reader_->DataSize() != index.GetCaptureSize()) {
+    return false;
+  }
+  index_ = std::move(index);
+  return true;
 }
 
-//                         1                   2                   3
-//     0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-//  0 |                    Block Type = 0x00000001                    |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-//  4 |                      Block Total Length                       |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-//  8 |           LinkType            |           Reserved            |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-// 12 |                            SnapLen                            |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-// 16 /                                                               /
-//    /                      Options (variable)                       /
-//    /                                                               /
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-//    |                      Block Total Length                       |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-void Reader::ParseInterface(ScopedBlock& block) {
-  assert(section_);
-  auto interface = std::make_shared<InterfacePrivate>();
-  interface->data = block.ReadData();
+bool Reader::SeekToPacket(size_t packet_number) {
+  if (!IsValid() || !index_ || packet_number >= index_->size()) {
+    return false;
+  }
 
-  std::span<const uint8_t> data_slice(interface->data);
-  if (data_slice.size() < 2 * sizeof(uint32_t)) { 
-    throw Error(ErrorType::kInvalidBlockSize);
+  if (const ErrorType error = SeekToPacketImpl(packet_number); error != ErrorType::kNoError) {
+    EnterErrorState(error);
+    return false;
   }
+  return true;
+}
 
-  interface->block_position = block.position();
-  interface->link_type = CastValue<uint16_t>(data_slice);
-  interface->snap_len = CastValue<uint32_t>(data_slice.subspan(4));
-  if (interface->snap_len == 0) {
-    interface->snap_len = std::numeric_limits<uint32_t>::max();
+bool Reader::SeekToTime(uint64_t timestamp) {
+  if (!index_) {
+    return false;
   }
-  
-  section_->PushInterface(std::move(interface));
+  const std::optional<size_t> packet_number = index_->FindPacketByTime(timestamp);
+  return packet_number && SeekToPacket(*packet_number);
 }
 
-//                         1                   2                   3
-//     0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-//  0 |                    Block Type = 0x00000003                    |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-//  4 |                      Block Total Length                       |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-//  8 |                    Original Packet Length                     |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-// 12 /                                                               /
-//    /                          Packet Data                          /
-//    /              variable length, padded to 32 bits               /
-//    /                                                               /
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-//    |                      Block Total Length                       |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-std::unique_ptr<PacketPrivate> Reader::ParseSimplePacket(ScopedBlock& block) {
-  assert(section_);
-  size_t iface_count = section_->GetInterfaceCount();
-  if (iface_count == 0) {
-    throw Error(ErrorType::kInvalidInterfaceForPacket);
+ErrorType Reader::SeekToPacketImpl(size_t packet_number) {
+  assert(index_ && block_reader_);
+  section_header_pending_ = false;
+  // Packets may refer only to the interfaces of their own section, so the section must be read
+  // again, unless the reader is already in it.
+  const PacketIndex::Section& section = index_->GetPacketSection(packet_number);
+  if (!section_ || section_->block_position != section.offset ||
+      section_->GetInterfaceCount() < section.interface_offsets.size()) {
+    ErrorType error = ReadStructureBlockAt(
+        section.offset, static_cast<uint32_t>(PcapngBlockType::kSectionHeader));
+    for (size_t i = 0; i < section.interface_offsets.size() && error == ErrorType::kNoError; ++i) {
+      error = ReadStructureBlockAt(section.interface_offsets[i],
+                                   static_cast<uint32_t>(PcapngBlockType::kInterfaceDescription));
+    }
+    if (error != ErrorType::kNoError) {
+      return error;
+    }
   }
 
-  auto packet = std::make_unique<SimplePacketPrivate>();
-  packet->interface = section_->GetInterface(0);
-  packet->data = block.ReadData();
-  if (packet->data.size() < sizeof(uint32_t)) {
-    throw Error(ErrorType::kInvalidBlockSize);
+  if (!block_reader_->Seek(index_->Entries()[packet_number].offset)) {
+    return ErrorType::kInvalidIndex;
   }
+  return ErrorType::kNoError;
+}
 
-  packet->original_length = CastValue<uint32_t>(packet->data);
-  if (std::min(packet->original_length, packet->interface->snap_len) >
-      packet->data.size() - sizeof(uint32_t)) {
-    throw Error(ErrorType::kInvalidBlockSize);
+ErrorType Reader::ReadStructureBlockAt(uint64_t offset, uint32_t type) {
+  if (!block_reader_->Seek(offset) || block_reader_->IsEof()) {
+    return ErrorType::kInvalidIndex;
   }
 
-  return packet;
+  ScopedBlock block = block_reader_->ReadBlock();
+  if (block.error() != ErrorType::kNoError) {
+    return block.error();
+  }
+  if (block.type() != type) {
+    return ErrorType::kInvalidIndex;
+  }
+  if (type == static_cast<uint32_t>(PcapngBlockType::kSectionHeader)) {
+    return ParseSectionHeader(block);
+  }
+  return ParseInterface(block);
 }
 
-//                         1                   2                   3
-//     0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-//  0 |                    Block Type = 0x00000006                    |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-//  4 |                      Block Total Length                       |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-//  8 |                         Interface ID                          |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-// 12 |                        Timestamp (High)                       |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-// 16 |                        Timestamp (Low)                        |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-// 20 |                    Captured Packet Length                     |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-// 24 |                    Original Packet Length                     |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-// 28 /                                                               /
-//    /                          Packet Data                          /
-//    /              variable length, padded to 32 bits               /
-//    /                                                               /
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-//    /                                                               /
-//    /                      Options (variable)                       /
-//    /                                                               /
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-//    |                      Block Total Length                       |
-//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-std::unique_ptr<PacketPrivate> Reader::ParseEnchansedPacket(ScopedBlock& block) {
-  assert(section_);
-  auto packet = std::make_unique<EnchansedPacketPrivate>();
-  packet->data = block.ReadData();
+Result<std::unique_ptr<PacketPrivate>> Reader::ReadNextBlock() {
+  assert(block_reader_);
+  section_header_pending_ = false;
+
+  ErrorType error = ErrorType::kNoError;
+  {
+    ScopedBlock block = block_reader_->ReadBlock();
+    if (block.error() != ErrorType::kNoError) {
+      return block.error();
+    }
+    switch (block.type()) {
+      case static_cast<uint32_t>(PcapngBlockType::kSectionHeader):
+        error = ParseSectionHeader(block);
+        break;
+      case static_cast<uint32_t>(PcapngBlockType::kInterfaceDescription):
+        error = ParseInterface(block);
+        break;
+      case static_cast<uint32_t>(PcapngBlockType::kSimplePacket):
+        return ParseSimplePacket(block);
+      case static_cast<uint32_t>(PcapngBlockType::kEnchancedPacket):
+        return ParseEnchansedPacket(block);
+      default:
+        // Ignore unkown blocks, their bodies are skipped when the block is destroyed.
+        break;
+    }
+  }
+  // Skipping the body may fail too.
+  if (error == ErrorType::kNoError) {
+    error = block_reader_->LastError();
+  }
+  if (error != ErrorType::kNoError) {
+    return error;
+  }
+  return std::unique_ptr<PacketPrivate>();
+}
 
-  std::span<const uint8_t> packet_data_slice(packet->data);
-  if (packet_data_slice.size() < EnchansedPacketPrivate::kRequiredSize) {
-    throw Error(ErrorType::kInvalidBlockSize);
+ErrorType Reader::ParseSectionHeader(ScopedBlock& block) {
+  const uint64_t block_position = block.position();
+  BlockData data;
+  if (const ErrorType error = block.ReadData(data); error != ErrorType::kNoError) {
+    return error;
+  }
+  ScopedTimer timer(counters_.get(), &ReaderStats::parse_time_ns);
+  Result<std::shared_ptr<SectionPrivate>> section =
+      ParseSectionHeaderBlock(std::move(data), block_position);
+  if (!section) {
+    return section.error();
   }
+  section_ = std::move(*section);
+  return ErrorType::kNoError;
+}
 
-  const auto iface_id = CastValue<uint32_t>(packet_data_slice);
-  if (iface_id >= section_->GetInterfaceCount()) {
-    throw Error(ErrorType::kInvalidInterfaceForPacket);
+ErrorType Reader::ParseInterface(ScopedBlock& block) {
+  assert(section_);
+  const uint64_t block_position = block.position();
+  BlockData data;
+  if (const ErrorType error = block.ReadData(data); error != ErrorType::kNoError) {
+    return error;
+  }
+  ScopedTimer timer(counters_.get(), &ReaderStats::parse_time_ns);
+  Result<std::shared_ptr<InterfacePrivate>> interface =
+      ParseInterfaceBlock(*section_, std::move(data), block_position);
+  if (!interface) {
+    return interface.error();
   }
-  packet->interface = section_->GetInterface(iface_id);
+  section_->PushInterface(std::move(*interface));
+  return ErrorType::kNoError;
+}
 
-  uint64_t timestamp_high = CastValue<uint32_t>(packet_data_slice.subspan(4));
-  uint64_t timestamp_low = CastValue<uint32_t>(packet_data_slice.subspan(8));
-  packet->timestamp = (timestamp_high << 32 | timestamp_low);
+template <typename T>
+std::unique_ptr<T> Reader::AcquirePacket() {
+  constexpr auto kind = std::is_same_v<T, SimplePacketPrivate> ? PacketPrivate::Kind::kSimple
+                                                                : PacketPrivate::Kind::kEnchansed;
+  if (peeked_packet_ && peeked_packet_->kind() == kind) {
+    return std::unique_ptr<T>(static_cast<T*>(peeked_packet_.release()));
+  }
+  if constexpr (kind == PacketPrivate::Kind::kSimple) {
+    return packet_pool_->AcquireSimplePacket(counters_.get());
+  } else {
+    return packet_pool_->AcquireEnchansedPacket(counters_.get());
+  }
+}
 
-  const uint32_t captured_length = CastValue<uint32_t>(packet_data_slice.subspan(12));
-  if (captured_length > packet_data_slice.size() - EnchansedPacketPrivate::kRequiredSize) {
-    throw Error(ErrorType::kInvalidBlockSize);
+Result<std::unique_ptr<PacketPrivate>> Reader::ParseSimplePacket(ScopedBlock& block) {
+  assert(section_);
+  auto packet = AcquirePacket<SimplePacketPrivate>();
+  if (const ErrorType error = block.ReadData(packet->data); error != ErrorType::kNoError) {
+    return error;
+  }
+  ScopedTimer timer(counters_.get(), &ReaderStats::parse_time_ns);
+  if (const ErrorType error = ParseSimplePacketBlock(*section_, *packet);
+      error != ErrorType::kNoError) {
+    return error;
   }
+  return std::unique_ptr<PacketPrivate>(std::move(packet));
+}
 
-  packet->original_length = CastValue<uint32_t>(packet_data_slice.subspan(16));
-  packet->packet_data_slice =
-      packet_data_slice.subspan(EnchansedPacketPrivate::kRequiredSize, captured_length);
-  packet->options_data_slice = packet_data_slice.subspan(
-      EnchansedPacketPrivate::kRequiredSize + captured_length + GetPaddingToOctet(captured_length));
+Result<std::unique_ptr<PacketPrivate>> Reader::ParseEnchansedPacket(ScopedBlock& block) {
+  assert(section_);
+  auto packet = AcquirePacket<EnchansedPacketPrivate>();
+  if (const ErrorType error = block.ReadData(packet->data); error != ErrorType::kNoError) {
+    return error;
+  }
+  ScopedTimer timer(counters_.get(), &ReaderStats::parse_time_ns);
+  if (const ErrorType error = ParseEnchansedPacketBlock(*section_, *packet);
+      error != ErrorType::kNoError) {
+    return error;
+  }
+  return std::unique_ptr<PacketPrivate>(std::move(packet));
+}
 
-  return packet;
+void Reader::CountPackets(size_t count) {
+  if (counters_) {
+    counters_->Add(&ReaderStats::packets_count, count);
+  }
 }
 
 bool Reader::IsValid() const { return !!block_reader_ && last_error_ == ErrorType::kNoError; }
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cassert>
+#include <utility>
+
+#include "error.h"
+#include "pcapng_slicer/error_type.h"
+
+namespace pcapng_slicer {
+
+// Either a value or the error which prevented getting it, a minimal replacement of std::expected.
+// Used by the block reading and parsing pipeline, where malformed and truncated files are common
+// enough for the exceptions to be too costly.
+template <typename T>
+class [[nodiscard]] Result {
+ public:
+  Result(T value) : value_(std::move(value)) {}
+  Result(ErrorType error) : error_(error) { assert(error != ErrorType::kNoError); }
+
+  bool has_value() const { return error_ == ErrorType::kNoError; }
+  explicit operator bool() const { return has_value(); }
+  ErrorType error() const { return error_; }
+
+  T& value() & {
+    assert(has_value());
+    return value_;
+  }
+  const T& value() const& {
+    assert(has_value());
+    return value_;
+  }
+  T&& value() && {
+    assert(has_value());
+    return std::move(value_);
+  }
+  T& operator*() & { return value(); }
+  const T& operator*() const& { return value(); }
+  T&& operator*() && { return std::move(*this).value(); }
+  T* operator->() { return &value(); }
+  const T* operator->() const { return &value(); }
+
+ private:
+  T value_{};
+  ErrorType error_ = ErrorType::kNoError;
+};
+
+// Bridges to the code which reports errors by exceptions.
+inline void ThrowIfError(ErrorType error) {
+  if (error != ErrorType::kNoError) {
+    throw Error(error);
+  }
+}
+
+template <typename T>
+T ValueOrThrow(Result<T>&& result) {
+  ThrowIfError(result.error());
+  return std::move(result).value();
+}
+
+}  // namespace pcapng_slicer
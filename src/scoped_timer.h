@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace pcapng_slicer {
+
+// Adds the lifetime of the object in nanoseconds to the `counter`. Does nothing if there are no
+// counters or they don't measure time, so it may stay on the hot path.
+template <typename Counters, typename Stats>
+class ScopedTimer {
+ public:
+  ScopedTimer(Counters* counters, uint64_t Stats::*counter)
+      : counters_(counters && counters->measure_time() ? counters : nullptr), counter_(counter) {
+    if (counters_) {
+      start_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~ScopedTimer() {
+    if (counters_) {
+      const auto duration = std::chrono::steady_clock::now() - start_;
+      counters_->Add(counter_,
+                     std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+    }
+  }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+ private:
+  Counters* counters_;
+  uint64_t Stats::*counter_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace pcapng_slicer
@@ -25,7 +25,7 @@ Options SectionPrivate::ParseOptions() const {
   if (data.size() < kOptionsOffset) {
     return Options{};
   }
-  return Options(std::span<const uint8_t>(data.begin() + kOptionsOffset, data.end()));
+  return Options(OptionsView(data.view().subspan(kOptionsOffset), swapped));
 }
 
 }  // namespace pcapng_slicer
@@ -4,6 +4,7 @@
 #include <memory>
 #include <vector>
 
+#include "block_data.h"
 #include "pcapng_slicer/options.h"
 
 namespace pcapng_slicer {
@@ -21,12 +22,14 @@ class SectionPrivate {
 
   Options ParseOptions() const;
 
-  std::vector<uint8_t> data;
+  BlockData data;
 
   uint64_t block_position;
   uint64_t section_length;
   uint32_t version_major;
   uint32_t version_minor;
+  // True if the section byte order differs from the host one.
+  bool swapped = false;
 
  private:
   InterfacesContainer interfaces_;
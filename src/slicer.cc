@@ -0,0 +1,245 @@
+#include "pcapng_slicer/slicer.h"
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+
+#include "block_data.h"
+#include "block_parsing.h"
+#include "block_reader.h"
+#include "block_types.h"
+#include "block_writer.h"
+#include "compressor.h"
+#include "data_source.h"
+#include "error.h"
+#include "interface_private.h"
+#include "output_file.h"
+#include "read_utils.h"
+#include "section_private.h"
+
+namespace pcapng_slicer {
+namespace {
+
+// Sequence of the output files, blocks are written into the last one.
+class SlicerOutput {
+ public:
+  SlicerOutput(const WriterConfig& config, const Slicer::OutputPathCallback& output_path)
+      : config_(config), output_path_(output_path) {
+    config_.overflow_policy = OverflowPolicy::kBlock;
+    // A block of the input is valid only until the next one is read, so the blocks are copied.
+    config_.gather_writes = false;
+  }
+
+  bool IsOpened() const { return !!block_writer_; }
+
+  // Closes the current file and starts the next one with the section header and the interfaces of
+  // the `section`.
+  void StartFile(const SectionPrivate& section) {
+    Close();
+    // Existing files are never overwritten, like the Writer doesn't, so the input is safe too.
+    block_writer_ =
+        std::make_unique<BlockWriter>(std::make_unique<OutputFile>(output_path_(files_count_)),
+                                      config_);
+    ++files_count_;
+    packets_count_ = 0;
+    bytes_count_ = 0;
+    window_.reset();
+
+    WriteSectionHeader(section);
+    for (const auto& interface : section.Interfaces()) {
+      WriteBlock(static_cast<uint32_t>(PcapngBlockType::kInterfaceDescription),
+                 interface->data.view(), section.swapped);
+    }
+  }
+
+  // Section header is written with unspecified length, because the section may be split.
+  void WriteSectionHeader(const SectionPrivate& section) {
+    const auto body = section.data.view();
+    assert(body.size() >= kSectionLengthOffset + sizeof(uint64_t));
+    WriteBlockHeader(static_cast<uint32_t>(PcapngBlockType::kSectionHeader), body.size(),
+                     section.swapped);
+    block_writer_->Write(body.first(kSectionLengthOffset));
+    block_writer_->WriteValue(kUnspecifiedSectionLength);
+    block_writer_->Write(body.subspan(kSectionLengthOffset + sizeof(uint64_t)));
+    WriteBlockTrailer(body.size(), section.swapped);
+  }
+
+  // Writes the block as is, the `body` is in the byte order of its section.
+  void WriteBlock(uint32_t type, std::span<const uint8_t> body, bool swapped) {
+    WriteBlockHeader(type, body.size(), swapped);
+    block_writer_->Write(body);
+    WriteBlockTrailer(body.size(), swapped);
+  }
+
+  void WritePacketBlock(uint32_t type, std::span<const uint8_t> body, bool swapped,
+                        std::optional<uint64_t> window) {
+    WriteBlock(type, body, swapped);
+    ++packets_count_;
+    window_ = window;
+  }
+
+  void Close() {
+    if (block_writer_) {
+      // The writer is reset first, so it isn't closed twice if closing fails.
+      std::unique_ptr<BlockWriter> block_writer = std::move(block_writer_);
+      block_writer->Close();
+    }
+  }
+
+  size_t files_count() const { return files_count_; }
+  uint64_t packets_count() const { return packets_count_; }
+  uint64_t bytes_count() const { return bytes_count_; }
+  // Time window of the last packet written into the current file.
+  std::optional<uint64_t> window() const { return window_; }
+
+ private:
+  void WriteBlockHeader(uint32_t type, size_t body_size, bool swapped) {
+    const auto length = static_cast<uint32_t>(body_size + kEmptyBlockSize);
+    block_writer_->BeginBlock(length);
+    block_writer_->WriteValue(swapped ? ByteSwap(type) : type);
+    block_writer_->WriteValue(swapped ? ByteSwap(length) : length);
+    bytes_count_ += length;
+  }
+
+  void WriteBlockTrailer(size_t body_size, bool swapped) {
+    const auto length = static_cast<uint32_t>(body_size + kEmptyBlockSize);
+    block_writer_->WriteValue(swapped ? ByteSwap(length) : length);
+  }
+
+  WriterConfig config_;
+  const Slicer::OutputPathCallback& output_path_;
+  std::unique_ptr<BlockWriter> block_writer_;
+  size_t files_count_ = 0;
+  uint64_t packets_count_ = 0;
+  uint64_t bytes_count_ = 0;
+  std::optional<uint64_t> window_;
+};
+
+//                         1                   2                   3
+//     0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//  0 |                         Interface ID                          |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//  4 |                        Timestamp (High)                       |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+//  8 |                        Timestamp (Low)                        |
+//    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+// Only the fields required to get the packet time are parsed, the block is copied as is anyway.
+uint64_t GetEnchansedPacketTimestampNs(const SectionPrivate& section,
+                                       std::span<const uint8_t> body) {
+  if (body.size() < 3 * sizeof(uint32_t)) {
+    throw Error(ErrorType::kInvalidBlockSize);
+  }
+  const auto interface_id = CastValue<uint32_t>(body, section.swapped);
+  if (interface_id >= section.GetInterfaceCount()) {
+    throw Error(ErrorType::kInvalidInterfaceForPacket);
+  }
+  const uint64_t timestamp_high = CastValue<uint32_t>(body.subspan(4), section.swapped);
+  const uint64_t timestamp_low = CastValue<uint32_t>(body.subspan(8), section.swapped);
+  return section.Interfaces()[interface_id]->ToNanoseconds(timestamp_high << 32 | timestamp_low);
+}
+
+}  // namespace
+
+Slicer::Slicer(const SlicerConfig& config) : config_(config) {}
+
+bool Slicer::Slice(const std::filesystem::path& input, const OutputPathCallback& output_path) {
+  last_error_ = ErrorType::kNoError;
+  output_files_count_ = 0;
+  try {
+    SliceImpl(input, output_path);
+  } catch (const Error& e) {
+    last_error_ = e.type();
+  }
+  return last_error_ == ErrorType::kNoError;
+}
+
+void Slicer::SliceImpl(const std::filesystem::path& input, const OutputPathCallback& output_path) {
+  if (!std::filesystem::exists(input)) {
+    throw Error(ErrorType::kFileNotFound);
+  }
+  if (!IsCompressionSupported(config_.writer_config.compression)) {
+    throw Error(ErrorType::kUnsupportedCompression);
+  }
+  BlockReader block_reader(CreateFileSource(input, config_.reader_config));
+  SlicerOutput output(config_.writer_config, output_path);
+
+  // Returns true if the packet block doesn't fit into the current file.
+  const auto needs_next_file = [&](uint32_t length, std::optional<uint64_t> window) {
+    if (output.packets_count() == 0) {
+      return false;
+    }
+    return (config_.max_packets != 0 && output.packets_count() >= config_.max_packets) ||
+           (config_.max_bytes != 0 && output.bytes_count() + length > config_.max_bytes) ||
+           (window && output.window() && *window != *output.window());
+  };
+
+  std::shared_ptr<SectionPrivate> section;
+  // Reused for the bodies of all of the blocks, except for the structure ones.
+  BlockData body;
+  try {
+    while (!block_reader.IsEof()) {
+      ScopedBlock block = block_reader.ReadBlock();
+      ThrowIfError(block.error());
+      const uint32_t type = block.type();
+      if (!section && type != static_cast<uint32_t>(PcapngBlockType::kSectionHeader)) {
+        throw Error(ErrorType::kFirstBlockIsNotSectionHeader);
+      }
+
+      // The first file is started by the first section header, so it's always opened below.
+      switch (type) {
+        case static_cast<uint32_t>(PcapngBlockType::kSectionHeader): {
+          const uint64_t block_position = block.position();
+          section = ValueOrThrow(ParseSectionHeaderBlock(ReadDataOrThrow(block), block_position));
+          if (output.IsOpened()) {
+            output.WriteSectionHeader(*section);
+          } else {
+            output.StartFile(*section);
+          }
+          break;
+        }
+        case static_cast<uint32_t>(PcapngBlockType::kInterfaceDescription): {
+          const uint64_t block_position = block.position();
+          section->PushInterface(
+              ValueOrThrow(ParseInterfaceBlock(*section, ReadDataOrThrow(block), block_position)));
+          output.WriteBlock(type, section->Interfaces().back()->data.view(), section->swapped);
+          break;
+        }
+        case static_cast<uint32_t>(PcapngBlockType::kSimplePacket):
+        case static_cast<uint32_t>(PcapngBlockType::kEnchancedPacket): {
+          const uint32_t length = block.Length() + kEmptyBlockSize;
+          ThrowIfError(block.ReadData(body));
+          std::optional<uint64_t> window;
+          if (type == static_cast<uint32_t>(PcapngBlockType::kEnchancedPacket) &&
+              config_.time_window.count() > 0) {
+            window = GetEnchansedPacketTimestampNs(*section, body.view()) /
+                     static_cast<uint64_t>(config_.time_window.count());
+          }
+          if (needs_next_file(length, window)) {
+            output.StartFile(*section);
+          }
+          // Simple packets have no timestamp, so they don't change the window.
+          output.WritePacketBlock(type, body.view(), section->swapped,
+                                  window ? window : output.window());
+          break;
+        }
+        default:
+          // Other blocks are copied into the current file.
+          ThrowIfError(block.ReadData(body));
+          output.WriteBlock(type, body.view(), section->swapped);
+          break;
+      }
+    }
+  } catch (const Error&) {
+    // Blocks before the error are kept.
+    output_files_count_ = output.files_count();
+    output.Close();
+    throw;
+  }
+  output_files_count_ = output.files_count();
+  output.Close();
+}
+
+}  // namespace pcapng_slicer
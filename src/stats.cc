@@ -0,0 +1,46 @@
+#include "pcapng_slicer/stats.h"
+
+#include <atomic>
+#include <cstdint>
+
+namespace pcapng_slicer {
+namespace {
+
+uint64_t Load(uint64_t& counter) {
+  return std::atomic_ref<uint64_t>(counter).load(std::memory_order_relaxed);
+}
+
+}  // namespace
+
+ReaderStats ReaderCounters::Snapshot() const {
+  return {
+      .section_headers_count = Load(stats_.section_headers_count),
+      .interfaces_count = Load(stats_.interfaces_count),
+      .simple_packets_count = Load(stats_.simple_packets_count),
+      .enhanced_packets_count = Load(stats_.enhanced_packets_count),
+      .unknown_blocks_count = Load(stats_.unknown_blocks_count),
+      .bytes_read = Load(stats_.bytes_read),
+      .packets_count = Load(stats_.packets_count),
+      .packet_allocations_count = Load(stats_.packet_allocations_count),
+      .buffer_allocations_count = Load(stats_.buffer_allocations_count),
+      .io_time_ns = Load(stats_.io_time_ns),
+      .parse_time_ns = Load(stats_.parse_time_ns),
+  };
+}
+
+WriterStats WriterCounters::Snapshot() const {
+  return {
+      .section_headers_count = Load(stats_.section_headers_count),
+      .interfaces_count = Load(stats_.interfaces_count),
+      .packets_count = Load(stats_.packets_count),
+      .other_blocks_count = Load(stats_.other_blocks_count),
+      .dropped_packets_count = Load(stats_.dropped_packets_count),
+      .bytes_written = Load(stats_.bytes_written),
+      .buffers_flushed_count = Load(stats_.buffers_flushed_count),
+      .direct_writes_count = Load(stats_.direct_writes_count),
+      .syncs_count = Load(stats_.syncs_count),
+      .io_time_ns = Load(stats_.io_time_ns),
+  };
+}
+
+}  // namespace pcapng_slicer
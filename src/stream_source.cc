@@ -0,0 +1,76 @@
+#include "stream_source.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <limits>
+#include <utility>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace pcapng_slicer {
+
+StreamSource::StreamSource(StreamReadFunction read, size_t buffer_size)
+    : read_(std::move(read)), buffer_(buffer_size) {}
+
+size_t StreamSource::Read(std::span<uint8_t> dst) {
+  return buffer_.Read(dst, [this](std::span<uint8_t> part) { return ReadMore(part); });
+}
+
+size_t StreamSource::Skip(size_t size) {
+  // The stream can't skip, so the data is read and dropped by buffer-sized chunks.
+  size_t skipped = buffer_.Consume(size);
+  while (skipped < size && Fill(1)) {
+    skipped += buffer_.Consume(size - skipped);
+  }
+  return skipped;
+}
+
+bool StreamSource::IsEof() {
+  // A failure must not look like the end of data, so the reader finds out that the data is short.
+  return !Fill(1) && error_ == ErrorType::kNoError;
+}
+
+std::span<const uint8_t> StreamSource::Peek(size_t size) {
+  Fill(size);
+  return buffer_.data().first(std::min(size, buffer_.size()));
+}
+
+bool StreamSource::Fill(size_t size) {
+  return buffer_.Fill(size, [this](std::span<uint8_t> part) { return ReadMore(part); });
+}
+
+int64_t StreamSource::ReadMore(std::span<uint8_t> dst) {
+  if (finished_) {
+    return 0;
+  }
+  const int64_t result = read_(dst);
+  if (result <= 0) {
+    finished_ = true;
+    if (result < 0) {
+      error_ = ErrorType::kReadError;
+    }
+  }
+  return result;
+}
+
+StreamReadFunction ReadFromDescriptor(int fd) {
+  return [fd](std::span<uint8_t> dst) -> int64_t {
+    while (true) {
+#ifdef _WIN32
+      const int result = _read(fd, dst.data(), static_cast<unsigned int>(std::min<size_t>(
+                                                   dst.size(), std::numeric_limits<int>::max())));
+#else
+      const ssize_t result = read(fd, dst.data(), dst.size());
+#endif
+      if (result >= 0 || errno != EINTR) {
+        return result;
+      }
+    }
+  };
+}
+
+}  // namespace pcapng_slicer
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "data_source.h"
+#include "pcapng_slicer/reader.h"
+#include "read_buffer.h"
+
+namespace pcapng_slicer {
+
+// Reads a stream which supports neither seeking nor peeking, e.g. a pipe or a socket, through the
+// caller's read function. The data is pulled into a buffer by chunks of the buffer size, which
+// keeps the number of reads low for streams delivering small pieces.
+class StreamSource : public DataSource {
+ public:
+  StreamSource(StreamReadFunction read, size_t buffer_size);
+
+  // DataSource overrides. If the read function fails, the data ends before the failure, but IsEof()
+  // doesn't report the end of data.
+  size_t Read(std::span<uint8_t> dst) override;
+  size_t Skip(size_t size) override;
+  bool IsEof() override;
+  ErrorType LastError() const override { return error_; }
+
+  // Returns up to `size` next bytes without moving past them, fewer only at the end of the stream.
+  std::span<const uint8_t> Peek(size_t size);
+
+ private:
+  // Calls the read function until it reports the end of the stream or a failure.
+  int64_t ReadMore(std::span<uint8_t> dst);
+  // Buffers at least `size` bytes if the data has them, see ReadBuffer::Fill().
+  bool Fill(size_t size);
+
+  StreamReadFunction read_;
+  ReadBuffer buffer_;
+  bool finished_ = false;
+  ErrorType error_ = ErrorType::kNoError;
+};
+
+// Returns a function reading the file descriptor, which is not closed by it.
+StreamReadFunction ReadFromDescriptor(int fd);
+
+}  // namespace pcapng_slicer
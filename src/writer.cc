@@ -4,20 +4,25 @@
 #include <cassert>
 #include <cstdint>
 #include <filesystem>
+#include <limits>
+#include <utility>
 
 #include "block_types.h"
+#include "block_writer.h"
+#include "compressor.h"
 #include "error.h"
+#include "output_file.h"
 #include "pcapng_slicer/error_type.h"
 #include "read_utils.h"
 
 namespace pcapng_slicer {
 namespace {
 
-constexpr std::array<char, 4> kPaddingBytes = {0, 0, 0, 0};
-constexpr uint32_t kByteOrderMagic = 0x0A0D0D0A;
-constexpr uint16_t kEthernetLinkType = 1;
-constexpr uint16_t kPacketLengthIsNotLimited = 0;
+constexpr std::array<uint8_t, 4> kPaddingBytes = {0, 0, 0, 0};
+constexpr uint16_t kOptEndofopt = 0;
 
+// Packed, as the 64-bit section length would otherwise make the trailing padding part of the block.
+#pragma pack(push, 4)
 struct SectionHeader {
   uint32_t block_type;
   uint32_t block_total_length_leading;
@@ -27,6 +32,7 @@ struct SectionHeader {
   uint64_t section_length;
   uint32_t block_total_length_trailing;
 };
+#pragma pack(pop)
 
 struct InterfaceHeader {
   uint32_t block_type;
@@ -34,37 +40,146 @@ struct InterfaceHeader {
   uint16_t link_type;
   uint16_t reserved;
   uint32_t snap_len;
-  uint32_t block_total_length_trailing;
 };
 
-}  // namespace
+struct SimplePacketHeader {
+  uint32_t block_type;
+  uint32_t block_total_length;
+  uint32_t original_length;
+};
 
-Writer::Writer() = default;
+struct EnchansedPacketHeader {
+  uint32_t block_type;
+  uint32_t block_total_length;
+  uint32_t interface_id;
+  uint32_t timestamp_high;
+  uint32_t timestamp_low;
+  uint32_t captured_length;
+  uint32_t original_length;
+};
+
+struct OptionHeader {
+  uint16_t code;
+  uint16_t length;
+};
+
+// Returns the size of a serialised option with the value of the given size.
+size_t GetOptionSize(size_t value_size) {
+  return sizeof(OptionHeader) + value_size + GetPaddingToOctet(value_size);
+}
+
+// Returns the size of serialised options including opt_endofopt, or zero if there are no options.
+size_t GetOptionsSize(std::span<const WriterOption> options) {
+  if (options.empty()) {
+    return 0;
+  }
+
+  size_t size = sizeof(OptionHeader);
+  for (const auto& option : options) {
+    if (option.value.size() > std::numeric_limits<uint16_t>::max()) {
+      throw Error(ErrorType::kInvalidOptionSize);
+    }
+    size += GetOptionSize(option.value.size());
+  }
+  return size;
+}
+
+// Checks that the length fits into 32 bit field of a block.
+uint32_t CheckLength(size_t size) {
+  if (size > std::numeric_limits<uint32_t>::max()) {
+    throw Error(ErrorType::kInvalidBlockSize);
+  }
+  return static_cast<uint32_t>(size);
+}
 
-Writer::~Writer() {
-  if (file_.is_open()) {
-    file_.close();
+// Errors of the invalid arguments of a call. They are thrown before anything of the block is
+// written, so the Writer stays usable.
+bool IsArgumentError(ErrorType error) {
+  switch (error) {
+    case ErrorType::kInvalidInterfaceForPacket:
+    case ErrorType::kInvalidOptionSize:
+    case ErrorType::kInvalidBlockSize:
+    case ErrorType::kUnsupportedByteOrder:
+      return true;
+    default:
+      return false;
   }
 }
 
-Writer::Writer(Writer&& other) : file_(std::move(other.file_)), last_error_(other.last_error_) {
+// Appends the written data to the vector of the caller.
+class BufferSink : public OutputSink {
+ public:
+  explicit BufferSink(std::vector<uint8_t>& buffer) : buffer_(buffer) {}
+
+  bool Write(std::span<const std::span<const uint8_t>> parts) override {
+    for (const auto part : parts) {
+      buffer_.insert(buffer_.end(), part.begin(), part.end());
+    }
+    return true;
+  }
+
+ private:
+  std::vector<uint8_t>& buffer_;
+};
+
+}  // namespace
+
+Writer::Writer() = default;
+
+Writer::~Writer() { Close(); }
+
+Writer::Writer(Writer&& other)
+    : block_writer_(std::move(other.block_writer_)),
+      interfaces_snap_len_(std::move(other.interfaces_snap_len_)),
+      counters_(std::move(other.counters_)),
+      dropped_packets_count_(other.dropped_packets_count_),
+      last_error_(other.last_error_) {
   other.last_error_ = ErrorType::kNoError;
 }
 
 Writer& Writer::operator=(Writer&& other) {
   if (this != &other) {
-    file_ = std::move(other.file_);
+    Close();
+    block_writer_ = std::move(other.block_writer_);
+    interfaces_snap_len_ = std::move(other.interfaces_snap_len_);
+    counters_ = std::move(other.counters_);
+    dropped_packets_count_ = other.dropped_packets_count_;
     last_error_ = other.last_error_;
     other.last_error_ = ErrorType::kNoError;
   }
   return *this;
 }
 
-bool Writer::Open(const std::filesystem::path& path) {
+bool Writer::Open(const std::filesystem::path& path, const WriterConfig& config) {
+  return OpenSink([&] { return std::make_unique<OutputFile>(path); }, config);
+}
+
+bool Writer::OpenStream(int fd, const WriterConfig& config) {
+  return OpenSink([&] { return std::make_unique<OutputFile>(fd); }, config);
+}
+
+bool Writer::OpenStream(std::unique_ptr<OutputSink> sink, const WriterConfig& config) {
+  return OpenSink(
+      [&] {
+        if (!sink) {
+          throw Error(ErrorType::kUnableToOpenFile);
+        }
+        return std::move(sink);
+      },
+      config);
+}
+
+bool Writer::OpenBuffer(std::vector<uint8_t>& buffer, const WriterConfig& config) {
+  return OpenSink([&] { return std::make_unique<BufferSink>(buffer); }, config);
+}
+
+bool Writer::OpenSink(const std::function<std::unique_ptr<OutputSink>()>& create_sink,
+                      const WriterConfig& config) {
+  Close();
   last_error_ = ErrorType::kNoError;
 
   try {
-    OpenImpl(path);
+    OpenImpl(create_sink, config);
     return true;
   } catch (const Error& err) {
     EnterErrorState(err.type());
@@ -73,110 +188,357 @@ bool Writer::Open(const std::filesystem::path& path) {
 }
 
 void Writer::Close() {
-  if (file_.is_open()) {
-    file_.close();
+  if (!block_writer_) {
+    return;
+  }
+
+  try {
+    block_writer_->Close();
+  } catch (const Error& err) {
+    last_error_ = err.type();
+  }
+  block_writer_.reset();
+}
+
+std::optional<uint32_t> Writer::AddInterface(const InterfaceDescription& description) {
+  if (!CanWrite()) {
+    return std::nullopt;
   }
+
+  uint32_t interface_id = 0;
+  if (!RunWrite([&] { interface_id = WriteInterface(description); })) {
+    return std::nullopt;
+  }
+  return interface_id;
 }
 
 bool Writer::WritePacket(std::span<const uint8_t> packet_data) {
-  if (!file_.is_open() && last_error_ == ErrorType::kNoError) {
-    last_error_ = ErrorType::kFileWasClosed;
+  return WritePackets(std::span(&packet_data, 1));
+}
+
+bool Writer::WritePackets(std::span<const std::span<const uint8_t>> packets) {
+  if (!CanWrite()) {
+    return false;
+  }
+
+  return RunWrite([&] {
+    for (const auto packet_data : packets) {
+      WriteSimplePacket(packet_data);
+    }
+  });
+}
+
+bool Writer::WritePacket(const PacketDescription& description,
+                         std::span<const uint8_t> packet_data) {
+  if (!CanWrite()) {
+    return false;
+  }
+
+  return RunWrite([&] { WriteEnchansedPacket(description, packet_data); });
+}
+
+bool Writer::WriteRawBlock(const RawBlock& block) {
+  if (block.IsSwapped()) {
+    // Rejected like the other invalid arguments, without writing anything.
+    if (CanWrite()) {
+      last_error_ = ErrorType::kUnsupportedByteOrder;
+    }
+    return false;
+  }
+  return WriteRawBlock(block.GetType(), block.GetBody());
+}
+
+bool Writer::WriteRawBlock(uint32_t type, std::span<const uint8_t> body) {
+  if (!CanWrite()) {
+    return false;
   }
-  if (!file_.is_open() || last_error_ != ErrorType::kNoError) {
+
+  return RunWrite([&] { WriteRawBlockImpl(type, body); });
+}
+
+bool Writer::Flush() {
+  if (!CanWrite()) {
     return false;
   }
 
   try {
-    WriteSimplePacket(packet_data);
+    block_writer_->Sync();
     return true;
-  } catch (const std::exception&) {
-    EnterErrorState(ErrorType::kInvalidBlockDetected);
+  } catch (const Error& err) {
+    EnterErrorState(err.type());
     return false;
   }
 }
 
-bool Writer::IsValid() const { return file_.is_open() && last_error_ == ErrorType::kNoError; }
+uint64_t Writer::DroppedPacketsCount() const { return dropped_packets_count_; }
+
+bool Writer::IsValid() const { return !!block_writer_; }
 
 ErrorType Writer::LastError() const { return last_error_; }
 
-void Writer::OpenImpl(const std::filesystem::path& path) {
-  if (std::filesystem::exists(path)) {
-    throw Error(ErrorType::kFileAlreadyExists);
+void Writer::OpenImpl(const std::function<std::unique_ptr<OutputSink>()>& create_sink,
+                      const WriterConfig& config) {
+  // Checked before the sink is created, so no file is left behind.
+  if (!IsCompressionSupported(config.compression)) {
+    throw Error(ErrorType::kUnsupportedCompression);
   }
 
-  file_.open(path, std::ios::binary | std::ios::out);
-  if (!file_.is_open()) {
-    throw Error(ErrorType::kUnableToOpenFile);
+  interfaces_snap_len_.clear();
+  dropped_packets_count_ = 0;
+  counters_ = config.counters;
+  block_writer_ = std::make_unique<BlockWriter>(create_sink(), config);
+  WriteSectionHeader();
+  block_writer_->FinishCall();
+}
+
+bool Writer::CanWrite() {
+  if (!block_writer_ && last_error_ == ErrorType::kNoError) {
+    last_error_ = ErrorType::kFileWasClosed;
   }
+  return !!block_writer_;
+}
 
-  WriteSectionHeader();
-  WriteInterface();
+bool Writer::RunWrite(const std::function<void()>& write) {
+  try {
+    try {
+      write();
+    } catch (const Error& err) {
+      if (!IsArgumentError(err.type())) {
+        throw;
+      }
+      // The rejected block isn't written at all, the blocks preceding it in the call are kept.
+      last_error_ = err.type();
+      block_writer_->FinishCall();
+      return false;
+    }
+    block_writer_->FinishCall();
+    return true;
+  } catch (const Error& err) {
+    EnterErrorState(err.type());
+    return false;
+  }
 }
 
 void Writer::WriteSectionHeader() {
-  static_assert(sizeof(SectionHeader) == 32);
+  static_assert(sizeof(SectionHeader) == 28);
   SectionHeader header{
       .block_type = static_cast<uint32_t>(PcapngBlockType::kSectionHeader),
       .block_total_length_leading = sizeof(SectionHeader),
       .byte_order_magic = kByteOrderMagic,
       .major_version = 1,
       .minor_version = 0,
-      .section_length = 0xFFFFFFFFFFFFFFFF,
+      .section_length = kUnspecifiedSectionLength,
       .block_total_length_trailing = sizeof(SectionHeader),
   };
 
-  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
-  if (!file_.good()) {
-    throw Error(ErrorType::kWriteError);
-  }
+  block_writer_->WriteValue(header);
+  CountBlock(&WriterStats::section_headers_count, header.block_total_length_leading);
 }
 
-void Writer::WriteInterface() {
-  static_assert(sizeof(InterfaceHeader) == 20);
-  InterfaceHeader header{
+uint32_t Writer::WriteInterface(const InterfaceDescription& description) {
+  static_assert(sizeof(InterfaceHeader) == 16);
+  const bool has_tsresol = description.timestamp_resolution != kDefaultTimestampResolution;
+  size_t options_size = GetOptionsSize(description.options);
+  if (has_tsresol) {
+    // if_tsresol is written before other options and shares opt_endofopt with them.
+    options_size +=
+        GetOptionSize(sizeof(uint8_t)) + (description.options.empty() ? sizeof(OptionHeader) : 0);
+  }
+
+  const InterfaceHeader header{
       .block_type = static_cast<uint32_t>(PcapngBlockType::kInterfaceDescription),
-      .block_total_length_leading = sizeof(InterfaceHeader),
-      .link_type = kEthernetLinkType,
+      .block_total_length_leading =
+          CheckLength(sizeof(InterfaceHeader) + options_size + sizeof(uint32_t)),
+      .link_type = description.link_type,
       .reserved = 0,
-      .snap_len = kPacketLengthIsNotLimited,
-      .block_total_length_trailing = sizeof(InterfaceHeader),
+      .snap_len = description.snap_len,
   };
 
-  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
-  if (!file_.good()) {
-    throw Error(ErrorType::kWriteError);
+  block_writer_->WriteValue(header);
+  if (has_tsresol) {
+    block_writer_->WriteValue(OptionHeader{.code = kIfTsresol, .length = 1});
+    const std::array<uint8_t, 4> value = {description.timestamp_resolution, 0, 0, 0};
+    block_writer_->Write(value);
+  }
+  WriteOptions(description.options);
+  if (has_tsresol && description.options.empty()) {
+    block_writer_->WriteValue(OptionHeader{.code = kOptEndofopt, .length = 0});
   }
+  block_writer_->WriteValue(header.block_total_length_leading);
+  CountBlock(&WriterStats::interfaces_count, header.block_total_length_leading);
+
+  interfaces_snap_len_.push_back(description.snap_len);
+  return interfaces_snap_len_.size() - 1;
 }
 
 void Writer::WriteSimplePacket(std::span<const uint8_t> packet_data) {
-  const uint32_t block_type = static_cast<uint32_t>(PcapngBlockType::kSimplePacket);
-  const uint32_t original_length = packet_data.size();
+  if (interfaces_snap_len_.empty()) {
+    WriteInterface(InterfaceDescription{});
+  }
+
+  const uint32_t original_length = CheckLength(packet_data.size());
+  // Packet is truncated to the snap length of the first interface.
+  if (interfaces_snap_len_[0] != 0 && packet_data.size() > interfaces_snap_len_[0]) {
+    packet_data = packet_data.first(interfaces_snap_len_[0]);
+  }
+
   const uint32_t padding = GetPaddingToOctet(packet_data.size());
-  const uint32_t block_total_length = 4 * sizeof(uint32_t) + packet_data.size() + padding;
+  const SimplePacketHeader header{
+      .block_type = static_cast<uint32_t>(PcapngBlockType::kSimplePacket),
+      .block_total_length =
+          CheckLength(sizeof(SimplePacketHeader) + packet_data.size() + padding +
+                              sizeof(uint32_t)),
+      .original_length = original_length,
+  };
 
-  file_.write(reinterpret_cast<const char*>(&block_type), sizeof(block_type));
-  file_.write(reinterpret_cast<const char*>(&block_total_length), sizeof(block_total_length));
-  file_.write(reinterpret_cast<const char*>(&original_length), sizeof(original_length));
-  file_.write(reinterpret_cast<const char*>(packet_data.data()), packet_data.size());
+  if (!block_writer_->BeginBlock(header.block_total_length)) {
+    ++dropped_packets_count_;
+    CountBlock(&WriterStats::dropped_packets_count, 0);
+    return;
+  }
+  block_writer_->WriteValue(header);
+  block_writer_->Write(packet_data);
 
   // Write padding bytes if needed.
   if (padding > 0) {
-    file_.write(kPaddingBytes.data(), padding);
+    block_writer_->Write(std::span(kPaddingBytes).first(padding));
   }
 
   // And trailing block length.
-  file_.write(reinterpret_cast<const char*>(&block_total_length), sizeof(block_total_length));
+  block_writer_->WriteValue(header.block_total_length);
+  CountBlock(&WriterStats::packets_count, header.block_total_length);
+}
+
+// Block is serialised in a single pass straight into the write buffer: the total length is
+// calculated upfront, so no intermediate storage is needed.
+void Writer::WriteEnchansedPacket(const PacketDescription& description,
+                                  std::span<const uint8_t> packet_data) {
+  if (description.interface_id >= interfaces_snap_len_.size()) {
+    throw Error(ErrorType::kInvalidInterfaceForPacket);
+  }
+
+  const uint32_t original_length =
+      description.original_length.value_or(CheckLength(packet_data.size()));
+  const uint32_t snap_len = interfaces_snap_len_[description.interface_id];
+  if (snap_len != 0 && packet_data.size() > snap_len) {
+    packet_data = packet_data.first(snap_len);
+  }
+
+  const uint32_t padding = GetPaddingToOctet(packet_data.size());
+  const size_t options_size = GetOptionsSize(description.options);
+  const EnchansedPacketHeader header{
+      .block_type = static_cast<uint32_t>(PcapngBlockType::kEnchancedPacket),
+      .block_total_length = CheckLength(sizeof(EnchansedPacketHeader) + packet_data.size() +
+                                                padding + options_size + sizeof(uint32_t)),
+      .interface_id = description.interface_id,
+      .timestamp_high = static_cast<uint32_t>(description.timestamp >> 32),
+      .timestamp_low = static_cast<uint32_t>(description.timestamp),
+      .captured_length = static_cast<uint32_t>(packet_data.size()),
+      .original_length = original_length,
+  };
+
+  if (!block_writer_->BeginBlock(header.block_total_length)) {
+    ++dropped_packets_count_;
+    CountBlock(&WriterStats::dropped_packets_count, 0);
+    return;
+  }
+  block_writer_->WriteValue(header);
+  block_writer_->Write(packet_data);
+  if (padding > 0) {
+    block_writer_->Write(std::span(kPaddingBytes).first(padding));
+  }
+  WriteOptions(description.options);
+  block_writer_->WriteValue(header.block_total_length);
+  CountBlock(&WriterStats::packets_count, header.block_total_length);
+}
+
+void Writer::WriteRawBlockImpl(uint32_t type, std::span<const uint8_t> body) {
+  if (body.size() % kBlockAlignment != 0) {
+    throw Error(ErrorType::kInvalidBlockSize);
+  }
+  const uint32_t total_length = CheckLength(body.size() + kEmptyBlockSize);
+
+  // The state is checked and updated as if the block was written by the corresponding function.
+  uint64_t WriterStats::*counter = &WriterStats::other_blocks_count;
+  switch (type) {
+    case static_cast<uint32_t>(PcapngBlockType::kSectionHeader):
+      if (body.size() < 4 * sizeof(uint32_t)) {
+        throw Error(ErrorType::kInvalidBlockSize);
+      }
+      if (CastValue<uint32_t>(body) != kByteOrderMagic) {
+        throw Error(ErrorType::kUnsupportedByteOrder);
+      }
+      interfaces_snap_len_.clear();
+      counter = &WriterStats::section_headers_count;
+      break;
+    case static_cast<uint32_t>(PcapngBlockType::kInterfaceDescription):
+      if (body.size() < 2 * sizeof(uint32_t)) {
+        throw Error(ErrorType::kInvalidBlockSize);
+      }
+      interfaces_snap_len_.push_back(CastValue<uint32_t>(body.subspan(sizeof(uint32_t))));
+      counter = &WriterStats::interfaces_count;
+      break;
+    case static_cast<uint32_t>(PcapngBlockType::kSimplePacket):
+    case static_cast<uint32_t>(PcapngBlockType::kEnchancedPacket):
+      if (!block_writer_->BeginBlock(total_length)) {
+        ++dropped_packets_count_;
+        CountBlock(&WriterStats::dropped_packets_count, 0);
+        return;
+      }
+      counter = &WriterStats::packets_count;
+      break;
+    default:
+      // Other blocks are never dropped, writing waits for a free buffer if needed.
+      break;
+  }
 
-  if (!file_.good()) {
-    throw Error(ErrorType::kInvalidBlockDetected);
+  block_writer_->WriteValue(type);
+  block_writer_->WriteValue(total_length);
+  if (type == static_cast<uint32_t>(PcapngBlockType::kSectionHeader)) {
+    // Blocks of the copied section may be filtered out, so its original length is unspecified,
+    // like the Slicer writes it.
+    block_writer_->Write(body.first(kSectionLengthOffset));
+    block_writer_->WriteValue(kUnspecifiedSectionLength);
+    block_writer_->Write(body.subspan(kSectionLengthOffset + sizeof(uint64_t)));
+  } else {
+    block_writer_->Write(body);
+  }
+  block_writer_->WriteValue(total_length);
+  CountBlock(counter, total_length);
+}
+
+// Writes options followed by opt_endofopt, nothing is written if there are no options.
+void Writer::WriteOptions(std::span<const WriterOption> options) {
+  if (options.empty()) {
+    return;
+  }
+
+  for (const auto& option : options) {
+    block_writer_->WriteValue(
+        OptionHeader{.code = option.code, .length = static_cast<uint16_t>(option.value.size())});
+    block_writer_->Write(option.value);
+    const uint32_t padding = GetPaddingToOctet(option.value.size());
+    if (padding > 0) {
+      block_writer_->Write(std::span(kPaddingBytes).first(padding));
+    }
+  }
+  block_writer_->WriteValue(OptionHeader{.code = kOptEndofopt, .length = 0});
+}
+
+void Writer::CountBlock(uint64_t WriterStats::*counter, uint32_t length) {
+  if (!counters_) {
+    return;
+  }
+  counters_->Add(counter);
+  if (length != 0) {
+    counters_->Add(&WriterStats::bytes_written, length);
   }
 }
 
 void Writer::EnterErrorState(ErrorType error) {
   last_error_ = error;
-  if (file_.is_open()) {
-    file_.close();
-  }
+  // The file is closed without flushing, data after the failure is dropped.
+  block_writer_.reset();
 }
 
 }  // namespace pcapng_slicer
@@ -0,0 +1,126 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+
+#include "doctest.h"
+#include "pcapng_slicer/packet.h"
+#include "pcapng_slicer/reader.h"
+#include "test_config.h"
+
+namespace {
+
+std::atomic<bool> g_count_allocations = false;
+std::atomic<size_t> g_allocations_count = 0;
+
+void* CountedAllocate(size_t size) {
+  if (g_count_allocations.load(std::memory_order_relaxed)) {
+    g_allocations_count.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+// Counts allocations made by all of the threads within its lifetime, so the ones of read-ahead and
+// decompression threads are caught too.
+class AllocationCounter {
+ public:
+  AllocationCounter() {
+    g_allocations_count = 0;
+    g_count_allocations = true;
+  }
+  ~AllocationCounter() { g_count_allocations = false; }
+
+  size_t count() const { return g_allocations_count; }
+};
+
+}  // namespace
+
+void* operator new(size_t size) { return CountedAllocate(size); }
+void* operator new[](size_t size) { return CountedAllocate(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+
+using namespace pcapng_slicer;
+
+namespace {
+
+const auto kTestFileWithOptions =
+    std::filesystem::path(kTestResourcesDirPath) / "with_options.pcapng";
+constexpr uint16_t kOptComment = 1;
+
+void CheckSteadyStateReadDoesNotAllocate(const ReaderConfig& config) {
+  Reader reader;
+  // The first pass warms up the packet pool.
+  REQUIRE(reader.Open(kTestFileWithOptions, config));
+  while (reader.ReadPacket()) {
+  }
+  REQUIRE(reader.IsValid());
+
+  // The second pass reuses the pool, the first packet is skipped because interfaces are read
+  // before it.
+  REQUIRE(reader.Open(kTestFileWithOptions, config));
+  REQUIRE(reader.ReadPacket().has_value());
+
+  size_t packets_count = 0;
+  size_t comments_size = 0;
+  size_t allocations_count = 0;
+  {
+    AllocationCounter counter;
+    while (auto packet = reader.ReadPacket()) {
+      packets_count += packet->GetData().empty() ? 0 : 1;
+      // Inspecting options in place doesn't allocate either.
+      for (const auto& option : packet->GetOptions()) {
+        comments_size += option.GetRawData().size();
+      }
+      comments_size += packet->GetOptions().Find(kOptComment).has_value() ? 1 : 0;
+    }
+    allocations_count = counter.count();
+  }
+
+  CHECK(reader.IsValid());
+  CHECK_EQ(packets_count, 99);
+  CHECK_GT(comments_size, 0);
+  CHECK_EQ(allocations_count, 0);
+}
+
+}  // namespace
+
+TEST_CASE("Steady state reading doesn't allocate") {
+  CheckSteadyStateReadDoesNotAllocate({.backend = ReadBackend::kStream});
+}
+
+TEST_CASE("Steady state memory mapped reading doesn't allocate") {
+  CheckSteadyStateReadDoesNotAllocate({.backend = ReadBackend::kMemoryMapped});
+}
+
+TEST_CASE("Rejected packets don't allocate") {
+  const auto reject_all = [](const PacketView& view) { return view.original_length == 0; };
+  Reader reader;
+  // The first pass grows the buffer of the packet reused for all of the rejected ones.
+  REQUIRE(reader.Open(kTestFileWithOptions));
+  CHECK_FALSE(reader.ReadPacketIf(reject_all).has_value());
+  // Interfaces are read before the first packet.
+  REQUIRE(reader.Open(kTestFileWithOptions));
+  REQUIRE(reader.PeekPacket().has_value());
+
+  size_t accepted_count = 0;
+  size_t allocations_count = 0;
+  {
+    AllocationCounter counter;
+    while (auto packet = reader.ReadPacketIf(reject_all)) {
+      ++accepted_count;
+    }
+    allocations_count = counter.count();
+  }
+
+  CHECK(reader.IsValid());
+  CHECK_EQ(accepted_count, 0);
+  CHECK_EQ(allocations_count, 0);
+}
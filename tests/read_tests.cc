@@ -1,13 +1,35 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "doctest.h"
+#include "pcapng_slicer/block_parser.h"
 #include "pcapng_slicer/packet.h"
+#include "pcapng_slicer/packet_filter.h"
+#include "pcapng_slicer/packet_index.h"
+#include "pcapng_slicer/parallel_scanner.h"
 #include "pcapng_slicer/reader.h"
 #include "test_config.h"
 
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
 using namespace pcapng_slicer;
 
 namespace {
@@ -16,6 +38,9 @@ const auto kTestFileWithoutOptions =
     std::filesystem::path(kTestResourcesDirPath) / "no_options.pcapng";
 const auto kTestFileWithOptions =
     std::filesystem::path(kTestResourcesDirPath) / "with_options.pcapng";
+// Same content as above, but written by a big-endian host.
+const auto kBigEndianTestFile =
+    std::filesystem::path(kTestResourcesDirPath) / "with_options_big_endian.pcapng";
 constexpr std::string_view kExpectedComment = "abcdefghijklmnopqrstuvwxyz";
 
 void VerifyPacket(const Packet& packet, int packet_number, bool has_options) {
@@ -38,7 +63,7 @@ void VerifyPacket(const Packet& packet, int packet_number, bool has_options) {
     return;
   }
 
-  const std::string num_message = std::format("Packet number was: {}", packet_number);
+  const std::string num_message = "Packet number was: " + std::to_string(packet_number);
   REQUIRE_MESSAGE(packet_options.size() == 1, num_message);
   const Option* opt = packet_options[0];
   REQUIRE(opt != nullptr);
@@ -78,3 +103,822 @@ TEST_CASE("Reading with options") {
   CHECK_FALSE(reader.ReadPacket().has_value());
   CHECK(reader.IsValid());
 }
+
+TEST_CASE("Reading memory mapped file") {
+  const ReaderConfig config{.backend = ReadBackend::kMemoryMapped};
+  for (const bool has_options : {false, true}) {
+    Reader reader;
+    REQUIRE(reader.Open(has_options ? kTestFileWithOptions : kTestFileWithoutOptions, config));
+
+    for (int i = 0; i < 100; ++i) {
+      auto packet = reader.ReadPacket();
+      REQUIRE(packet.has_value());
+      VerifyPacket(*packet, i, has_options);
+    }
+
+    CHECK_FALSE(reader.ReadPacket().has_value());
+    CHECK(reader.IsValid());
+  }
+}
+
+TEST_CASE("Reading big-endian file") {
+  for (const ReadBackend backend :
+       {ReadBackend::kStream, ReadBackend::kMemoryMapped, ReadBackend::kAsync}) {
+    Reader reader;
+    REQUIRE(reader.Open(kBigEndianTestFile, {.backend = backend}));
+
+    for (int i = 0; i < 100; ++i) {
+      auto packet = reader.ReadPacket();
+      REQUIRE(packet.has_value());
+      VerifyPacket(*packet, i, /*has_options=*/true);
+    }
+
+    CHECK_FALSE(reader.ReadPacket().has_value());
+    CHECK(reader.IsValid());
+  }
+}
+
+TEST_CASE("Reading sections of different byte order") {
+  const auto mixed_file = std::filesystem::path(kTestOutputDirPath) / "mixed_byte_order.pcapng";
+  {
+    std::ofstream output(mixed_file, std::ios::binary);
+    for (const auto& path : {kTestFileWithOptions, kBigEndianTestFile, kTestFileWithOptions}) {
+      output << std::ifstream(path, std::ios::binary).rdbuf();
+    }
+  }
+
+  Reader reader;
+  REQUIRE(reader.Open(mixed_file));
+  for (int i = 0; i < 300; ++i) {
+    auto packet = reader.ReadPacket();
+    REQUIRE(packet.has_value());
+    VerifyPacket(*packet, i % 100, /*has_options=*/true);
+  }
+  CHECK_FALSE(reader.ReadPacket().has_value());
+  CHECK(reader.IsValid());
+
+  ParallelScanner scanner({.threads_count = 4, .min_range_size = 64});
+  std::mutex mutex;
+  std::vector<std::pair<uint64_t, Packet>> packets;
+  REQUIRE(scanner.Scan(mixed_file, [&](Packet packet, const Interface&, uint64_t order_key) {
+    std::lock_guard lock(mutex);
+    packets.emplace_back(order_key, std::move(packet));
+  }));
+  std::ranges::sort(packets, {}, &std::pair<uint64_t, Packet>::first);
+  REQUIRE_EQ(packets.size(), 300);
+  for (int i = 0; i < 300; ++i) {
+    VerifyPacket(packets[i].second, i % 100, /*has_options=*/true);
+  }
+
+  PacketIndex index;
+  REQUIRE(index.Build(mixed_file));
+  CHECK_EQ(index.size(), 300);
+  REQUIRE(reader.SetIndex(index));
+  REQUIRE(reader.SeekToPacket(142));
+  auto packet = reader.ReadPacket();
+  REQUIRE(packet.has_value());
+  VerifyPacket(*packet, 42, /*has_options=*/true);
+  std::filesystem::remove(mixed_file);
+}
+
+TEST_CASE("Options view") {
+  constexpr uint16_t kOptComment = 1;
+  Reader reader;
+  REQUIRE(reader.Open(kTestFileWithOptions));
+
+  for (int i = 0; i < 100; ++i) {
+    auto packet = reader.ReadPacket();
+    REQUIRE(packet.has_value());
+
+    const Options options = packet->ParseOptions();
+    const OptionsView view = packet->GetOptions();
+    CHECK_EQ(view.empty(), options.empty());
+    size_t index = 0;
+    for (const OptionView& option : view) {
+      REQUIRE(index < options.size());
+      const Option& copied_option = *(options.begin() + index);
+      CHECK_EQ(option.GetCode(), copied_option.GetCode());
+      CHECK_EQ(option.GetDataAsString(), copied_option.GetDataAsString());
+      ++index;
+    }
+    CHECK_EQ(index, options.size());
+
+    const auto comment = view.Find(kOptComment);
+    const auto comment_len = i % (kExpectedComment.size() + 1);
+    REQUIRE_EQ(comment.has_value(), comment_len != 0);
+    if (comment) {
+      CHECK(comment->IsString());
+      CHECK_EQ(comment->GetDataAsString(), kExpectedComment.substr(0, comment_len));
+      // The view points into the packet data.
+      CHECK(comment->GetRawData().data() > packet->GetData().data());
+    }
+    CHECK_FALSE(view.Find(2).has_value());
+  }
+}
+
+TEST_CASE("Reading with asynchronous read-ahead") {
+  // Small buffers make blocks span several read-ahead requests.
+  const ReaderConfig configs[] = {
+      {.backend = ReadBackend::kAsync},
+      {.backend = ReadBackend::kAsync, .read_ahead_buffer_size = 64, .read_ahead_buffers_count = 3},
+      {.backend = ReadBackend::kAsync, .read_ahead_buffer_size = 4096, .read_ahead_buffers_count = 1},
+  };
+  for (const auto& config : configs) {
+    for (const bool has_options : {false, true}) {
+      Reader reader;
+      REQUIRE(reader.Open(has_options ? kTestFileWithOptions : kTestFileWithoutOptions, config));
+
+      for (int i = 0; i < 100; ++i) {
+        auto packet = reader.ReadPacket();
+        REQUIRE(packet.has_value());
+        VerifyPacket(*packet, i, has_options);
+      }
+
+      CHECK_FALSE(reader.ReadPacket().has_value());
+      CHECK(reader.IsValid());
+    }
+  }
+}
+
+TEST_CASE("Reading compressed files") {
+  // Small buffers make blocks span several decompressed buffers.
+  const ReaderConfig configs[] = {
+      {.backend = ReadBackend::kStream},
+      {.backend = ReadBackend::kMemoryMapped},
+      {.backend = ReadBackend::kAsync,
+       .read_ahead_buffer_size = 512,
+       .decompression_buffer_size = 64,
+       .decompression_buffers_count = 2},
+  };
+  for (const std::string_view extension : {".gz", ".zst", ".lz4"}) {
+    const auto path = kTestFileWithOptions.string() + std::string(extension);
+    for (const auto& config : configs) {
+      Reader reader;
+      if (!reader.Open(path, config)) {
+        // The library may be built without some of the compression libraries.
+        REQUIRE_EQ(reader.LastError(), ErrorType::kUnsupportedCompression);
+        MESSAGE("Compression is not supported: ", extension);
+        break;
+      }
+
+      for (int i = 0; i < 100; ++i) {
+        auto packet = reader.ReadPacket();
+        REQUIRE(packet.has_value());
+        VerifyPacket(*packet, i, /*has_options=*/true);
+      }
+
+      CHECK_FALSE(reader.ReadPacket().has_value());
+      CHECK_EQ(reader.LastError(), ErrorType::kNoError);
+    }
+  }
+}
+
+TEST_CASE("Reading broken compressed files") {
+  const auto compressed_file = kTestFileWithOptions.string() + ".gz";
+  std::string data;
+  {
+    std::ifstream input(compressed_file, std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(input), {});
+  }
+  Reader reader;
+  if (!reader.Open(compressed_file)) {
+    REQUIRE_EQ(reader.LastError(), ErrorType::kUnsupportedCompression);
+    return;
+  }
+
+  const auto broken_file = std::filesystem::path(kTestOutputDirPath) / "broken.pcapng.gz";
+  const auto read_broken_file = [&](const std::string& content, size_t expected_count) {
+    std::ofstream(broken_file, std::ios::binary) << content;
+    REQUIRE(reader.Open(broken_file));
+    size_t count = 0;
+    while (reader.ReadPacket()) {
+      ++count;
+    }
+    CHECK_EQ(count, expected_count);
+    return reader.LastError();
+  };
+
+  SUBCASE("Concatenated members") {
+    CHECK_EQ(read_broken_file(data + data, 200), ErrorType::kNoError);
+  }
+  SUBCASE("Truncated") {
+    CHECK_EQ(read_broken_file(data.substr(0, data.size() - 12), 99), ErrorType::kTruncatedFile);
+  }
+  SUBCASE("Corrupted checksum") {
+    // Gzip trailer holds CRC32 of the data followed by its size.
+    data[data.size() - 8] ^= 0xff;
+    CHECK_EQ(read_broken_file(data, 100), ErrorType::kDecompressionError);
+  }
+  std::filesystem::remove(broken_file);
+}
+
+TEST_CASE("Reading corrupted files") {
+  std::string data;
+  {
+    std::ifstream input(kTestFileWithOptions, std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(input), {});
+  }
+  const auto broken_file = std::filesystem::path(kTestOutputDirPath) / "corrupted.pcapng";
+  ErrorType expected_error = ErrorType::kNoError;
+  size_t expected_packets_count = 99;
+  SUBCASE("Truncated") {
+    data.resize(data.size() - 6);
+    expected_error = ErrorType::kTruncatedFile;
+  }
+  SUBCASE("Truncated inside the trailing length") {
+    data.resize(data.size() - 2);
+    expected_error = ErrorType::kTruncatedFile;
+  }
+  SUBCASE("Truncated before the trailing length") {
+    data.resize(data.size() - 4);
+    expected_error = ErrorType::kTruncatedFile;
+  }
+  SUBCASE("Truncated skipped block") {
+    // Custom block with the PEN and 8 bytes of data, which is skipped while reading packets.
+    const auto custom_block = std::to_array<uint32_t>({0x00000BAD, 24, 32473, 0, 0, 24});
+    data.append(reinterpret_cast<const char*>(custom_block.data()), sizeof(custom_block) - 6);
+    expected_error = ErrorType::kTruncatedFile;
+    expected_packets_count = 100;
+  }
+  SUBCASE("Misaligned block length") {
+    // The leading length of the last block is found by its trailing length.
+    uint32_t length = 0;
+    std::memcpy(&length, data.data() + data.size() - sizeof(length), sizeof(length));
+    const size_t length_offset = data.size() - length + sizeof(uint32_t);
+    ++length;
+    std::memcpy(data.data() + length_offset, &length, sizeof(length));
+    expected_error = ErrorType::kInvalidBlockSize;
+  }
+  std::ofstream(broken_file, std::ios::binary) << data;
+
+  // Packets before the broken one are returned by every way of reading.
+  for (const auto backend :
+       {ReadBackend::kStream, ReadBackend::kMemoryMapped, ReadBackend::kAsync}) {
+    Reader reader;
+    REQUIRE(reader.Open(broken_file, {.backend = backend}));
+    size_t count = 0;
+    while (reader.ReadPacket()) {
+      ++count;
+    }
+    CHECK_EQ(count, expected_packets_count);
+    CHECK_EQ(reader.LastError(), expected_error);
+
+    REQUIRE(reader.Open(broken_file, {.backend = backend}));
+    std::vector<Packet> packets;
+    CHECK_EQ(reader.ReadPackets(packets, 1000), expected_packets_count);
+    CHECK_EQ(reader.LastError(), expected_error);
+
+    REQUIRE(reader.Open(broken_file, {.backend = backend}));
+    count = 0;
+    while (reader.PeekPacket()) {
+      ++count;
+    }
+    CHECK_EQ(count, expected_packets_count);
+    CHECK_EQ(reader.LastError(), expected_error);
+
+    REQUIRE(reader.Open(broken_file, {.backend = backend}));
+    RawBlock block;
+    count = 0;
+    while (reader.ReadRawBlock(block)) {
+      ++count;
+    }
+    // The section header and the interface precede the packets.
+    CHECK_EQ(count, expected_packets_count + 2);
+    CHECK_EQ(reader.LastError(), expected_error);
+  }
+  std::filesystem::remove(broken_file);
+}
+
+TEST_CASE("Reading streams") {
+  // Small buffer makes blocks span several reads.
+  const ReaderConfig config{.read_ahead_buffer_size = 100};
+  for (const std::string_view extension : {"", ".gz", ".zst", ".lz4"}) {
+    std::string data;
+    {
+      std::ifstream input(kTestFileWithOptions.string() + std::string(extension), std::ios::binary);
+      data.assign(std::istreambuf_iterator<char>(input), {});
+    }
+    // The stream delivers the data by small pieces.
+    size_t offset = 0;
+    Reader reader;
+    const bool opened = reader.OpenStream(
+        [&](std::span<uint8_t> buffer) -> int64_t {
+          const size_t size = std::min({buffer.size(), data.size() - offset, size_t{7}});
+          std::memcpy(buffer.data(), data.data() + offset, size);
+          offset += size;
+          return static_cast<int64_t>(size);
+        },
+        config);
+    if (!opened) {
+      REQUIRE_EQ(reader.LastError(), ErrorType::kUnsupportedCompression);
+      MESSAGE("Compression is not supported: ", extension);
+      continue;
+    }
+    for (int i = 0; i < 100; ++i) {
+      auto packet = reader.ReadPacket();
+      REQUIRE(packet.has_value());
+      VerifyPacket(*packet, i, /*has_options=*/true);
+    }
+    CHECK_FALSE(reader.ReadPacket().has_value());
+    CHECK_EQ(reader.LastError(), ErrorType::kNoError);
+    CHECK_FALSE(reader.SetIndex(PacketIndex()));
+  }
+}
+
+TEST_CASE("Reading failed stream") {
+  std::string data;
+  {
+    std::ifstream input(kTestFileWithOptions, std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(input), {});
+  }
+  // The stream fails after the first half of the data.
+  bool delivered = false;
+  Reader reader;
+  REQUIRE(reader.OpenStream([&](std::span<uint8_t> buffer) -> int64_t {
+    if (std::exchange(delivered, true)) {
+      return -1;
+    }
+    const size_t size = std::min(buffer.size(), data.size() / 2);
+    std::memcpy(buffer.data(), data.data(), size);
+    return static_cast<int64_t>(size);
+  }));
+  size_t count = 0;
+  while (reader.ReadPacket()) {
+    ++count;
+  }
+  CHECK_GT(count, 0);
+  CHECK_LT(count, 100);
+  CHECK_EQ(reader.LastError(), ErrorType::kReadError);
+}
+
+TEST_CASE("Reading compressed stream failed at frame boundary") {
+  std::string data;
+  {
+    std::ifstream input(kTestFileWithOptions.string() + ".gz", std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(input), {});
+  }
+  // The stream fails instead of ending once all of the data is delivered.
+  size_t offset = 0;
+  Reader reader;
+  const bool opened = reader.OpenStream([&](std::span<uint8_t> buffer) -> int64_t {
+    if (offset == data.size()) {
+      return -1;
+    }
+    const size_t size = std::min(buffer.size(), data.size() - offset);
+    std::memcpy(buffer.data(), data.data() + offset, size);
+    offset += size;
+    return static_cast<int64_t>(size);
+  });
+  if (!opened) {
+    REQUIRE_EQ(reader.LastError(), ErrorType::kUnsupportedCompression);
+    MESSAGE("Compression is not supported: .gz");
+    return;
+  }
+  size_t count = 0;
+  while (reader.ReadPacket()) {
+    ++count;
+  }
+  CHECK_EQ(count, 100);
+  CHECK_EQ(reader.LastError(), ErrorType::kReadError);
+}
+
+#ifndef _WIN32
+TEST_CASE("Reading pipe") {
+  std::string data;
+  {
+    std::ifstream input(kTestFileWithOptions, std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(input), {});
+  }
+  int fds[2];
+  REQUIRE_EQ(pipe(fds), 0);
+  std::thread writer([&] {
+    for (size_t offset = 0; offset < data.size();) {
+      const ssize_t written = write(fds[1], data.data() + offset, data.size() - offset);
+      if (written <= 0) {
+        break;
+      }
+      offset += static_cast<size_t>(written);
+    }
+    close(fds[1]);
+  });
+
+  Reader reader;
+  const bool opened = reader.OpenStream(fds[0]);
+  size_t count = 0;
+  while (opened && reader.ReadPacket()) {
+    ++count;
+  }
+  writer.join();
+  close(fds[0]);
+  CHECK(opened);
+  CHECK_EQ(count, 100);
+  CHECK_EQ(reader.LastError(), ErrorType::kNoError);
+}
+#endif
+
+TEST_CASE("Parsing fed chunks") {
+  std::string file;
+  {
+    std::ifstream input(kTestFileWithOptions, std::ios::binary);
+    file.assign(std::istreambuf_iterator<char>(input), {});
+  }
+  const std::vector<uint8_t> data(file.begin(), file.end());
+
+  for (const size_t chunk_size : {size_t{1}, size_t{7}, size_t{100}, size_t{4096}, data.size()}) {
+    CAPTURE(chunk_size);
+    int index = 0;
+    size_t borrowed_count = 0;
+    BlockParser parser([&](Packet packet) {
+      VerifyPacket(packet, index++, /*has_options=*/true);
+      // Packets of the blocks within a chunk point into it.
+      const auto packet_data = packet.GetData();
+      if (packet_data.data() >= data.data() && packet_data.data() < data.data() + data.size()) {
+        ++borrowed_count;
+      }
+    });
+    for (size_t offset = 0; offset < data.size(); offset += chunk_size) {
+      const size_t size = std::min(chunk_size, data.size() - offset);
+      REQUIRE(parser.Feed(std::span(data).subspan(offset, size)));
+    }
+    CHECK(parser.Finish());
+    CHECK_EQ(parser.PendingSize(), 0);
+    CHECK_EQ(index, 100);
+    if (chunk_size == data.size()) {
+      CHECK_EQ(borrowed_count, 100);
+    } else if (chunk_size == 1) {
+      CHECK_EQ(borrowed_count, 0);
+    }
+  }
+
+  SUBCASE("Truncated stream") {
+    size_t count = 0;
+    BlockParser parser([&](Packet) { ++count; });
+    CHECK(parser.Feed(std::span(data).first(data.size() - 6)));
+    CHECK_EQ(count, 99);
+    CHECK_GT(parser.PendingSize(), 0);
+    CHECK_FALSE(parser.Finish());
+    CHECK_EQ(parser.LastError(), ErrorType::kTruncatedFile);
+
+    parser.Reset();
+    CHECK(parser.Feed(data));
+    CHECK(parser.Finish());
+    CHECK_EQ(count, 199);
+  }
+  SUBCASE("Stream without section header") {
+    BlockParser parser([](Packet) {});
+    // The stream starts with the interface following the section header.
+    const size_t section_length = data[4] | (data[5] << 8);
+    CHECK_FALSE(parser.Feed(std::span(data).subspan(section_length)));
+    CHECK_EQ(parser.LastError(), ErrorType::kFirstBlockIsNotSectionHeader);
+    CHECK_FALSE(parser.Feed(data));
+  }
+}
+
+TEST_CASE("Following a growing file") {
+  std::string data;
+  {
+    std::ifstream input(kTestFileWithOptions, std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(input), {});
+  }
+  const auto growing_file = std::filesystem::path(kTestOutputDirPath) / "growing.pcapng";
+  std::filesystem::remove(growing_file);
+  std::ofstream output(growing_file, std::ios::binary);
+
+  SUBCASE("Incomplete block is waited for") {
+    // The last block misses its trailing length.
+    output << data.substr(0, data.size() - 4) << std::flush;
+    Reader reader;
+    REQUIRE(reader.Open(growing_file,
+                        {.follow = true, .follow_timeout = std::chrono::milliseconds(10)}));
+    size_t count = 0;
+    while (reader.ReadPacket()) {
+      ++count;
+    }
+    CHECK_EQ(count, 99);
+    CHECK_EQ(reader.LastError(), ErrorType::kNoError);
+    CHECK(reader.IsValid());
+
+    output << data.substr(data.size() - 4) << std::flush;
+    const auto packet = reader.ReadPacket();
+    REQUIRE(packet);
+    Reader full_reader;
+    REQUIRE(full_reader.Open(kTestFileWithOptions));
+    std::optional<Packet> last_packet;
+    while (auto next = full_reader.ReadPacket()) {
+      last_packet = std::move(next);
+    }
+    REQUIRE(last_packet);
+    CHECK(std::ranges::equal(packet->GetData(), last_packet->GetData()));
+    CHECK_FALSE(reader.ReadPacket());
+    CHECK_EQ(reader.LastError(), ErrorType::kNoError);
+  }
+
+  SUBCASE("File is appended while reading") {
+    std::thread writer([&] {
+      constexpr size_t kChunkSize = 1000;
+      for (size_t offset = 0; offset < data.size(); offset += kChunkSize) {
+        output << data.substr(offset, kChunkSize) << std::flush;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    });
+    Reader reader;
+    const bool opened =
+        reader.Open(growing_file, {.follow = true, .follow_timeout = std::chrono::seconds(10)});
+    size_t count = 0;
+    while (opened && count < 100 && reader.ReadPacket()) {
+      ++count;
+    }
+    writer.join();
+    CHECK(opened);
+    CHECK_EQ(count, 100);
+    CHECK_EQ(reader.LastError(), ErrorType::kNoError);
+  }
+
+  SUBCASE("Section header is waited for by Open()") {
+    Reader reader;
+    CHECK_FALSE(reader.Open(growing_file,
+                            {.follow = true, .follow_timeout = std::chrono::milliseconds(10)}));
+    CHECK_EQ(reader.LastError(), ErrorType::kTruncatedFile);
+  }
+  output.close();
+  std::filesystem::remove(growing_file);
+}
+
+TEST_CASE("Memory mapped packets outlive the reader") {
+  std::vector<Packet> packets;
+  {
+    Reader reader;
+    REQUIRE(reader.Open(kTestFileWithOptions, {.backend = ReadBackend::kMemoryMapped}));
+    while (auto packet = reader.ReadPacket()) {
+      packets.push_back(std::move(*packet));
+    }
+    CHECK(reader.IsValid());
+  }
+
+  REQUIRE_EQ(packets.size(), 100);
+  for (int i = 0; i < 100; ++i) {
+    VerifyPacket(packets[i], i, /*has_options=*/true);
+  }
+}
+
+TEST_CASE("Reading packets in batches") {
+  Reader reader;
+  REQUIRE(reader.Open(kTestFileWithOptions));
+
+  std::vector<Packet> batch(16);
+  int packet_number = 0;
+  while (const size_t count = reader.ReadPackets(batch)) {
+    CHECK((count == batch.size() || packet_number + count == 100));
+    for (size_t i = 0; i < count; ++i) {
+      VerifyPacket(batch[i], packet_number++, /*has_options=*/true);
+    }
+  }
+  CHECK_EQ(packet_number, 100);
+  CHECK(reader.IsValid());
+}
+
+TEST_CASE("Reading packets in batches into vector") {
+  Reader reader;
+  REQUIRE(reader.Open(kTestFileWithoutOptions));
+
+  std::vector<Packet> batch;
+  int packet_number = 0;
+  while (reader.ReadPackets(batch, 30) > 0) {
+    CHECK_LE(batch.size(), 30);
+    for (const Packet& packet : batch) {
+      VerifyPacket(packet, packet_number++, /*has_options=*/false);
+    }
+    batch.clear();
+  }
+  CHECK_EQ(packet_number, 100);
+  CHECK(reader.IsValid());
+  CHECK_EQ(reader.ReadPackets(batch, 30), 0);
+}
+
+TEST_CASE("Reading packets with predicate") {
+  Reader reader;
+  REQUIRE(reader.Open(kTestFileWithOptions));
+  int packet_number = 9;
+  while (auto packet = reader.ReadPacketIf(
+             [](const PacketView& view) { return view.data.size() % 10 == 0; })) {
+    VerifyPacket(*packet, packet_number, /*has_options=*/true);
+    packet_number += 10;
+  }
+  CHECK_EQ(packet_number, 109);
+  CHECK(reader.IsValid());
+}
+
+TEST_CASE("Reader counters") {
+  const auto counters = std::make_shared<ReaderCounters>(/*measure_time=*/true);
+  Reader reader;
+  REQUIRE(reader.Open(kTestFileWithOptions, {.counters = counters}));
+  int packets_count = 0;
+  while (reader.ReadPacketIf([](const PacketView& view) { return view.data.size() % 10 == 0; })) {
+    ++packets_count;
+  }
+  CHECK(reader.IsValid());
+
+  const ReaderStats stats = counters->Snapshot();
+  CHECK_EQ(stats.section_headers_count, 1);
+  CHECK_EQ(stats.interfaces_count, 1);
+  CHECK_EQ(stats.simple_packets_count + stats.enhanced_packets_count, 100);
+  CHECK_EQ(stats.packets_count, packets_count);
+  CHECK_EQ(stats.bytes_read, std::filesystem::file_size(kTestFileWithOptions));
+  // Rejected and dropped packets are reused.
+  CHECK_GT(stats.packet_allocations_count, 0);
+  CHECK_LE(stats.packet_allocations_count, 2);
+  CHECK_GT(stats.io_time_ns, 0);
+  CHECK_GT(stats.parse_time_ns, 0);
+
+  // Counters accumulate over successive files.
+  REQUIRE(reader.Open(kTestFileWithoutOptions, {.counters = counters}));
+  std::vector<Packet> packets;
+  CHECK_EQ(reader.ReadPackets(packets, 1000), 100);
+  CHECK_EQ(counters->Snapshot().packets_count, packets_count + 100);
+}
+
+TEST_CASE("Reading packets with BPF filter") {
+  // Accepts packets with at least 4 bytes of data, whose 4th byte is 3.
+  const auto program = BpfProgram::Create({
+      {.code = 0x30, .k = 3},                    // ldb [3]
+      {.code = 0x15, .jt = 0, .jf = 1, .k = 3},  // jeq #3, jt 2, jf 3
+      {.code = 0x06, .k = 0xFFFF},               // ret #65535
+      {.code = 0x06, .k = 0},                    // ret #0
+  });
+  REQUIRE(program.has_value());
+
+  for (const ReadBackend backend : {ReadBackend::kStream, ReadBackend::kMemoryMapped}) {
+    Reader reader;
+    REQUIRE(reader.Open(kTestFileWithOptions, {.backend = backend}));
+    int packet_number = 3;
+    while (auto packet = reader.ReadPacketIf(*program)) {
+      VerifyPacket(*packet, packet_number++, /*has_options=*/true);
+    }
+    CHECK_EQ(packet_number, 100);
+    CHECK(reader.IsValid());
+  }
+}
+
+TEST_CASE("BPF programs") {
+  // Output of `tcpdump -dd ip` for Ethernet.
+  const auto ip_program = BpfProgram::Create({
+      {0x28, 0, 0, 0x0000000c},
+      {0x15, 0, 1, 0x00000800},
+      {0x06, 0, 0, 0x00040000},
+      {0x06, 0, 0, 0x00000000},
+  });
+  REQUIRE(ip_program.has_value());
+  std::vector<uint8_t> frame(64);
+  frame[12] = 0x08;
+  CHECK_EQ(ip_program->Run(frame, frame.size()), 0x40000);
+  frame[13] = 0xDD;
+  CHECK_EQ(ip_program->Run(frame, frame.size()), 0);
+  // Loads beyond the data reject the packet.
+  CHECK_EQ(ip_program->Run(std::span(frame).first(13), frame.size()), 0);
+
+  const auto alu_program = BpfProgram::Create({
+      {.code = 0xb1, .k = 0},   // ldxb 4*([0]&0xf)
+      {.code = 0x00, .k = 10},  // ld #10
+      {.code = 0x2c},           // mul x
+      {.code = 0x14, .k = 6},   // sub #6
+      {.code = 0x02, .k = 5},   // st M[5]
+      {.code = 0x80},           // ld len
+      {.code = 0x0c},           // add x
+      {.code = 0x07},           // tax
+      {.code = 0x60, .k = 5},   // ld M[5]
+      {.code = 0x1c},           // sub x
+      {.code = 0x16},           // ret a
+  });
+  REQUIRE(alu_program.has_value());
+  const std::vector<uint8_t> ip_header = {0x45};
+  // 10 * 20 - 6 - (100 + 20)
+  CHECK_EQ(alu_program->Run(ip_header, 100), 74);
+
+  CHECK_FALSE(BpfProgram::Create({}).has_value());
+  // Doesn't end with a return.
+  CHECK_FALSE(BpfProgram::Create({{.code = 0x00, .k = 1}}).has_value());
+  // Jumps out of the program.
+  CHECK_FALSE(BpfProgram::Create({{.code = 0x05, .k = 1}, {.code = 0x06}}).has_value());
+  CHECK_FALSE(
+      BpfProgram::Create({{.code = 0x15, .jt = 0, .jf = 1}, {.code = 0x06}}).has_value());
+  // Division by constant zero.
+  CHECK_FALSE(BpfProgram::Create({{.code = 0x34, .k = 0}, {.code = 0x06}}).has_value());
+  // Scratch memory out of range.
+  CHECK_FALSE(BpfProgram::Create({{.code = 0x02, .k = 16}, {.code = 0x06}}).has_value());
+  // Unknown instruction.
+  CHECK_FALSE(BpfProgram::Create({{.code = 0xff}, {.code = 0x06}}).has_value());
+}
+
+TEST_CASE("Parallel scanning") {
+  // Tiny ranges force resynchronisation in the middle of the test files.
+  ParallelScanner scanner({.threads_count = 4, .min_range_size = 64});
+  for (const bool has_options : {false, true}) {
+    std::mutex mutex;
+    std::vector<std::pair<uint64_t, Packet>> packets;
+    const bool result = scanner.Scan(
+        has_options ? kTestFileWithOptions : kTestFileWithoutOptions,
+        [&](Packet packet, const Interface& interface, uint64_t order_key) {
+          std::lock_guard lock(mutex);
+          packets.emplace_back(order_key, std::move(packet));
+        });
+    REQUIRE(result);
+    CHECK_EQ(scanner.LastError(), ErrorType::kNoError);
+
+    std::ranges::sort(packets, {}, &std::pair<uint64_t, Packet>::first);
+    REQUIRE_EQ(packets.size(), 100);
+    for (int i = 0; i < 100; ++i) {
+      VerifyPacket(packets[i].second, i, has_options);
+    }
+  }
+}
+
+TEST_CASE("Parallel scanning of missing file fails") {
+  ParallelScanner scanner;
+  CHECK_FALSE(scanner.Scan(std::filesystem::path(kTestResourcesDirPath) / "missing.pcapng",
+                           [](Packet, const Interface&, uint64_t) {}));
+  CHECK_EQ(scanner.LastError(), ErrorType::kFileNotFound);
+}
+
+TEST_CASE("Parallel scanning of truncated file") {
+  const auto truncated_file = std::filesystem::path(kTestOutputDirPath) / "truncated.pcapng";
+  std::filesystem::copy_file(kTestFileWithOptions, truncated_file,
+                             std::filesystem::copy_options::overwrite_existing);
+  std::filesystem::resize_file(truncated_file, std::filesystem::file_size(truncated_file) - 6);
+
+  Reader reader;
+  REQUIRE(reader.Open(truncated_file));
+  size_t expected_count = 0;
+  while (reader.ReadPacket()) {
+    ++expected_count;
+  }
+  CHECK_EQ(reader.LastError(), ErrorType::kTruncatedFile);
+
+  std::atomic<size_t> packets_count = 0;
+  ParallelScanner scanner({.threads_count = 4, .min_range_size = 64});
+  CHECK_FALSE(scanner.Scan(truncated_file, [&](Packet, const Interface&, uint64_t) {
+    ++packets_count;
+  }));
+  CHECK_EQ(scanner.LastError(), ErrorType::kTruncatedFile);
+  CHECK_EQ(packets_count, expected_count);
+  std::filesystem::remove(truncated_file);
+}
+
+TEST_CASE("Seeking with packet index") {
+  const auto index_file = std::filesystem::path(kTestOutputDirPath) / "with_options.pcapng.idx";
+  PacketIndex built_index;
+  REQUIRE(built_index.Build(kTestFileWithOptions));
+  CHECK_EQ(built_index.size(), 100);
+  REQUIRE(built_index.Save(index_file));
+
+  PacketIndex index;
+  REQUIRE(index.Load(index_file));
+  REQUIRE_EQ(index.size(), built_index.size());
+  for (size_t i = 0; i < index.size(); ++i) {
+    CHECK_EQ(index.Entries()[i].offset, built_index.Entries()[i].offset);
+    CHECK_EQ(index.Entries()[i].captured_length, i + 1);
+  }
+
+  for (const ReadBackend backend :
+       {ReadBackend::kStream, ReadBackend::kMemoryMapped, ReadBackend::kAsync}) {
+    Reader reader;
+    REQUIRE(reader.Open(kTestFileWithOptions,
+                        {.backend = backend, .read_ahead_buffer_size = 256}));
+    CHECK_FALSE(reader.SeekToPacket(0));
+    REQUIRE(reader.SetIndex(index));
+
+    for (const int packet_number : {57, 3, 99, 0}) {
+      REQUIRE(reader.SeekToPacket(packet_number));
+      for (int i = packet_number; i < std::min(packet_number + 2, 100); ++i) {
+        auto packet = reader.ReadPacket();
+        REQUIRE(packet.has_value());
+        VerifyPacket(*packet, i, /*has_options=*/true);
+      }
+    }
+
+    CHECK_FALSE(reader.SeekToPacket(100));
+    CHECK(reader.IsValid());
+
+    // All packets of the test file have zero timestamp.
+    REQUIRE(reader.SeekToTime(0));
+    auto packet = reader.ReadPacket();
+    REQUIRE(packet.has_value());
+    VerifyPacket(*packet, 0, /*has_options=*/true);
+    CHECK_FALSE(reader.SeekToTime(1));
+    CHECK(reader.IsValid());
+  }
+  std::filesystem::remove(index_file);
+}
+
+TEST_CASE("Index of another file is rejected") {
+  PacketIndex index;
+  REQUIRE(index.Build(kTestFileWithoutOptions));
+
+  Reader reader;
+  REQUIRE(reader.Open(kTestFileWithOptions));
+  CHECK_FALSE(reader.SetIndex(index));
+  CHECK_FALSE(reader.SeekToPacket(1));
+
+  CHECK_FALSE(index.Load(kTestFileWithOptions));
+  CHECK_EQ(index.LastError(), ErrorType::kInvalidIndex);
+  CHECK(index.empty());
+}
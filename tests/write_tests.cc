@@ -1,15 +1,33 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
 #include <stdexcept>
+#include <thread>
 #include <vector>
 
 #include "doctest.h"
+#include "pcapng_slicer/block_parser.h"
+#include "pcapng_slicer/merger.h"
 #include "pcapng_slicer/packet.h"
+#include "pcapng_slicer/packet_index.h"
 #include "pcapng_slicer/reader.h"
+#include "pcapng_slicer/slicer.h"
 #include "pcapng_slicer/writer.h"
 #include "test_config.h"
 
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
 using namespace pcapng_slicer;
 
 namespace {
@@ -67,6 +85,48 @@ void VerifyWrittenPacket(const Packet& packet, int packet_number) {
   CHECK_EQ(packet.GetOriginalLength(), expected_size);
 }
 
+// Checks that the `data` holds the packets created by CreatePacketData().
+void VerifyWrittenData(std::span<const uint8_t> data, int packets_count) {
+  int packet_number = 0;
+  BlockParser parser([&](Packet packet) { VerifyWrittenPacket(packet, packet_number++); });
+  CHECK(parser.Feed(data));
+  CHECK(parser.Finish());
+  CHECK_EQ(packet_number, packets_count);
+}
+
+// State of a TestSink, which is owned by the Writer.
+struct TestSinkState {
+  std::vector<uint8_t> data;
+  // Parts of the last write.
+  std::vector<std::span<const uint8_t>> parts;
+  bool fail = false;
+  bool closed = false;
+};
+
+class TestSink : public OutputSink {
+ public:
+  explicit TestSink(TestSinkState& state) : state_(state) {}
+
+  bool Write(std::span<const std::span<const uint8_t>> parts) override {
+    if (state_.fail) {
+      return false;
+    }
+    state_.parts.assign(parts.begin(), parts.end());
+    for (const auto part : parts) {
+      state_.data.insert(state_.data.end(), part.begin(), part.end());
+    }
+    return true;
+  }
+
+  bool Close() override {
+    state_.closed = true;
+    return true;
+  }
+
+ private:
+  TestSinkState& state_;
+};
+
 }  // namespace
 
 TEST_CASE("Writing packets without options") {
@@ -94,7 +154,7 @@ TEST_CASE("Writing packets without options") {
 
   for (int i = 0; i < kTotalPacketsCount; ++i) {
     auto packet = reader.ReadPacket();
-    REQUIRE_MESSAGE(packet.has_value(), std::format("Loop index was: {}", i));
+    REQUIRE_MESSAGE(packet.has_value(), "Loop index was: " << i);
     VerifyWrittenPacket(*packet, i);
   }
   CHECK_FALSE(reader.ReadPacket().has_value());
@@ -147,3 +207,865 @@ TEST_CASE("Writing after closing file fails") {
   CHECK_FALSE(writer.WritePacket(packet_data2));
   CHECK_EQ(writer.LastError(), ErrorType::kFileWasClosed);
 }
+
+TEST_CASE("Writing packets in batches") {
+  constexpr int kTotalPacketsCount = 500;
+  constexpr int kBatchSize = 32;
+  TestDirectoryManager manager(kTestOutputDir);
+  const std::filesystem::path test_file = kTestOutputDir / "write_test_batches.pcapng";
+
+  // Small buffer makes the writer flush often and write large packets directly.
+  Writer writer;
+  REQUIRE(writer.Open(test_file, WriterConfig{.buffer_size = 64}));
+
+  std::vector<std::vector<uint8_t>> packets_data;
+  std::vector<std::span<const uint8_t>> batch;
+  for (int i = 0; i < kTotalPacketsCount; i += kBatchSize) {
+    packets_data.clear();
+    batch.clear();
+    for (int j = i; j < std::min(i + kBatchSize, kTotalPacketsCount); ++j) {
+      packets_data.push_back(CreatePacketData(j));
+    }
+    for (const auto& packet_data : packets_data) {
+      batch.emplace_back(packet_data);
+    }
+    REQUIRE(writer.WritePackets(batch));
+  }
+  REQUIRE(writer.Flush());
+  writer.Close();
+  CHECK_EQ(writer.LastError(), ErrorType::kNoError);
+
+  Reader reader;
+  REQUIRE(reader.Open(test_file));
+  for (int i = 0; i < kTotalPacketsCount; ++i) {
+    auto packet = reader.ReadPacket();
+    REQUIRE_MESSAGE(packet.has_value(), "Loop index was: " << i);
+    VerifyWrittenPacket(*packet, i);
+  }
+  CHECK_FALSE(reader.ReadPacket().has_value());
+}
+
+TEST_CASE("Writing to memory") {
+  constexpr int kTotalPacketsCount = 500;
+  constexpr int kBatchSize = 10;
+  WriterConfig config;
+  SUBCASE("Buffered") {}
+  SUBCASE("Gather-writes") { config.gather_writes = true; }
+  SUBCASE("Gather-writes with small buffer") {
+    config = {.buffer_size = 64, .gather_writes = true};
+  }
+
+  std::vector<uint8_t> output;
+  Writer writer;
+  REQUIRE(writer.OpenBuffer(output, config));
+  std::vector<std::vector<uint8_t>> packets_data;
+  std::vector<std::span<const uint8_t>> batch;
+  for (int i = 0; i < kTotalPacketsCount; i += kBatchSize) {
+    // The data of the previous batch is gone, so it must have been written already.
+    packets_data.clear();
+    batch.clear();
+    for (int j = i; j < i + kBatchSize; ++j) {
+      packets_data.push_back(CreatePacketData(j));
+    }
+    for (const auto& packet_data : packets_data) {
+      batch.emplace_back(packet_data);
+    }
+    REQUIRE(writer.WritePackets(batch));
+  }
+  writer.Close();
+  CHECK_EQ(writer.LastError(), ErrorType::kNoError);
+  VerifyWrittenData(output, kTotalPacketsCount);
+}
+
+TEST_CASE("Writing to sink") {
+  TestSinkState state;
+  Writer writer;
+  REQUIRE(writer.OpenStream(std::make_unique<TestSink>(state), {.gather_writes = true}));
+  const std::vector<uint8_t> packet_data(1000, 0xAB);
+  REQUIRE(writer.WritePacket(packet_data));
+  // The packet is written by the call, and the sink gets the packet data itself rather than a copy.
+  CHECK(std::any_of(state.parts.begin(), state.parts.end(), [&](auto part) {
+    return part.data() == packet_data.data() && part.size() == packet_data.size();
+  }));
+  const size_t written_size = state.data.size();
+  writer.Close();
+  CHECK(state.closed);
+  CHECK_EQ(state.data.size(), written_size);
+
+  size_t packets_count = 0;
+  BlockParser parser([&](Packet packet) {
+    CHECK(std::ranges::equal(packet.GetData(), packet_data));
+    ++packets_count;
+  });
+  CHECK(parser.Feed(state.data));
+  CHECK_EQ(packets_count, 1);
+
+  state.fail = true;
+  REQUIRE(writer.OpenStream(std::make_unique<TestSink>(state), {.gather_writes = true}));
+  CHECK_FALSE(writer.WritePacket(packet_data));
+  CHECK_EQ(writer.LastError(), ErrorType::kWriteError);
+}
+
+#ifndef _WIN32
+TEST_CASE("Writing pipe") {
+  constexpr int kTotalPacketsCount = 500;
+  int fds[2];
+  REQUIRE_EQ(pipe(fds), 0);
+  std::vector<uint8_t> output;
+  std::thread reader([&] {
+    std::array<uint8_t, 4096> buffer;
+    ssize_t size = 0;
+    while ((size = read(fds[0], buffer.data(), buffer.size())) > 0) {
+      output.insert(output.end(), buffer.begin(), buffer.begin() + size);
+    }
+  });
+
+  Writer writer;
+  const bool opened = writer.OpenStream(fds[1], {.gather_writes = true});
+  for (int i = 0; opened && i < kTotalPacketsCount; ++i) {
+    if (!writer.WritePacket(CreatePacketData(i))) {
+      break;
+    }
+  }
+  // Syncing the pipe on closing is skipped.
+  writer.Close();
+  close(fds[1]);
+  reader.join();
+  close(fds[0]);
+  CHECK(opened);
+  CHECK_EQ(writer.LastError(), ErrorType::kNoError);
+  VerifyWrittenData(output, kTotalPacketsCount);
+}
+#endif
+
+TEST_CASE("Flushed packets are visible before closing") {
+  TestDirectoryManager manager(kTestOutputDir);
+  const std::filesystem::path test_file = kTestOutputDir / "write_test_flush.pcapng";
+
+  Writer writer;
+  REQUIRE(writer.Open(test_file));
+  auto packet_data = CreatePacketData(10);
+  REQUIRE(writer.WritePacket(packet_data));
+  REQUIRE(writer.Flush());
+
+  Reader reader;
+  REQUIRE(reader.Open(test_file));
+  auto packet = reader.ReadPacket();
+  REQUIRE(packet.has_value());
+  VerifyWrittenPacket(*packet, 10);
+}
+
+TEST_CASE("Writing enhanced packets") {
+  constexpr int kTotalPacketsCount = 100;
+  constexpr uint16_t kOptComment = 1;
+  constexpr uint16_t kIfTsresol = 9;
+  TestDirectoryManager manager(kTestOutputDir);
+  const std::filesystem::path test_file = kTestOutputDir / "write_test_enhanced.pcapng";
+
+  const std::string_view comment = "packet comment";
+  const std::vector<WriterOption> packet_options = {
+      {.code = kOptComment,
+       .value = std::span(reinterpret_cast<const uint8_t*>(comment.data()), comment.size())}};
+
+  Writer writer;
+  REQUIRE(writer.Open(test_file));
+  const auto ethernet_id = writer.AddInterface({});
+  const auto truncating_id =
+      writer.AddInterface({.link_type = 101, .snap_len = 16, .timestamp_resolution = 9});
+  REQUIRE(ethernet_id.has_value());
+  REQUIRE(truncating_id.has_value());
+  CHECK_EQ(*ethernet_id, 0);
+  CHECK_EQ(*truncating_id, 1);
+
+  for (int i = 0; i < kTotalPacketsCount; ++i) {
+    std::vector<uint8_t> packet_data = CreatePacketData(i);
+    const PacketDescription description{
+        .interface_id = i % 2 == 0 ? *ethernet_id : *truncating_id,
+        .timestamp = 0x100000000ULL * i + i,
+        .options = i % 3 == 0 ? std::span(packet_options) : std::span<const WriterOption>{},
+    };
+    REQUIRE(writer.WritePacket(description, packet_data));
+  }
+  writer.Close();
+  CHECK_EQ(writer.LastError(), ErrorType::kNoError);
+
+  Reader reader;
+  REQUIRE(reader.Open(test_file));
+  for (int i = 0; i < kTotalPacketsCount; ++i) {
+    auto packet = reader.ReadPacket();
+    REQUIRE_MESSAGE(packet.has_value(), "Loop index was: " << i);
+    CHECK_EQ(packet->GetTimestamp(), 0x100000000ULL * i + i);
+
+    const std::vector<uint8_t> expected_data = CreatePacketData(i);
+    CHECK_EQ(packet->GetOriginalLength(), expected_data.size());
+    const auto data = packet->GetData();
+    const size_t expected_size = i % 2 == 0 ? expected_data.size()
+                                            : std::min<size_t>(expected_data.size(), 16);
+    REQUIRE_EQ(data.size(), expected_size);
+    CHECK(std::equal(data.begin(), data.end(), expected_data.begin()));
+
+    const auto options = packet->ParseOptions();
+    if (i % 3 == 0) {
+      REQUIRE_EQ(options.size(), 1);
+      CHECK_EQ(options.begin()->GetCode(), kOptComment);
+      CHECK_EQ(options.begin()->GetDataAsString(), comment);
+    } else {
+      CHECK(options.empty());
+    }
+
+    const auto interface_options = packet->GetInterface().ParseOptions();
+    if (i % 2 == 0) {
+      CHECK(interface_options.empty());
+    } else {
+      REQUIRE_EQ(interface_options.size(), 1);
+      CHECK_EQ(interface_options.begin()->GetCode(), kIfTsresol);
+      REQUIRE_EQ(interface_options.begin()->GetRawData().size(), 1);
+      CHECK_EQ(interface_options.begin()->GetRawData()[0], 9);
+    }
+  }
+  CHECK_FALSE(reader.ReadPacket().has_value());
+}
+
+TEST_CASE("Timestamps are normalised to nanoseconds") {
+  constexpr uint16_t kIfTsoffset = 14;
+  TestDirectoryManager manager(kTestOutputDir);
+  const std::filesystem::path test_file = kTestOutputDir / "write_test_timestamps.pcapng";
+
+  const int64_t offset_seconds = 1000;
+  const std::vector<WriterOption> offset_options = {
+      {.code = kIfTsoffset,
+       .value = std::span(reinterpret_cast<const uint8_t*>(&offset_seconds), sizeof(int64_t))}};
+
+  // Timestamp of 1.5 seconds in units of every interface.
+  struct TestInterface {
+    InterfaceDescription description;
+    uint64_t timestamp;
+  };
+  const std::vector<TestInterface> interfaces = {
+      {.description = {}, .timestamp = 1'500'000},
+      {.description = {.timestamp_resolution = 9}, .timestamp = 1'500'000'000},
+      {.description = {.timestamp_resolution = 0}, .timestamp = 1},
+      {.description = {.timestamp_resolution = 12}, .timestamp = 1'500'000'000'000},
+      {.description = {.timestamp_resolution = 0x80 | 10}, .timestamp = 1536},
+      {.description = {.timestamp_resolution = 0x80 | 40}, .timestamp = 3ULL << 39},
+      {.description = {.options = offset_options}, .timestamp = 1'500'000},
+  };
+
+  Writer writer;
+  REQUIRE(writer.Open(test_file));
+  const auto packet_data = CreatePacketData(10);
+  for (const auto& [description, timestamp] : interfaces) {
+    const auto interface_id = writer.AddInterface(description);
+    REQUIRE(interface_id.has_value());
+    REQUIRE(writer.WritePacket({.interface_id = *interface_id, .timestamp = timestamp},
+                               packet_data));
+  }
+  writer.Close();
+
+  const std::vector<uint64_t> expected_ns = {
+      1'500'000'000, 1'500'000'000, 1'000'000'000, 1'500'000'000,
+      1'500'000'000, 1'500'000'000, 1'001'500'000'000,
+  };
+  Reader reader;
+  REQUIRE(reader.Open(test_file));
+  for (size_t i = 0; i < interfaces.size(); ++i) {
+    auto packet = reader.ReadPacket();
+    REQUIRE(packet.has_value());
+    CHECK_EQ(packet->GetTimestamp(), interfaces[i].timestamp);
+    CHECK_MESSAGE(packet->GetTimestampNs() == expected_ns[i], "Interface was: " << i);
+    CHECK_EQ(packet->GetTime().time_since_epoch().count(), expected_ns[i]);
+  }
+  CHECK_FALSE(reader.ReadPacket().has_value());
+
+  // The index orders the packets by the normalised time too.
+  PacketIndex index;
+  REQUIRE(index.Build(test_file));
+  CHECK_EQ(index.FindPacketByTime(0), 2);
+  CHECK_EQ(index.FindPacketByTime(1'000'000'001), 0);
+  CHECK_EQ(index.FindPacketByTime(1'500'000'001), 6);
+  CHECK_FALSE(index.FindPacketByTime(1'001'500'000'001).has_value());
+  REQUIRE(reader.SetIndex(std::move(index)));
+  REQUIRE(reader.SeekToTime(1'000'000'001));
+  auto packet = reader.ReadPacket();
+  REQUIRE(packet.has_value());
+  CHECK_EQ(packet->GetTimestampNs(), expected_ns[0]);
+}
+
+TEST_CASE("Writing enhanced packet to unknown interface fails") {
+  TestDirectoryManager manager(kTestOutputDir);
+  const std::filesystem::path test_file = kTestOutputDir / "write_test_unknown_interface.pcapng";
+
+  Writer writer;
+  REQUIRE(writer.Open(test_file));
+  auto packet_data = CreatePacketData(10);
+  CHECK_FALSE(writer.WritePacket(PacketDescription{.interface_id = 0}, packet_data));
+  CHECK_EQ(writer.LastError(), ErrorType::kInvalidInterfaceForPacket);
+}
+
+TEST_CASE("Invalid packets don't discard the written ones") {
+  constexpr int kValidPacketsCount = 10;
+  TestDirectoryManager manager(kTestOutputDir);
+  const std::filesystem::path test_file = kTestOutputDir / "write_test_invalid_packet.pcapng";
+  WriterConfig config;
+  SUBCASE("Buffered") {}
+  SUBCASE("Gather-writes") { config.gather_writes = true; }
+
+  Writer writer;
+  REQUIRE(writer.Open(test_file, config));
+  for (int i = 0; i < kValidPacketsCount; ++i) {
+    REQUIRE(writer.WritePacket(CreatePacketData(i)));
+  }
+  CHECK_FALSE(writer.WritePacket(PacketDescription{.interface_id = 7}, CreatePacketData(0)));
+  CHECK_EQ(writer.LastError(), ErrorType::kInvalidInterfaceForPacket);
+  const std::vector<uint8_t> long_option(70000);
+  const std::array<WriterOption, 1> options = {WriterOption{.code = 1, .value = long_option}};
+  CHECK_FALSE(writer.WritePacket({.interface_id = 0, .options = options}, CreatePacketData(0)));
+  CHECK_EQ(writer.LastError(), ErrorType::kInvalidOptionSize);
+  CHECK_FALSE(writer.WriteRawBlock(0xBAD, std::span(long_option).first(3)));
+  CHECK_EQ(writer.LastError(), ErrorType::kInvalidBlockSize);
+
+  // The writer stays usable.
+  CHECK(writer.IsValid());
+  REQUIRE(writer.WritePacket(CreatePacketData(kValidPacketsCount)));
+  writer.Close();
+
+  Reader reader;
+  REQUIRE(reader.Open(test_file));
+  for (int i = 0; i <= kValidPacketsCount; ++i) {
+    auto packet = reader.ReadPacket();
+    REQUIRE_MESSAGE(packet.has_value(), "Loop index was: " << i);
+    VerifyWrittenPacket(*packet, i);
+  }
+  CHECK_FALSE(reader.ReadPacket().has_value());
+}
+
+TEST_CASE("Writing packets asynchronously") {
+  constexpr int kTotalPacketsCount = 500;
+  TestDirectoryManager manager(kTestOutputDir);
+  const std::filesystem::path test_file = kTestOutputDir / "write_test_async.pcapng";
+
+  Writer writer;
+  REQUIRE(writer.Open(test_file, {.buffer_size = 256,
+                                  .mode = WriteMode::kAsynchronous,
+                                  .buffers_count = 3,
+                                  .overflow_policy = OverflowPolicy::kBlock}));
+  for (int i = 0; i < kTotalPacketsCount; ++i) {
+    std::vector<uint8_t> packet_data = CreatePacketData(i);
+    REQUIRE(writer.WritePacket(packet_data));
+    if (i == kTotalPacketsCount / 2) {
+      REQUIRE(writer.Flush());
+    }
+  }
+  writer.Close();
+  CHECK_EQ(writer.LastError(), ErrorType::kNoError);
+  CHECK_EQ(writer.DroppedPacketsCount(), 0);
+
+  Reader reader;
+  REQUIRE(reader.Open(test_file));
+  for (int i = 0; i < kTotalPacketsCount; ++i) {
+    auto packet = reader.ReadPacket();
+    REQUIRE_MESSAGE(packet.has_value(), "Loop index was: " << i);
+    VerifyWrittenPacket(*packet, i);
+  }
+  CHECK_FALSE(reader.ReadPacket().has_value());
+}
+
+TEST_CASE("Asynchronous writer drops packets on overflow") {
+  constexpr int kTotalPacketsCount = 10000;
+  TestDirectoryManager manager(kTestOutputDir);
+  const std::filesystem::path test_file = kTestOutputDir / "write_test_async_drop.pcapng";
+
+  Writer writer;
+  REQUIRE(writer.Open(test_file, {.buffer_size = 128,
+                                  .mode = WriteMode::kAsynchronous,
+                                  .overflow_policy = OverflowPolicy::kDrop}));
+  for (int i = 0; i < kTotalPacketsCount; ++i) {
+    std::vector<uint8_t> packet_data = CreatePacketData(i);
+    REQUIRE(writer.WritePacket(packet_data));
+  }
+  writer.Close();
+  CHECK_EQ(writer.LastError(), ErrorType::kNoError);
+
+  // Whether packets are dropped depends on the disk speed, but every packet is either written
+  // completely or counted as dropped.
+  Reader reader;
+  REQUIRE(reader.Open(test_file));
+  uint64_t read_packets_count = 0;
+  while (auto packet = reader.ReadPacket()) {
+    ++read_packets_count;
+  }
+  CHECK(reader.IsValid());
+  CHECK_EQ(read_packets_count + writer.DroppedPacketsCount(), kTotalPacketsCount);
+}
+
+TEST_CASE("Writer counters") {
+  constexpr int kPacketsCount = 100;
+  TestDirectoryManager manager(kTestOutputDir);
+  const std::filesystem::path test_file = kTestOutputDir / "write_test_counters.pcapng";
+
+  const auto counters = std::make_shared<WriterCounters>(/*measure_time=*/true);
+  Writer writer;
+  REQUIRE(writer.Open(test_file, {.buffer_size = 256, .counters = counters}));
+  for (int i = 0; i < kPacketsCount; ++i) {
+    REQUIRE(writer.WritePacket(CreatePacketData(i)));
+  }
+  // Doesn't fit into the buffer, so it is written directly.
+  REQUIRE(writer.WritePacket(std::vector<uint8_t>(1000)));
+  REQUIRE(writer.Flush());
+  writer.Close();
+  CHECK_EQ(writer.LastError(), ErrorType::kNoError);
+
+  const WriterStats stats = counters->Snapshot();
+  CHECK_EQ(stats.section_headers_count, 1);
+  CHECK_EQ(stats.interfaces_count, 1);
+  CHECK_EQ(stats.packets_count, kPacketsCount + 1);
+  CHECK_EQ(stats.other_blocks_count, 0);
+  CHECK_EQ(stats.dropped_packets_count, 0);
+  CHECK_EQ(stats.bytes_written, std::filesystem::file_size(test_file));
+  CHECK_GT(stats.buffers_flushed_count, 0);
+  CHECK_EQ(stats.direct_writes_count, 1);
+  CHECK_EQ(stats.syncs_count, 2);
+  CHECK_GT(stats.io_time_ns, 0);
+}
+
+TEST_CASE("Writing compressed files") {
+  constexpr int kTotalPacketsCount = 500;
+  TestDirectoryManager manager(kTestOutputDir);
+  // Packet which doesn't fit into the buffer and makes a frame of its own.
+  std::vector<uint8_t> large_packet(1000);
+  std::ranges::fill(large_packet, 0x5a);
+
+  for (const OutputCompression compression : {OutputCompression::kZstd, OutputCompression::kLz4}) {
+    const std::filesystem::path test_file = kTestOutputDir / "write_test_compressed.pcapng";
+    std::filesystem::remove(test_file);
+
+    Writer writer;
+    if (!writer.Open(test_file, {.buffer_size = 256,
+                                 .compression = compression,
+                                 .compression_threads = 4})) {
+      // The library may be built without some of the compression libraries.
+      CHECK_EQ(writer.LastError(), ErrorType::kUnsupportedCompression);
+      CHECK_FALSE(std::filesystem::exists(test_file));
+      continue;
+    }
+    for (int i = 0; i < kTotalPacketsCount; ++i) {
+      std::vector<uint8_t> packet_data = CreatePacketData(i);
+      REQUIRE(writer.WritePacket(packet_data));
+      if (i == kTotalPacketsCount / 2) {
+        REQUIRE(writer.Flush());
+        REQUIRE(writer.WritePacket(large_packet));
+      }
+    }
+    writer.Close();
+    CHECK_EQ(writer.LastError(), ErrorType::kNoError);
+
+    Reader reader;
+    REQUIRE(reader.Open(test_file));
+    for (int i = 0; i < kTotalPacketsCount; ++i) {
+      auto packet = reader.ReadPacket();
+      REQUIRE_MESSAGE(packet.has_value(), "Loop index was: " << i);
+      VerifyWrittenPacket(*packet, i);
+      if (i == kTotalPacketsCount / 2) {
+        packet = reader.ReadPacket();
+        REQUIRE(packet.has_value());
+        CHECK(std::ranges::equal(packet->GetData(), large_packet));
+      }
+    }
+    CHECK_FALSE(reader.ReadPacket().has_value());
+    CHECK_EQ(reader.LastError(), ErrorType::kNoError);
+  }
+}
+
+TEST_CASE("Writing custom options") {
+  constexpr uint16_t kCustomStringOption = 2988;
+  constexpr uint32_t kPen = 32473;
+  TestDirectoryManager manager(kTestOutputDir);
+  const std::filesystem::path test_file = kTestOutputDir / "write_test_custom_options.pcapng";
+
+  // Custom option value starts with the PEN.
+  std::vector<uint8_t> custom_value(sizeof(kPen));
+  std::memcpy(custom_value.data(), &kPen, sizeof(kPen));
+  const std::string_view custom_data = "custom";
+  custom_value.insert(custom_value.end(), custom_data.begin(), custom_data.end());
+  const std::vector<WriterOption> options = {{.code = kCustomStringOption, .value = custom_value}};
+
+  Writer writer;
+  REQUIRE(writer.Open(test_file));
+  const auto interface_id = writer.AddInterface({});
+  REQUIRE(interface_id.has_value());
+  auto packet_data = CreatePacketData(10);
+  REQUIRE(writer.WritePacket({.interface_id = *interface_id, .options = options}, packet_data));
+  writer.Close();
+
+  Reader reader;
+  REQUIRE(reader.Open(test_file));
+  auto packet = reader.ReadPacket();
+  REQUIRE(packet.has_value());
+  const auto option = packet->GetOptions().Find(kCustomStringOption);
+  REQUIRE(option.has_value());
+  CHECK_EQ(option->GetPenCode(), kPen);
+  CHECK_EQ(option->GetDataAsString(), custom_data);
+}
+
+TEST_CASE("Merging files by time") {
+  constexpr int kTotalPacketsCount = 300;
+  constexpr uint16_t kOptComment = 1;
+  // Every input has its own timestamp resolution: microseconds, nanoseconds and milliseconds.
+  constexpr std::array<uint8_t, 3> kResolutions = {6, 9, 3};
+  constexpr std::array<uint64_t, 3> kUnitsPerMillisecond = {1'000, 1'000'000, 1};
+  TestDirectoryManager manager(kTestOutputDir);
+
+  // Packet number N is written into the input N % 3 with the timestamp of N milliseconds.
+  std::vector<std::filesystem::path> inputs;
+  for (size_t input = 0; input < kResolutions.size(); ++input) {
+    inputs.push_back(kTestOutputDir / ("merge_input_" + std::to_string(input) + ".pcapng"));
+    Writer writer;
+    REQUIRE(writer.Open(inputs.back()));
+    const auto interface_id = writer.AddInterface({.timestamp_resolution = kResolutions[input]});
+    REQUIRE(interface_id.has_value());
+    for (int i = input; i < kTotalPacketsCount; i += kResolutions.size()) {
+      const std::string comment = std::to_string(i);
+      const std::vector<WriterOption> options = {
+          {.code = kOptComment,
+           .value = std::span(reinterpret_cast<const uint8_t*>(comment.data()), comment.size())}};
+      REQUIRE(writer.WritePacket({.interface_id = *interface_id,
+                                  .timestamp = i * kUnitsPerMillisecond[input],
+                                  .options = options},
+                                 CreatePacketData(i)));
+    }
+    writer.Close();
+  }
+
+  const std::filesystem::path output = kTestOutputDir / "merge_output.pcapng";
+  Merger merger;
+  REQUIRE(merger.Merge(inputs, output));
+  CHECK_EQ(merger.MergedPacketsCount(), kTotalPacketsCount);
+
+  Reader reader;
+  REQUIRE(reader.Open(output));
+  for (int i = 0; i < kTotalPacketsCount; ++i) {
+    auto packet = reader.ReadPacket();
+    REQUIRE_MESSAGE(packet.has_value(), "Loop index was: " << i);
+    CHECK_EQ(packet->GetTimestampNs(), i * 1'000'000ULL);
+    VerifyWrittenPacket(*packet, i);
+    const auto comment = packet->GetOptions().Find(kOptComment);
+    REQUIRE(comment.has_value());
+    CHECK_EQ(comment->GetDataAsString(), std::to_string(i));
+    CHECK_EQ(packet->GetInterface().GetTimestampResolution(), kResolutions[i % 3]);
+  }
+  CHECK_FALSE(reader.ReadPacket().has_value());
+  CHECK(reader.IsValid());
+
+  // Whether packets are dropped depends on the disk speed, but only the written ones are counted.
+  Merger dropping_merger({.writer_config = {.buffer_size = 128,
+                                            .mode = WriteMode::kAsynchronous,
+                                            .overflow_policy = OverflowPolicy::kDrop}});
+  const std::filesystem::path dropping_output = kTestOutputDir / "merge_output_dropping.pcapng";
+  REQUIRE(dropping_merger.Merge(inputs, dropping_output));
+  REQUIRE(reader.Open(dropping_output));
+  uint64_t read_packets_count = 0;
+  while (reader.ReadPacket()) {
+    ++read_packets_count;
+  }
+  CHECK(reader.IsValid());
+  CHECK_EQ(dropping_merger.MergedPacketsCount(), read_packets_count);
+
+  inputs.push_back(kTestOutputDir / "missing.pcapng");
+  CHECK_FALSE(merger.Merge(inputs, output));
+  CHECK_EQ(merger.LastError(), ErrorType::kFileNotFound);
+}
+
+TEST_CASE("Merging byte-swapped files") {
+  constexpr uint16_t kIfTsoffset = 14;
+  constexpr uint16_t kEpbFlags = 2;
+  constexpr uint16_t kCustomBinaryOption = 2989;
+  constexpr uint32_t kPen = 32473;
+  TestDirectoryManager manager(kTestOutputDir);
+
+  // The Writer writes in the host byte order only, so the big-endian input is built by hand.
+  std::vector<uint8_t> capture;
+  const auto append = [&](uint64_t value, size_t size) {
+    for (size_t i = size; i > 0; --i) {
+      capture.push_back(static_cast<uint8_t>(value >> (8 * (i - 1))));
+    }
+  };
+  // Section header: magic, version 1.0, unspecified section length.
+  append(0x0A0D0D0A, 4); append(28, 4); append(0x1A2B3C4D, 4); append(1, 2); append(0, 2);
+  append(~0ULL, 8); append(28, 4);
+  // Interface with microseconds resolution and if_tsoffset of 5 seconds.
+  append(1, 4); append(36, 4); append(1, 2); append(0, 2); append(0, 4);
+  append(kIfTsoffset, 2); append(8, 2); append(5, 8); append(0, 4); append(36, 4);
+  // Packet at 1 millisecond with 4 bytes of data, epb_flags and a custom option.
+  append(6, 4); append(60, 4); append(0, 4); append(0, 4); append(1'000, 4); append(4, 4);
+  append(4, 4); append(0xDEADBEEF, 4);
+  append(kEpbFlags, 2); append(4, 2); append(1, 4);
+  append(kCustomBinaryOption, 2); append(8, 2); append(kPen, 4); append(0x61626364, 4);
+  append(0, 4); append(60, 4);
+
+  const std::filesystem::path input = kTestOutputDir / "merge_input_big_endian.pcapng";
+  std::ofstream(input, std::ios::binary)
+      .write(reinterpret_cast<const char*>(capture.data()), capture.size());
+  const std::filesystem::path output = kTestOutputDir / "merge_output_big_endian.pcapng";
+  Merger merger;
+  REQUIRE(merger.Merge(std::span(&input, 1), output));
+  CHECK_EQ(merger.MergedPacketsCount(), 1);
+
+  Reader reader;
+  REQUIRE(reader.Open(output));
+  auto packet = reader.ReadPacket();
+  REQUIRE(packet.has_value());
+  CHECK_EQ(packet->GetTimestampNs(), 5'001'000'000ULL);
+  CHECK_EQ(packet->GetData().size(), 4);
+  const auto tsoffset = packet->GetInterface().GetOptions().Find(kIfTsoffset);
+  REQUIRE(tsoffset.has_value());
+  CHECK_EQ(tsoffset->GetUint64(), 5);
+  const auto flags = packet->GetOptions().Find(kEpbFlags);
+  REQUIRE(flags.has_value());
+  CHECK_EQ(flags->GetUint32(), 1);
+  const auto custom = packet->GetOptions().Find(kCustomBinaryOption);
+  REQUIRE(custom.has_value());
+  CHECK_EQ(custom->GetPenCode(), kPen);
+  CHECK_EQ(custom->GetDataAsString(), "abcd");
+  CHECK_FALSE(reader.ReadPacket().has_value());
+  CHECK_EQ(reader.LastError(), ErrorType::kNoError);
+}
+
+TEST_CASE("Slicing files") {
+  constexpr int kTotalPacketsCount = 100;
+  constexpr uint16_t kOptComment = 1;
+  TestDirectoryManager manager(kTestOutputDir);
+
+  // Packet number N has the timestamp of N milliseconds and its number as a comment.
+  const std::filesystem::path input = kTestOutputDir / "slice_input.pcapng";
+  {
+    Writer writer;
+    REQUIRE(writer.Open(input));
+    const auto interface_id = writer.AddInterface({.snap_len = 64, .timestamp_resolution = 9});
+    REQUIRE(interface_id.has_value());
+    for (int i = 0; i < kTotalPacketsCount; ++i) {
+      const std::string comment = std::to_string(i);
+      const std::vector<WriterOption> options = {
+          {.code = kOptComment,
+           .value = std::span(reinterpret_cast<const uint8_t*>(comment.data()), comment.size())}};
+      REQUIRE(writer.WritePacket(
+          {.interface_id = *interface_id, .timestamp = i * 1'000'000ULL, .options = options},
+          CreatePacketData(i)));
+    }
+    writer.Close();
+  }
+
+  const auto output_path = [](size_t index) {
+    return kTestOutputDir / ("slice_" + std::to_string(index) + ".pcapng");
+  };
+  // Reads all of the outputs and returns the number of packets in every one of them.
+  const auto verify_outputs = [&](size_t files_count) {
+    std::vector<size_t> packets_counts;
+    int packet_number = 0;
+    for (size_t index = 0; index < files_count; ++index) {
+      Reader reader;
+      REQUIRE(reader.Open(output_path(index)));
+      size_t count = 0;
+      while (auto packet = reader.ReadPacket()) {
+        CHECK_EQ(packet->GetTimestampNs(), packet_number * 1'000'000ULL);
+        CHECK_EQ(packet->GetInterface().GetSnapLen(), 64);
+        CHECK_EQ(packet->GetInterface().GetTimestampResolution(), 9);
+        const auto data = packet->GetData();
+        const auto expected_data = CreatePacketData(packet_number);
+        REQUIRE_EQ(data.size(), std::min<size_t>(expected_data.size(), 64));
+        CHECK(std::equal(data.begin(), data.end(), expected_data.begin()));
+        const auto comment = packet->GetOptions().Find(kOptComment);
+        REQUIRE(comment.has_value());
+        CHECK_EQ(comment->GetDataAsString(), std::to_string(packet_number));
+        ++packet_number;
+        ++count;
+      }
+      CHECK(reader.IsValid());
+      packets_counts.push_back(count);
+    }
+    CHECK_EQ(packet_number, kTotalPacketsCount);
+    return packets_counts;
+  };
+
+  SUBCASE("By packets count") {
+    Slicer slicer({.max_packets = 30});
+    REQUIRE(slicer.Slice(input, output_path));
+    REQUIRE_EQ(slicer.OutputFilesCount(), 4);
+    CHECK_EQ(verify_outputs(4), std::vector<size_t>{30, 30, 30, 10});
+  }
+
+  SUBCASE("By time window") {
+    Slicer slicer({.time_window = std::chrono::milliseconds(25)});
+    REQUIRE(slicer.Slice(input, output_path));
+    REQUIRE_EQ(slicer.OutputFilesCount(), 4);
+    CHECK_EQ(verify_outputs(4), std::vector<size_t>{25, 25, 25, 25});
+  }
+
+  SUBCASE("By size") {
+    constexpr uint64_t kMaxBytes = 1024;
+    Slicer slicer({.max_bytes = kMaxBytes, .writer_config = {.buffer_size = 100}});
+    REQUIRE(slicer.Slice(input, output_path));
+    REQUIRE_GT(slicer.OutputFilesCount(), 1);
+    verify_outputs(slicer.OutputFilesCount());
+    for (size_t index = 0; index < slicer.OutputFilesCount(); ++index) {
+      CHECK_LE(std::filesystem::file_size(output_path(index)), kMaxBytes);
+    }
+  }
+
+  SUBCASE("Existing files are kept") {
+    std::ofstream(output_path(1)) << "existing";
+    Slicer slicer({.max_packets = 30});
+    CHECK_FALSE(slicer.Slice(input, output_path));
+    CHECK_EQ(slicer.LastError(), ErrorType::kFileAlreadyExists);
+    CHECK_EQ(slicer.OutputFilesCount(), 1);
+    CHECK_EQ(std::filesystem::file_size(output_path(1)), 8);
+
+    const auto input_size = std::filesystem::file_size(input);
+    CHECK_FALSE(slicer.Slice(input, [&](size_t) { return input; }));
+    CHECK_EQ(slicer.LastError(), ErrorType::kFileAlreadyExists);
+    CHECK_EQ(std::filesystem::file_size(input), input_size);
+  }
+}
+
+TEST_CASE("Slicing big-endian file keeps its byte order") {
+  TestDirectoryManager manager(kTestOutputDir);
+  const auto input = std::filesystem::path(kTestResourcesDirPath) / "with_options_big_endian.pcapng";
+  const auto output_path = [](size_t index) {
+    return kTestOutputDir / ("slice_big_endian_" + std::to_string(index) + ".pcapng");
+  };
+
+  Slicer slicer({.max_packets = 50});
+  REQUIRE(slicer.Slice(input, output_path));
+  REQUIRE_EQ(slicer.OutputFilesCount(), 2);
+
+  Reader input_reader;
+  REQUIRE(input_reader.Open(input));
+  for (size_t index = 0; index < 2; ++index) {
+    std::ifstream output(output_path(index), std::ios::binary);
+    std::array<uint8_t, 12> header;
+    REQUIRE(output.read(reinterpret_cast<char*>(header.data()), header.size()));
+    // Byte-Order Magic is written as is.
+    CHECK_EQ(header[8], 0x1A);
+
+    Reader reader;
+    REQUIRE(reader.Open(output_path(index)));
+    for (int i = 0; i < 50; ++i) {
+      auto packet = reader.ReadPacket();
+      auto expected_packet = input_reader.ReadPacket();
+      REQUIRE(packet.has_value());
+      REQUIRE(expected_packet.has_value());
+      CHECK(std::ranges::equal(packet->GetData(), expected_packet->GetData()));
+      CHECK_EQ(packet->GetOriginalLength(), expected_packet->GetOriginalLength());
+      CHECK_EQ(packet->ParseOptions().size(), expected_packet->ParseOptions().size());
+    }
+    CHECK_FALSE(reader.ReadPacket().has_value());
+    CHECK(reader.IsValid());
+  }
+}
+
+TEST_CASE("Copying raw blocks") {
+  TestDirectoryManager manager(kTestOutputDir);
+  const auto input = std::filesystem::path(kTestResourcesDirPath) / "with_options.pcapng";
+  const std::filesystem::path test_file = kTestOutputDir / "write_test_raw_blocks.pcapng";
+
+  Reader reader;
+  REQUIRE(reader.Open(input));
+  Writer writer;
+  REQUIRE(writer.Open(test_file));
+  RawBlock block;
+  size_t blocks_count = 0;
+  while (reader.ReadRawBlock(block)) {
+    CHECK_FALSE(block.IsSwapped());
+    REQUIRE(writer.WriteRawBlock(block));
+    ++blocks_count;
+  }
+  CHECK_EQ(reader.LastError(), ErrorType::kNoError);
+  writer.Close();
+  CHECK_EQ(writer.LastError(), ErrorType::kNoError);
+  // Section header and interface of the input are read as raw blocks too.
+  CHECK_EQ(blocks_count, 102);
+
+  // The output is the section header written on opening followed by the copy of the input, which
+  // differs only by the unspecified length of the section.
+  const auto read_file = [](const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file), {});
+  };
+  std::vector<char> input_data = read_file(input);
+  std::fill_n(input_data.begin() + 16, sizeof(uint64_t), '\xFF');
+  const std::vector<char> output_data = read_file(test_file);
+  constexpr size_t kSectionHeaderSize = 28;
+  REQUIRE_EQ(output_data.size(), kSectionHeaderSize + input_data.size());
+  CHECK(std::equal(input_data.begin(), input_data.end(), output_data.begin() + kSectionHeaderSize));
+}
+
+TEST_CASE("Raw blocks may be mixed with packets") {
+  TestDirectoryManager manager(kTestOutputDir);
+  const auto input = std::filesystem::path(kTestResourcesDirPath) / "with_options.pcapng";
+  const std::filesystem::path test_file = kTestOutputDir / "write_test_raw_mixed.pcapng";
+
+  Reader reader;
+  REQUIRE(reader.Open(input));
+  RawBlock block;
+  // Section header read by Open() comes first.
+  REQUIRE(reader.ReadRawBlock(block));
+  CHECK_EQ(block.GetType(), 0x0A0D0D0A);
+  CHECK_EQ(block.GetPosition(), 0);
+  REQUIRE(reader.ReadRawBlock(block));
+  CHECK_EQ(block.GetType(), 1);
+  REQUIRE(reader.ReadRawBlock(block));
+  CHECK_EQ(block.GetType(), 6);
+  auto packet = reader.ReadPacket();
+  REQUIRE(packet.has_value());
+  CHECK_EQ(packet->GetData().size(), 2);
+
+  Writer writer;
+  REQUIRE(writer.Open(test_file));
+  const std::array<uint8_t, 8> interface_body = {1, 0, 0, 0, 4, 0, 0, 0};
+  REQUIRE(writer.WriteRawBlock(1, interface_body));
+  const auto packet_data = CreatePacketData(10);
+  REQUIRE(writer.WritePacket({.interface_id = 0}, packet_data));
+  writer.Close();
+
+  Reader big_endian_reader;
+  REQUIRE(big_endian_reader.Open(std::filesystem::path(kTestResourcesDirPath) /
+                                 "with_options_big_endian.pcapng"));
+  REQUIRE(big_endian_reader.ReadRawBlock(block));
+  CHECK(block.IsSwapped());
+  Writer another_writer;
+  const auto swapped_file = kTestOutputDir / "write_test_raw_swapped.pcapng";
+  REQUIRE(another_writer.Open(swapped_file));
+  REQUIRE(another_writer.WritePacket(packet_data));
+  CHECK_FALSE(another_writer.WriteRawBlock(block));
+  CHECK_EQ(another_writer.LastError(), ErrorType::kUnsupportedByteOrder);
+  // The block is just rejected, the packet written before it is kept.
+  CHECK(another_writer.IsValid());
+  another_writer.Close();
+  Reader swapped_reader;
+  REQUIRE(swapped_reader.Open(swapped_file));
+  CHECK(swapped_reader.ReadPacket().has_value());
+  REQUIRE(another_writer.Open(kTestOutputDir / "write_test_raw_unaligned.pcapng"));
+  CHECK_FALSE(another_writer.WriteRawBlock(0xBAD, std::span(interface_body).first(3)));
+  CHECK_EQ(another_writer.LastError(), ErrorType::kInvalidBlockSize);
+
+  // Packets of a copied section may be filtered out, so its length becomes unspecified.
+  std::vector<uint8_t> buffer;
+  REQUIRE(another_writer.OpenBuffer(buffer));
+  const auto section_body = std::to_array<uint32_t>({0x1A2B3C4D, 1, 100, 0});
+  REQUIRE(another_writer.WriteRawBlock(
+      0x0A0D0D0A, std::span(reinterpret_cast<const uint8_t*>(section_body.data()),
+                            sizeof(section_body))));
+  another_writer.Close();
+  // The section header written by the Writer is followed by the copied one.
+  REQUIRE_EQ(buffer.size(), 2 * 28);
+  uint64_t section_length = 0;
+  std::memcpy(&section_length, buffer.data() + 28 + 16, sizeof(section_length));
+  CHECK_EQ(section_length, 0xFFFFFFFFFFFFFFFF);
+
+  Reader written_reader;
+  REQUIRE(written_reader.Open(test_file));
+  auto written_packet = written_reader.ReadPacket();
+  REQUIRE(written_packet.has_value());
+  // The snap length of the raw interface applies.
+  CHECK_EQ(written_packet->GetData().size(), 4);
+  CHECK_EQ(written_packet->GetOriginalLength(), packet_data.size());
+}